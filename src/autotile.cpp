@@ -0,0 +1,206 @@
+#include "autotile.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+using json = nlohmann::json;
+
+namespace {
+
+uint16_t internValue(std::vector<json>& values, const json& value) {
+    for (size_t i = 1; i < values.size(); ++i)
+        if (values[i] == value) return static_cast<uint16_t>(i);
+    values.push_back(value);
+    return static_cast<uint16_t>(values.size() - 1);
+}
+
+}  // namespace
+
+bool AutoTiler::loadRules(const std::string& path, const Palette& palette) {
+    std::ifstream inFile(path);
+    if (!inFile)
+        return false;  // autotiling is optional
+
+    json j;
+    try {
+        inFile >> j;
+    } catch (json::parse_error& e) {
+        std::cerr << "Autotile config parse error: " << e.what() << "\n";
+        return false;
+    }
+    if (!j.is_object() || !j.contains("rules") || !j["rules"].is_object()) {
+        std::cerr << "Autotile config must be { rules: { ... } }\n";
+        return false;
+    }
+
+    std::vector<Rule> newRules;
+    std::vector<json> newValues(1);
+    std::array<int16_t, TILE_KINDS> newRuleFor;
+    newRuleFor.fill(-1);
+
+    int defaultNeighbours = j.value("neighbours", 8);
+    for (const auto& [key, ruleJson] : j["rules"].items()) {
+        Tile tile;
+        if (!palette.fromName(key, tile) || !ruleJson.is_object()) {
+            std::cerr << "Autotile rule '" << key << "': keys must name a tile (glyph, value or #id)\n";
+            return false;
+        }
+
+        Rule rule;
+        rule.neighbours = ruleJson.value("neighbours", defaultNeighbours);
+        if (rule.neighbours != 4 && rule.neighbours != 8) {
+            std::cerr << "Autotile rule '" << key << "': neighbours must be 4 or 8\n";
+            return false;
+        }
+        rule.reduceCorners = ruleJson.value("reduce_corners", true);
+        rule.edgesConnect = ruleJson.value("edges_connect", true);
+
+        // A string of glyphs, or an array of tile names
+        std::vector<Tile> connects{tile};
+        if (ruleJson.contains("connects")) {
+            const json& joined = ruleJson["connects"];
+            bool ok = joined.is_array();
+            connects.clear();
+            if (joined.is_string())
+                ok = palette.fromGlyphs(joined.get<std::string>(), connects);
+            else if (joined.is_array())
+                for (const auto& name : joined) {
+                    Tile t;
+                    if (!palette.fromName(name, t)) {
+                        ok = false;
+                        break;
+                    }
+                    connects.push_back(t);
+                }
+            if (!ok) {
+                std::cerr << "Autotile rule '" << key << "': connects names a tile not in the palette\n";
+                return false;
+            }
+        }
+        for (Tile t : connects) rule.connects[t] = true;
+
+        uint16_t fallback = 0;
+        if (ruleJson.contains("default"))
+            fallback = internValue(newValues, ruleJson["default"]);
+        rule.lookup.fill(fallback);
+
+        if (ruleJson.contains("variants")) {
+            for (const auto& [maskStr, value] : ruleJson["variants"].items()) {
+                int mask = -1;
+                try {
+                    mask = std::stoi(maskStr);
+                } catch (const std::exception&) {
+                }
+                if (mask < 0 || mask >= (1 << rule.neighbours)) {
+                    std::cerr << "Autotile rule '" << key << "': bad mask " << maskStr << "\n";
+                    return false;
+                }
+                rule.lookup[mask] = internValue(newValues, value);
+            }
+        }
+
+        newRuleFor[tile] = static_cast<int16_t>(newRules.size());
+        newRules.push_back(rule);
+    }
+
+    rules = std::move(newRules);
+    values = std::move(newValues);
+    ruleFor = newRuleFor;
+    std::cout << "Loaded " << rules.size() << " autotile rule(s) from " << path << "\n";
+    return true;
+}
+
+uint16_t AutoTiler::evaluate(const TileGrid& grid, int row, int col) const {
+    int ruleIndex = ruleFor[grid.at(row, col)];
+    if (ruleIndex < 0) return 0;
+    const Rule& rule = rules[ruleIndex];
+
+    auto joins = [&](int dr, int dc) {
+        int r = row + dr, c = col + dc;
+        if (r < 0 || r >= rows || c < 0 || c >= cols) return rule.edgesConnect;
+        return rule.connects[grid.at(r, c)];
+    };
+
+    bool n = joins(-1, 0), e = joins(0, 1), s = joins(1, 0), w = joins(0, -1);
+    int mask;
+    if (rule.neighbours == 4) {
+        mask = n | e << 1 | s << 2 | w << 3;
+    } else {
+        bool ne = joins(-1, 1), se = joins(1, 1), sw = joins(1, -1), nw = joins(-1, -1);
+        if (rule.reduceCorners) {
+            ne = ne && n && e;
+            se = se && s && e;
+            sw = sw && s && w;
+            nw = nw && n && w;
+        }
+        mask = n | ne << 1 | e << 2 | se << 3 | s << 4 | sw << 5 | w << 6 | nw << 7;
+    }
+    return rule.lookup[mask];
+}
+
+void AutoTiler::rebuild(const TileGrid& grid) {
+    if (!enabled()) return;
+    rows = grid.rows();
+    cols = grid.cols();
+    output = GridPlane<uint16_t>(rows, cols);
+
+    parallelForRows(rows, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r)
+            for (int c = 0; c < cols; ++c)
+                output.at(r, c) = evaluate(grid, r, c);
+    });
+}
+
+void AutoTiler::reframe(const TileGrid& grid, int rowOffset, int colOffset) {
+    if (!enabled()) return;
+    int oldRows = rows, oldCols = cols;
+    if (oldRows == 0 || rowOffset < 0 || colOffset < 0 || rowOffset + oldRows > grid.rows() ||
+        colOffset + oldCols > grid.cols()) {
+        rebuild(grid);
+        return;
+    }
+    rows = grid.rows();
+    cols = grid.cols();
+    output.grow(rowOffset, rows - oldRows - rowOffset, colOffset, cols - oldCols - colOffset);
+
+    // Tiles strictly inside the old area keep their neighbours; the ring
+    // that was the map border now has new ones
+    int top = rowOffset + 1, bottom = rowOffset + oldRows - 2;
+    int left = colOffset + 1, right = colOffset + oldCols - 2;
+    parallelForRows(rows, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            bool kept = r >= top && r <= bottom && left <= right;
+            for (int c = 0; c < cols; ++c) {
+                if (kept && c == left) c = right + 1;
+                if (c < cols) output.at(r, c) = evaluate(grid, r, c);
+            }
+        }
+    });
+}
+
+void AutoTiler::updateAround(const TileGrid& grid, int row, int col) {
+    if (!enabled()) return;
+    if (grid.rows() != rows || grid.cols() != cols) {
+        rebuild(grid);  // dimensions changed under us
+        return;
+    }
+
+    for (int r = std::max(0, row - 1); r <= std::min(rows - 1, row + 1); ++r)
+        for (int c = std::max(0, col - 1); c <= std::min(cols - 1, col + 1); ++c)
+            output.at(r, c) = evaluate(grid, r, c);
+}
+
+json AutoTiler::exportTiles(const TileGrid& grid, const Palette& palette) const {
+    json j = json::array();
+    for (int r = 0; r < rows; ++r) {
+        json line = json::array();
+        for (int c = 0; c < cols; ++c) {
+            uint16_t v = output.at(r, c);
+            line.push_back(v == 0 ? palette.toJson(grid.at(r, c)) : values[v]);
+        }
+        j.push_back(line);
+    }
+    return j;
+}
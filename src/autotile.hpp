@@ -0,0 +1,72 @@
+// Rule-based autotiling: turns terrain characters into edge/corner variants
+//
+// Rules come from a JSON config (autotile.json), e.g.
+//
+//   {
+//     "neighbours": 8,
+//     "rules": {
+//       "#": { "connects": "#D", "default": "wall",
+//              "variants": { "0": "wall_pillar", "255": "wall_fill" } }
+//     }
+//   }
+//
+// Rule keys are tile names as Palette::fromName takes them; "connects" is a
+// string of glyphs or an array of names, defaulting to the rule's own tile.
+// Each terrain tile gets a bitmask of which neighbours "connect" to it
+// (4-neighbour: N=1 E=2 S=4 W=8; 8-neighbour: N=1 NE=2 E=4 SE=8 S=16 SW=32
+// W=64 NW=128) and the mask is looked up in its variant table. Output tiles
+// can be any JSON value; terrain without a rule exports as its palette value.
+
+#pragma once
+
+#include "nlohmann/json.hpp"
+#include "palette.hpp"
+#include "tile_grid.hpp"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class AutoTiler {
+public:
+    AutoTiler() { ruleFor.fill(-1); }
+
+    // Rule keys and "connects" name tiles through the palette
+    bool loadRules(const std::string& path, const Palette& palette);
+    bool enabled() const { return !rules.empty(); }
+
+    // Full pass over the whole map (parallel over row bands); used on load
+    // and export
+    void rebuild(const TileGrid& grid);
+
+    // The map was reframed with its old (0, 0) now at (rowOffset, colOffset).
+    // When it only grew, the output grows into spare room and just the new
+    // tiles and the old border ring are evaluated; anything else is a
+    // rebuild.
+    void reframe(const TileGrid& grid, int rowOffset, int colOffset);
+
+    // Recompute only the 3x3 neighbourhood of an edited cell
+    void updateAround(const TileGrid& grid, int row, int col);
+
+    // Output tiles as a nested JSON array, same shape as the map; tiles
+    // without a rule are written as their palette value
+    nlohmann::json exportTiles(const TileGrid& grid, const Palette& palette) const;
+
+private:
+    struct Rule {
+        int neighbours = 8;
+        bool reduceCorners = true;           // ignore corners unless both sides connect
+        bool edgesConnect = true;            // the map border counts as connected
+        std::array<bool, TILE_KINDS> connects{};  // which tiles join this terrain
+        std::array<uint16_t, 256> lookup{};       // mask -> index into values
+    };
+
+    std::array<int16_t, TILE_KINDS> ruleFor{};    // tile -> index into rules, -1 if none
+    std::vector<Rule> rules;
+    std::vector<nlohmann::json> values;      // interned output tiles; 0 means "no rule"
+
+    GridPlane<uint16_t> output;              // one entry per tile
+    int rows = 0, cols = 0;
+
+    uint16_t evaluate(const TileGrid& grid, int row, int col) const;
+};
@@ -0,0 +1,223 @@
+#include "bit_grid.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+
+// Column c of the result holds column c - 1 / c + 1 of the input; `row`
+// has one extra word at the end carrying the edge value
+inline uint64_t fromWest(const uint64_t* row, int w, uint64_t edgeWord) {
+    return (row[w] << 1) | ((w > 0 ? row[w - 1] : edgeWord) >> 63);
+}
+inline uint64_t fromEast(const uint64_t* row, int w) {
+    return (row[w] >> 1) | (row[w + 1] << 63);
+}
+
+// 4-bit bit-sliced counters for 64 tiles at once
+struct SlicedCount {
+    uint64_t b0 = 0, b1 = 0, b2 = 0, b3 = 0;
+
+    void add(uint64_t x) {
+        uint64_t c0 = b0 & x;
+        b0 ^= x;
+        uint64_t c1 = b1 & c0;
+        b1 ^= c0;
+        uint64_t c2 = b2 & c1;
+        b2 ^= c1;
+        b3 |= c2;
+    }
+
+    // Lanes whose count is >= k, most significant bit first
+    uint64_t atLeast(int k) const {
+        if (k <= 0) return ~uint64_t(0);
+        if (k > 15) return 0;
+        const uint64_t slice[4] = {b0, b1, b2, b3};
+        uint64_t greater = 0, equal = ~uint64_t(0);
+        for (int i = 3; i >= 0; --i) {
+            if ((k >> i) & 1) {
+                equal &= slice[i];
+            } else {
+                greater |= equal & slice[i];
+                equal &= ~slice[i];
+            }
+        }
+        return greater | equal;
+    }
+};
+
+}  // namespace
+
+BitGrid::BitGrid(int rows, int cols)
+    : nRows(rows), nCols(cols), stride((cols + 63) / 64),
+      lastMask(cols % 64 ? (uint64_t(1) << (cols % 64)) - 1 : ~uint64_t(0)),
+      bits(rows, stride, 0) {}
+
+size_t BitGrid::count() const {
+    size_t total = 0;
+    for (int r = 0; r < nRows; ++r)
+        for (int w = 0; w < stride; ++w) total += std::popcount(row(r)[w]);
+    return total;
+}
+
+bool BitGrid::reframe(int newRows, int newCols, int rowOffset, int colOffset) {
+    if (rowOffset < 0 || colOffset < 0 || colOffset % 64 != 0 || rowOffset + nRows > newRows ||
+        colOffset + nCols > newCols)
+        return false;
+    // Padding bits are clear, so the old last word's new columns start clear
+    int newStride = (newCols + 63) / 64, wordOffset = colOffset / 64;
+    bits.grow(rowOffset, newRows - nRows - rowOffset, wordOffset, newStride - stride - wordOffset, 0);
+    nRows = newRows;
+    nCols = newCols;
+    stride = newStride;
+    lastMask = newCols % 64 ? (uint64_t(1) << (newCols % 64)) - 1 : ~uint64_t(0);
+    return true;
+}
+
+BitGrid& BitGrid::operator|=(const BitGrid& other) {
+    for (int r = 0; r < nRows; ++r)
+        for (int w = 0; w < stride; ++w) row(r)[w] |= other.row(r)[w];
+    return *this;
+}
+
+BitGrid& BitGrid::operator&=(const BitGrid& other) {
+    for (int r = 0; r < nRows; ++r)
+        for (int w = 0; w < stride; ++w) row(r)[w] &= other.row(r)[w];
+    return *this;
+}
+
+BitGrid& BitGrid::subtract(const BitGrid& other) {
+    for (int r = 0; r < nRows; ++r)
+        for (int w = 0; w < stride; ++w) row(r)[w] &= ~other.row(r)[w];
+    return *this;
+}
+
+BitGrid& BitGrid::invert() {
+    for (int r = 0; r < nRows; ++r)
+        for (int w = 0; w < stride; ++w) row(r)[w] = ~row(r)[w];
+    clearPadding();
+    return *this;
+}
+
+void BitGrid::clearPadding() {
+    if (stride == 0) return;
+    for (int r = 0; r < nRows; ++r) row(r)[stride - 1] &= lastMask;
+}
+
+void BitGrid::loadRow(int r, bool edge, std::vector<uint64_t>& out) const {
+    uint64_t fill = edge ? ~uint64_t(0) : 0;
+    out.assign(stride + 1, fill);
+    if (r < 0 || r >= nRows || stride == 0) return;
+    std::copy(row(r), row(r) + stride, out.begin());
+    if (edge) out[stride - 1] |= ~lastMask;
+}
+
+// combine(w, up, mid, down, edgeWord) -> result word w, given the three
+// loaded rows around the output row
+template <typename Combine>
+BitGrid BitGrid::stencil(bool edge, Combine&& combine) const {
+    BitGrid out(nRows, nCols);
+    uint64_t edgeWord = edge ? ~uint64_t(0) : 0;
+    parallelForRows(nRows, [&](int begin, int end) {
+        std::vector<uint64_t> up, mid, down;
+        loadRow(begin - 1, edge, up);
+        loadRow(begin, edge, mid);
+        for (int r = begin; r < end; ++r) {
+            loadRow(r + 1, edge, down);
+            uint64_t* dst = out.row(r);
+            for (int w = 0; w < stride; ++w) dst[w] = combine(w, up.data(), mid.data(), down.data(), edgeWord);
+            std::swap(up, mid);
+            std::swap(mid, down);
+        }
+    });
+    out.clearPadding();
+    return out;
+}
+
+BitGrid BitGrid::dilate(bool edge) const {
+    return stencil(edge, [](int w, const uint64_t* up, const uint64_t* mid, const uint64_t* down, uint64_t e) {
+        uint64_t v = up[w] | mid[w] | down[w];
+        uint64_t west = fromWest(up, w, e) | fromWest(mid, w, e) | fromWest(down, w, e);
+        uint64_t east = fromEast(up, w) | fromEast(mid, w) | fromEast(down, w);
+        return v | west | east;
+    });
+}
+
+BitGrid BitGrid::erode(bool edge) const {
+    return stencil(edge, [](int w, const uint64_t* up, const uint64_t* mid, const uint64_t* down, uint64_t e) {
+        uint64_t v = up[w] & mid[w] & down[w];
+        uint64_t west = fromWest(up, w, e) & fromWest(mid, w, e) & fromWest(down, w, e);
+        uint64_t east = fromEast(up, w) & fromEast(mid, w) & fromEast(down, w);
+        return v & west & east;
+    });
+}
+
+BitGrid BitGrid::atLeast(int k, bool includeSelf, bool edge) const {
+    return stencil(edge, [k, includeSelf](int w, const uint64_t* up, const uint64_t* mid, const uint64_t* down,
+                                          uint64_t e) {
+        SlicedCount n;
+        for (const uint64_t* line : {up, mid, down}) {
+            n.add(fromWest(line, w, e));
+            n.add(fromEast(line, w));
+            if (line != mid || includeSelf) n.add(line[w]);
+        }
+        return n.atLeast(k);
+    });
+}
+
+void BitGrid::neighbourCounts(std::vector<uint8_t>& counts, bool edge) const {
+    counts.assign(static_cast<size_t>(nRows) * nCols, 0);
+    uint64_t edgeWord = edge ? ~uint64_t(0) : 0;
+    parallelForRows(nRows, [&](int begin, int end) {
+        std::vector<uint64_t> up, mid, down;
+        loadRow(begin - 1, edge, up);
+        loadRow(begin, edge, mid);
+        for (int r = begin; r < end; ++r) {
+            loadRow(r + 1, edge, down);
+            uint8_t* out = &counts[static_cast<size_t>(r) * nCols];
+            for (int w = 0; w < stride; ++w) {
+                SlicedCount n;
+                for (const uint64_t* line : {up.data(), mid.data(), down.data()}) {
+                    n.add(fromWest(line, w, edgeWord));
+                    n.add(fromEast(line, w));
+                    if (line != mid.data()) n.add(line[w]);
+                }
+                int width = std::min(64, nCols - w * 64);
+                for (int i = 0; i < width; ++i)
+                    out[w * 64 + i] = static_cast<uint8_t>(((n.b0 >> i) & 1) | (((n.b1 >> i) & 1) << 1) |
+                                                           (((n.b2 >> i) & 1) << 2) | (((n.b3 >> i) & 1) << 3));
+            }
+            std::swap(up, mid);
+            std::swap(mid, down);
+        }
+    });
+}
+
+BitGrid solidMask(const TileGrid& grid, const TileProperties& props) {
+    BitGrid mask(grid.rows(), grid.cols());
+    parallelForRows(grid.rows(), [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            const Tile* line = grid.row(r);
+            uint64_t* out = mask.row(r);
+            for (int c = 0; c < grid.cols(); ++c) out[c >> 6] |= uint64_t(props.isSolid(line[c])) << (c & 63);
+        }
+    });
+    return mask;
+}
+
+void growSolidMask(BitGrid& mask, const TileGrid& grid, const TileProperties& props, int rowOffset, int colOffset) {
+    int oldRows = mask.rows(), oldCols = mask.cols();
+    if (!mask.reframe(grid.rows(), grid.cols(), rowOffset, colOffset)) {
+        mask = solidMask(grid, props);
+        return;
+    }
+    for (int r = 0; r < grid.rows(); ++r) {
+        const Tile* line = grid.row(r);
+        bool old = r >= rowOffset && r < rowOffset + oldRows;
+        for (int c = 0; c < grid.cols(); ++c) {
+            if (old && c == colOffset) c += oldCols;
+            if (c < grid.cols() && props.isSolid(line[c])) mask.set(r, c, true);
+        }
+    }
+}
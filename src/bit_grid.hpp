@@ -0,0 +1,83 @@
+// One bit per tile, with word-parallel neighbourhood operations
+//
+// Each row is a run of 64-bit words, bit c % 64 of word c / 64 holding
+// column c; bits past the last column are kept clear. Dilate, erode and
+// the neighbour-count tests shift whole words sideways and combine three
+// rows at a time, so they touch 64 tiles per instruction. Neighbour
+// counts use bit-sliced adders: four words hold the 4-bit count of 64
+// tiles. Operations that look past the map edge take the value to assume
+// there.
+
+#pragma once
+
+#include "tile_grid.hpp"
+#include "tile_properties.hpp"
+
+#include <cstdint>
+#include <vector>
+
+class BitGrid {
+public:
+    BitGrid() = default;
+    BitGrid(int rows, int cols);
+
+    int rows() const { return nRows; }
+    int cols() const { return nCols; }
+    int wordsPerRow() const { return stride; }
+
+    bool get(int row, int col) const { return (bits.at(row, col >> 6) >> (col & 63)) & 1; }
+    void set(int row, int col, bool value) {
+        uint64_t mask = uint64_t(1) << (col & 63);
+        if (value)
+            bits.at(row, col >> 6) |= mask;
+        else
+            bits.at(row, col >> 6) &= ~mask;
+    }
+
+    const uint64_t* row(int r) const { return bits.row(r); }
+    uint64_t* row(int r) { return bits.row(r); }
+
+    size_t count() const;
+
+    // The map grew, its old (0, 0) now at (rowOffset, colOffset): the words
+    // grow into spare room and the new bits are clear. Only for growth by
+    // whole words across; false, with nothing changed, otherwise.
+    bool reframe(int newRows, int newCols, int rowOffset, int colOffset);
+
+    // Set operations on grids of the same size
+    BitGrid& operator|=(const BitGrid& other);
+    BitGrid& operator&=(const BitGrid& other);
+    BitGrid& subtract(const BitGrid& other);
+    BitGrid& invert();
+
+    // Set where any / every tile of the 3x3 block is set
+    BitGrid dilate(bool edge = false) const;
+    BitGrid erode(bool edge = true) const;
+
+    // Set where at least k tiles of the 3x3 block are set, the centre
+    // counted only when includeSelf
+    BitGrid atLeast(int k, bool includeSelf, bool edge) const;
+
+    // Set 8-neighbours of every tile, row-major
+    void neighbourCounts(std::vector<uint8_t>& counts, bool edge = false) const;
+
+private:
+    int nRows = 0, nCols = 0, stride = 0;
+    uint64_t lastMask = 0;  // valid bits of each row's last word
+    GridPlane<uint64_t> bits;  // rows x stride words
+
+    // Words of a row as the neighbourhood passes see them: rows past the
+    // edge and bits past the last column read as `edge`
+    void loadRow(int r, bool edge, std::vector<uint64_t>& out) const;
+    void clearPadding();
+
+    template <typename Combine>
+    BitGrid stencil(bool edge, Combine&& combine) const;
+};
+
+// Bit per tile of `grid` that tiles.json marks solid
+BitGrid solidMask(const TileGrid& grid, const TileProperties& props);
+// Bring a solid mask along after the map grew, its old (0, 0) now at
+// (rowOffset, colOffset); only the new tiles are read when the old bits
+// can move over whole, otherwise it is made again
+void growSolidMask(BitGrid& mask, const TileGrid& grid, const TileProperties& props, int rowOffset, int colOffset);
@@ -0,0 +1,58 @@
+// The set of DIRTY_CHUNK x DIRTY_CHUNK blocks touched by one edit
+//
+// Marking a tile is a flag test; the list of marked blocks is what
+// observers walk afterwards, so a million-tile fill hands them a few
+// thousand blocks instead of a million tiles. The render, region, HPA,
+// validation and snapshot chunks are all multiples of DIRTY_CHUNK, so one
+// block never straddles two of theirs.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const int DIRTY_CHUNK = 32;
+
+class DirtyRegion {
+public:
+    // Forget everything, for a map of rows x cols
+    void reset(int rows, int cols) {
+        nRows = rows;
+        nCols = cols;
+        chunkCols = (cols + DIRTY_CHUNK - 1) / DIRTY_CHUNK;
+        marked.assign(static_cast<size_t>((rows + DIRTY_CHUNK - 1) / DIRTY_CHUNK) * chunkCols, 0);
+        list.clear();
+    }
+
+    int rows() const { return nRows; }
+    int cols() const { return nCols; }
+
+    void mark(int row, int col) {
+        int block = (row / DIRTY_CHUNK) * chunkCols + col / DIRTY_CHUNK;
+        if (marked[block]) return;
+        marked[block] = 1;
+        list.push_back(block);
+    }
+
+    bool empty() const { return list.empty(); }
+    size_t blockCount() const { return list.size(); }
+
+    // Top-left tile of every marked block, in marking order
+    template <typename Fn>
+    void forEachBlock(Fn&& fn) const {
+        for (int block : list)
+            fn((block / chunkCols) * DIRTY_CHUNK, (block % chunkCols) * DIRTY_CHUNK);
+    }
+
+    // O(marked blocks)
+    void clear() {
+        for (int block : list) marked[block] = 0;
+        list.clear();
+    }
+
+private:
+    int nRows = 0, nCols = 0, chunkCols = 0;
+    std::vector<uint8_t> marked;
+    std::vector<int> list;
+};
@@ -0,0 +1,152 @@
+#include "distance_field.hpp"
+
+#include "parallel.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const float INF = std::numeric_limits<float>::infinity();
+
+// Lower envelope of the parabolas y = (x - q)^2 + f(q) sampled at 0..n-1.
+// v, z are scratch of size n and n + 1.
+void envelope1D(const float* f, float* out, int n, std::vector<int>& v, std::vector<float>& z) {
+    int k = -1;
+    for (int q = 0; q < n; ++q) {
+        if (f[q] == INF) continue;
+        float s = -INF;
+        while (k >= 0) {
+            int p = v[k];
+            s = ((f[q] + float(q) * q) - (f[p] + float(p) * p)) / (2.f * (q - p));
+            if (s > z[k]) break;
+            --k;
+        }
+        ++k;
+        v[k] = q;
+        z[k] = k == 0 ? -INF : s;
+        z[k + 1] = INF;
+    }
+
+    if (k < 0) {
+        std::fill(out, out + n, INF);
+        return;
+    }
+    for (int q = 0, j = 0; q < n; ++q) {
+        while (z[j + 1] < q) ++j;
+        float d = float(q - v[j]);
+        out[q] = d * d + f[v[j]];
+    }
+}
+
+}  // namespace
+
+std::vector<float> wallDistance(const TileGrid& grid, const TileProperties& props) {
+    int rows = grid.rows(), cols = grid.cols();
+    std::vector<float> dist(grid.size());
+
+    // Column pass: vertical distance to the nearest solid tile, walking whole
+    // rows at a time so each band of columns stays cache friendly
+    parallelForRows(cols, [&](int begin, int end) {
+        for (int c = begin; c < end; ++c)
+            dist[c] = props.isSolid(grid.at(0, c)) ? 0.f : INF;
+        for (int r = 1; r < rows; ++r) {
+            const Tile* src = grid.row(r);
+            float* d = &dist[grid.index(r, 0)];
+            const float* above = d - cols;
+            for (int c = begin; c < end; ++c)
+                d[c] = props.isSolid(src[c]) ? 0.f : above[c] + 1.f;
+        }
+        for (int r = rows - 2; r >= 0; --r) {
+            float* d = &dist[grid.index(r, 0)];
+            const float* below = d + cols;
+            for (int c = begin; c < end; ++c)
+                d[c] = std::min(d[c], below[c] + 1.f);
+        }
+    });
+
+    // Row pass on squared distances
+    parallelForRows(rows, [&](int begin, int end) {
+        std::vector<float> f(cols);
+        std::vector<int> v(cols);
+        std::vector<float> z(cols + 1);
+        for (int r = begin; r < end; ++r) {
+            float* d = &dist[grid.index(r, 0)];
+            for (int c = 0; c < cols; ++c) f[c] = d[c] * d[c];
+            envelope1D(f.data(), d, cols, v, z);
+            for (int c = 0; c < cols; ++c) d[c] = std::sqrt(d[c]);
+        }
+    });
+    return dist;
+}
+
+std::vector<int> spawnDistance(const TileGrid& grid, const TileProperties& props, PathPoint spawn) {
+    int rows = grid.rows(), cols = grid.cols();
+    std::vector<int> dist(grid.size(), -1);
+    if (!grid.inBounds(spawn.row, spawn.col) || !props.isPassable(grid.at(spawn.row, spawn.col)))
+        return dist;
+
+    // The distance vector doubles as the visited set; the frontier is a plain
+    // index array read front to back
+    std::vector<int> queue;
+    queue.reserve(grid.size());
+    int start = static_cast<int>(grid.index(spawn.row, spawn.col));
+    dist[start] = 0;
+    queue.push_back(start);
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int cell = queue[head];
+        int r = cell / cols, c = cell % cols;
+        auto visit = [&](int next, int nr, int nc) {
+            if (dist[next] < 0 && props.isPassable(grid.at(nr, nc))) {
+                dist[next] = dist[cell] + 1;
+                queue.push_back(next);
+            }
+        };
+        if (r > 0) visit(cell - cols, r - 1, c);
+        if (r < rows - 1) visit(cell + cols, r + 1, c);
+        if (c > 0) visit(cell - 1, r, c - 1);
+        if (c < cols - 1) visit(cell + 1, r, c + 1);
+    }
+    return dist;
+}
+
+std::vector<float> solidDensity(const TileGrid& grid, const TileProperties& props, int radius) {
+    int rows = grid.rows(), cols = grid.cols();
+    std::vector<int> horizontal(grid.size());
+    std::vector<float> density(grid.size());
+
+    // Separable box sums: running window along each row, then down each column
+    parallelForRows(rows, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            const Tile* src = grid.row(r);
+            int* h = &horizontal[grid.index(r, 0)];
+            int sum = 0;
+            for (int c = 0; c < std::min(radius, cols); ++c) sum += props.isSolid(src[c]);
+            for (int c = 0; c < cols; ++c) {
+                if (c + radius < cols) sum += props.isSolid(src[c + radius]);
+                if (c - radius - 1 >= 0) sum -= props.isSolid(src[c - radius - 1]);
+                h[c] = sum;
+            }
+        }
+    });
+
+    parallelForRows(cols, [&](int begin, int end) {
+        std::vector<int> sum(end - begin, 0);
+        for (int r = 0; r < std::min(radius, rows); ++r)
+            for (int c = begin; c < end; ++c) sum[c - begin] += horizontal[grid.index(r, c)];
+        for (int r = 0; r < rows; ++r) {
+            const int* add = r + radius < rows ? &horizontal[grid.index(r + radius, 0)] : nullptr;
+            const int* sub = r - radius - 1 >= 0 ? &horizontal[grid.index(r - radius - 1, 0)] : nullptr;
+            int height = std::min(rows - 1, r + radius) - std::max(0, r - radius) + 1;
+            float* out = &density[grid.index(r, 0)];
+            for (int c = begin; c < end; ++c) {
+                int& s = sum[c - begin];
+                if (add) s += add[c];
+                if (sub) s -= sub[c];
+                int width = std::min(cols - 1, c + radius) - std::max(0, c - radius) + 1;
+                out[c] = static_cast<float>(s) / static_cast<float>(width * height);
+            }
+        }
+    });
+    return density;
+}
@@ -0,0 +1,25 @@
+// Per-tile scalar fields for the heatmap overlays
+//
+// All fields are row-major, one value per tile, matching TileGrid::index().
+
+#pragma once
+
+#include "pathfinding.hpp"
+#include "tile_grid.hpp"
+#include "tile_properties.hpp"
+
+#include <vector>
+
+// Euclidean distance from each tile to the nearest solid tile (0 on solid
+// tiles, infinity when the map has none). Exact, in two linear passes
+// (Felzenszwalb & Huttenlocher): down each column, then the lower envelope
+// of parabolas along each row.
+std::vector<float> wallDistance(const TileGrid& grid, const TileProperties& props);
+
+// Walking distance in 4-connected steps from spawn over passable tiles; -1
+// where unreachable
+std::vector<int> spawnDistance(const TileGrid& grid, const TileProperties& props, PathPoint spawn);
+
+// Fraction of solid tiles in the (2 * radius + 1)^2 window around each tile,
+// clipped at the map edges
+std::vector<float> solidDensity(const TileGrid& grid, const TileProperties& props, int radius);
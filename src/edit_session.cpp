@@ -0,0 +1,114 @@
+#include "edit_session.hpp"
+
+#include <iostream>
+
+void EditSession::begin() {
+    for (auto& region : regions)
+        if (region.rows() != layers.rows() || region.cols() != layers.cols())
+            region.reset(layers.rows(), layers.cols());
+}
+
+void EditSession::set(int layer, int row, int col, Tile t) {
+    Tile before = layers.get(layer, row, col);
+    if (before == t) return;
+    layers.set(layer, row, col, t);
+    note(layer, row, col, before, t);
+}
+
+void EditSession::note(int layer, int row, int col, Tile before, Tile after) {
+    changes.push_back({row, col, before, after, static_cast<uint8_t>(layer)});
+    regions[layer].mark(row, col);
+    layers.touch(layer, row, col);
+}
+
+size_t EditSession::pendingBlocks() const {
+    size_t blocks = 0;
+    for (const auto& region : regions) blocks += region.blockCount();
+    return blocks;
+}
+
+size_t EditSession::commit(bool undoable) {
+    size_t changed = changes.size();
+    int touched = 0;
+    for (const auto& region : regions) touched += !region.empty();
+    // One batch per layer, in layer order; a single-layer transaction (the
+    // usual case) hands over its changes without copying
+    EditRecord part;
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        if (regions[layer].empty()) continue;
+        if (touched > 1) {
+            part.clear();
+            for (const auto& change : changes)
+                if (change.layer == layer) part.push_back(change);
+        }
+        EditBatch batch{layer, touched > 1 ? part : changes, regions[layer]};
+        for (auto& observer : observers) observer(batch);
+        regions[layer].clear();
+    }
+    if (undoable && changed > 0) pushHistory(std::move(changes));
+    changes.clear();
+    return changed;
+}
+
+size_t EditSession::commitRegion(int layer, const TileGrid& before, int top, int left) {
+    const TileGrid& plane = layers.plane(layer);
+    begin();
+    for (int r = 0; r < before.rows(); ++r)
+        for (int c = 0; c < before.cols(); ++c) {
+            Tile now = plane.at(top + r, left + c);
+            if (now != before.at(r, c))
+                note(layer, top + r, left + c, before.at(r, c), now);
+        }
+    return commit();
+}
+
+bool EditSession::pushHistory(EditRecord record) {
+    if (record.empty()) return true;
+    if (record.size() > MAX_UNDO_TILES) {
+        clearHistory();
+        std::cerr << "Edit of " << record.size() << " tiles is over the undo limit of " << MAX_UNDO_TILES
+                  << "; it can't be undone and the undo history was cleared\n";
+        return false;
+    }
+    for (auto& change : record) {
+        change.row -= historyRow;
+        change.col -= historyCol;
+    }
+    undoStack.push_back(std::move(record));
+    if (undoStack.size() > MAX_HISTORY)
+        undoStack.erase(undoStack.begin());
+    redoStack.clear();
+    return true;
+}
+
+void EditSession::clearHistory() {
+    undoStack.clear();
+    redoStack.clear();
+    historyRow = historyCol = 0;
+}
+
+size_t EditSession::undo() {
+    if (undoStack.empty()) return 0;
+    EditRecord record = std::move(undoStack.back());
+    undoStack.pop_back();
+    begin();
+    for (auto it = record.rbegin(); it != record.rend(); ++it)
+        set(it->layer, it->row + historyRow, it->col + historyCol, it->before);
+    commit(false);
+    size_t count = record.size();
+    redoStack.push_back(std::move(record));
+    return count;
+}
+
+size_t EditSession::redo() {
+    if (redoStack.empty()) return 0;
+    EditRecord record = std::move(redoStack.back());
+    redoStack.pop_back();
+    begin();
+    for (const auto& change : record)
+        set(change.layer, change.row + historyRow, change.col + historyCol, change.after);
+    commit(false);
+    size_t count = record.size();
+    undoStack.push_back(std::move(record));
+    return count;
+}
@@ -0,0 +1,118 @@
+// Tile edits on a layer stack: transactions, their observers, and undo/redo
+//
+// Writes go through a transaction: begin(), any number of set()/note()
+// calls, commit(). Writes land at once; the observers hear about them on
+// commit, in the order they were added, once per layer the transaction
+// touched. An undoable commit becomes one history step, whatever layers
+// it spans. Nothing here draws or reads
+// input, so the same edit path serves the editor and headless tools.
+
+#pragma once
+
+#include "dirty_region.hpp"
+#include "layers.hpp"
+#include "selection_mask.hpp"
+#include "tile_grid.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+const size_t MAX_HISTORY = 256;
+const size_t MAX_UNDO_TILES = 1 << 20;  // bigger edits clear the history instead
+
+// One tile write, with enough information to undo/redo it
+struct TileChange {
+    int row, col;
+    Tile before, after;
+    uint8_t layer = LAYER_TERRAIN;
+};
+
+// A group of tile writes that undo/redo as a single step; each change
+// carries its own layer
+using EditRecord = std::vector<TileChange>;
+
+// One committed edit transaction as its observers see it: every changed
+// tile (all on one layer) and the blocks they fall in
+struct EditBatch {
+    int layer;
+    const EditRecord& changes;
+    const DirtyRegion& region;
+};
+
+class EditSession {
+public:
+    using Observer = std::function<void(const EditBatch&)>;
+
+    // `layers` must outlive the session
+    explicit EditSession(LayerStack& layers) : layers(layers) {}
+
+    void observe(Observer observer) { observers.push_back(std::move(observer)); }
+
+    void begin();
+    void set(int layer, int row, int col, Tile t);
+    // For bulk writers that changed a dense plane themselves; also marks
+    // the tile for the next snapshot (LayerStack::touch)
+    void note(int layer, int row, int col, Tile before, Tile after);
+    // Returns the number of changed tiles
+    size_t commit(bool undoable = true);
+
+    // Run every selected tile of a dense layer through fn(row, col, tile)
+    // as one transaction, span by span; returns the number of changed tiles
+    template <typename Rewrite>
+    size_t rewrite(int layer, const SelectionMask& sel, Rewrite&& fn) {
+        TileGrid& plane = layers.plane(layer);
+        begin();
+        for (int r = 0; r < sel.rows(); ++r) {
+            Tile* line = plane.row(r);
+            for (const Span& span : sel.row(r))
+                for (int c = span.begin; c < span.end; ++c) {
+                    Tile now = fn(r, c, line[c]);
+                    if (now == line[c]) continue;
+                    note(layer, r, c, line[c], now);
+                    line[c] = now;
+                }
+        }
+        return commit();
+    }
+
+    // Commit the difference between `before` (a copy of the region at
+    // top/left, taken before a dense layer was changed in place) and the
+    // layer as it is now; returns the number of changed tiles
+    size_t commitRegion(int layer, const TileGrid& before, int top, int left);
+
+    // The open transaction so far
+    const EditRecord& pending() const { return changes; }
+    // Blocks it touched, summed over its layers
+    size_t pendingBlocks() const;
+
+    // A record too large to keep clears the history instead, since older
+    // steps can't be replayed past it; that is reported on std::cerr and
+    // returns false
+    bool pushHistory(EditRecord record);
+    void clearHistory();
+    bool canUndo() const { return !undoStack.empty(); }
+    bool canRedo() const { return !redoStack.empty(); }
+
+    // Replay the newest step backwards/forwards as one transaction; the
+    // number of tiles, 0 when there is nothing to undo/redo
+    size_t undo();
+    size_t redo();
+
+    // The map grew by dr rows on top and dc columns on the left; O(1), the
+    // history is kept relative to its own origin
+    void moveHistory(int dr, int dc) {
+        historyRow += dr;
+        historyCol += dc;
+    }
+
+private:
+    LayerStack& layers;
+    EditRecord changes;
+    std::array<DirtyRegion, LAYER_COUNT> regions;
+    std::vector<Observer> observers;
+    std::vector<EditRecord> undoStack, redoStack;
+    int historyRow = 0, historyCol = 0;  // map position of (0, 0) in the history
+};
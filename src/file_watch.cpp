@@ -0,0 +1,81 @@
+#include "file_watch.hpp"
+
+#include <iostream>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cstring>
+#else
+namespace {
+
+const auto POLL_INTERVAL = std::chrono::milliseconds(250);
+
+std::filesystem::file_time_type writeTime(const std::filesystem::path& path) {
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(path, ec);
+    return ec ? std::filesystem::file_time_type::min() : time;
+}
+
+}  // namespace
+#endif
+
+FileWatcher::~FileWatcher() {
+    stop();
+}
+
+bool FileWatcher::watch(const std::string& path) {
+    stop();
+    file = std::filesystem::absolute(path);
+#ifdef __linux__
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd >= 0)
+        wd = inotify_add_watch(fd, file.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+        std::cerr << "Can't watch " << path << " for changes: " << std::strerror(errno) << "\n";
+        stop();
+        return false;
+    }
+#else
+    lastWrite = writeTime(file);
+    nextPoll = std::chrono::steady_clock::now() + POLL_INTERVAL;
+#endif
+    return true;
+}
+
+void FileWatcher::stop() {
+#ifdef __linux__
+    if (fd >= 0) close(fd);
+#endif
+    fd = wd = -1;
+    file.clear();
+}
+
+bool FileWatcher::changed() {
+    if (file.empty()) return false;
+#ifdef __linux__
+    // Drain every queued event; any of them naming the file counts
+    bool hit = false;
+    alignas(inotify_event) char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof buffer)) > 0) {
+        for (char* p = buffer; p < buffer + n;) {
+            auto* event = reinterpret_cast<inotify_event*>(p);
+            if (event->len > 0 && file.filename() == event->name)
+                hit = true;
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+    return hit;
+#else
+    auto now = std::chrono::steady_clock::now();
+    if (now < nextPoll) return false;
+    nextPoll = now + POLL_INTERVAL;
+    auto time = writeTime(file);
+    if (time == lastWrite) return false;
+    lastWrite = time;
+    return true;
+#endif
+}
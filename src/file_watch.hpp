@@ -0,0 +1,36 @@
+// Notices when a file is rewritten by another program
+//
+// On Linux this is inotify on the file's directory, so tools that write a
+// temporary file and rename it over the original are seen as well as ones
+// that write in place; only completed writes count, not every chunk of
+// one. Elsewhere the modification time is polled a few times a second.
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+class FileWatcher {
+public:
+    FileWatcher() = default;
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Replaces any earlier watch; false (with a message) when the file
+    // can't be watched
+    bool watch(const std::string& path);
+    void stop();
+
+    // True once for each batch of changes since the last call; never blocks
+    bool changed();
+
+private:
+    std::filesystem::path file;
+    int fd = -1, wd = -1;
+
+    // Polling fallback
+    std::filesystem::file_time_type lastWrite;
+    std::chrono::steady_clock::time_point nextPoll;
+};
@@ -0,0 +1,81 @@
+#include "fov.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Octant transforms: (dx, dy) in octant space maps to
+// col = origin.col + dx * xx + dy * xy, row = origin.row + dx * yx + dy * yy
+const int OCTANTS[8][4] = {
+    {1, 0, 0, 1}, {0, 1, 1, 0}, {0, -1, 1, 0}, {-1, 0, 0, 1},
+    {-1, 0, 0, -1}, {0, -1, -1, 0}, {0, 1, -1, 0}, {1, 0, 0, -1},
+};
+
+}  // namespace
+
+void FieldOfView::mark(int row, int col) {
+    uint32_t& s = stamp[static_cast<size_t>(row) * cols + col];
+    if (s == generation) return;  // octant edges overlap
+    s = generation;
+    tiles.push_back({row, col});
+}
+
+const std::vector<PathPoint>& FieldOfView::compute(const TileGrid& grid, const TileProperties& props,
+                                                   PathPoint origin, int radius) {
+    if (grid.rows() != rows || grid.cols() != cols) {
+        rows = grid.rows();
+        cols = grid.cols();
+        stamp.assign(grid.size(), 0);
+        generation = 0;
+    }
+    if (++generation == 0) {  // wrapped, old stamps could collide
+        std::fill(stamp.begin(), stamp.end(), 0);
+        generation = 1;
+    }
+    tiles.clear();
+    if (!grid.inBounds(origin.row, origin.col)) return tiles;
+
+    mark(origin.row, origin.col);
+    for (const auto& o : OCTANTS)
+        castLight(grid, props, origin, radius, 1, 1.f, 0.f, o[0], o[1], o[2], o[3]);
+    return tiles;
+}
+
+void FieldOfView::castLight(const TileGrid& grid, const TileProperties& props, PathPoint origin, int radius,
+                            int distance, float startSlope, float endSlope, int xx, int xy, int yx, int yy) {
+    if (startSlope < endSlope) return;
+    const int radiusSq = radius * radius;
+
+    for (int d = distance; d <= radius; ++d) {
+        bool blocked = false;
+        float nextStart = startSlope;
+        int dy = -d;
+        for (int dx = -d; dx <= 0; ++dx) {
+            // Slopes through the tile's outer corners
+            float leftSlope = (dx - 0.5f) / (dy + 0.5f);
+            float rightSlope = (dx + 0.5f) / (dy - 0.5f);
+            if (startSlope < rightSlope) continue;
+            if (endSlope > leftSlope) break;
+
+            int col = origin.col + dx * xx + dy * xy;
+            int row = origin.row + dx * yx + dy * yy;
+            bool inside = row >= 0 && row < rows && col >= 0 && col < cols;
+            if (inside && dx * dx + dy * dy <= radiusSq) mark(row, col);
+            bool opaque = !inside || props.isOpaque(grid.at(row, col));
+
+            if (blocked) {
+                if (opaque) {
+                    nextStart = rightSlope;
+                    continue;
+                }
+                blocked = false;
+                startSlope = nextStart;
+            } else if (opaque && d < radius) {
+                blocked = true;
+                castLight(grid, props, origin, radius, d + 1, startSlope, leftSlope, xx, xy, yx, yy);
+                nextStart = rightSlope;
+            }
+        }
+        if (blocked) break;
+    }
+}
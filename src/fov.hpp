@@ -0,0 +1,41 @@
+// Field of view by recursive shadowcasting
+//
+// Each of the eight octants is scanned row by row outwards from the origin;
+// opaque tiles narrow the slope window and split it into recursive calls.
+// Work is proportional to the tiles examined inside the radius, and the
+// visibility stamps are reused between calls, so moving the origin costs no
+// allocation once the buffers have grown to the map size.
+
+#pragma once
+
+#include "pathfinding.hpp"
+#include "tile_grid.hpp"
+#include "tile_properties.hpp"
+
+#include <cstdint>
+#include <vector>
+
+class FieldOfView {
+public:
+    // Tiles visible from origin within a circle of the given radius, origin
+    // included, each listed once. Opaque tiles that bound the view count as
+    // visible (you see the wall).
+    const std::vector<PathPoint>& compute(const TileGrid& grid, const TileProperties& props, PathPoint origin,
+                                          int radius);
+
+    bool isVisible(int row, int col) const {
+        return row >= 0 && row < rows && col >= 0 && col < cols &&
+               stamp[static_cast<size_t>(row) * cols + col] == generation;
+    }
+    const std::vector<PathPoint>& visible() const { return tiles; }
+
+private:
+    int rows = 0, cols = 0;
+    std::vector<uint32_t> stamp;
+    uint32_t generation = 0;
+    std::vector<PathPoint> tiles;
+
+    void mark(int row, int col);
+    void castLight(const TileGrid& grid, const TileProperties& props, PathPoint origin, int radius, int distance,
+                   float startSlope, float endSlope, int xx, int xy, int yx, int yy);
+};
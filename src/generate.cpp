@@ -0,0 +1,131 @@
+#include "generate.hpp"
+#include "bit_grid.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// splitmix64 finaliser over a (seed, x, y) key
+uint64_t hash3(uint64_t seed, int64_t x, int64_t y) {
+    uint64_t z = seed ^ (static_cast<uint64_t>(x) * 0x9E3779B97F4A7C15ULL) ^ (static_cast<uint64_t>(y) * 0xC2B2AE3D27D4EB4FULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1)
+float unitFloat(uint64_t h) {
+    return static_cast<float>(h >> 40) * (1.f / 16777216.f);
+}
+
+float smooth(float t) { return t * t * (3.f - 2.f * t); }
+
+// Add one octave of value noise for row y to acc[0..width). The lattice
+// corners only change every 1/freq tiles, so they are hashed once per
+// lattice cell instead of once per tile.
+void addOctave(float* acc, int width, int x0, int y, uint64_t seed, float freq, float amp) {
+    float fy = y * freq;
+    int64_t iy = static_cast<int64_t>(std::floor(fy));
+    float ty = smooth(fy - static_cast<float>(iy));
+
+    float fx = x0 * freq;
+    int64_t ix = static_cast<int64_t>(std::floor(fx));
+    float tx = fx - static_cast<float>(ix);
+    float top0 = 0.f, top1 = 0.f, bottom0 = 0.f, bottom1 = 0.f;
+    bool stale = true;
+    for (int c = 0; c < width; ++c, tx += freq) {
+        if (tx >= 1.f) {
+            float whole = std::floor(tx);
+            ix += static_cast<int64_t>(whole);
+            tx -= whole;
+            stale = true;
+        }
+        if (stale) {
+            stale = false;
+            top0 = unitFloat(hash3(seed, ix, iy));
+            top1 = unitFloat(hash3(seed, ix + 1, iy));
+            bottom0 = unitFloat(hash3(seed, ix, iy + 1));
+            bottom1 = unitFloat(hash3(seed, ix + 1, iy + 1));
+        }
+        float sx = smooth(tx);
+        float top = top0 + (top1 - top0) * sx, bottom = bottom0 + (bottom1 - bottom0) * sx;
+        acc[c] += amp * (top + (bottom - top) * ty);
+    }
+}
+
+}  // namespace
+
+void generateNoise(TileGrid& grid, const GenRect& area, const NoiseParams& params) {
+    float baseFreq = 1.f / std::max(1.f, params.scale);
+    float norm = 0.f;
+    for (int o = 0, amp = 1; o < params.octaves; ++o, amp *= 2) norm += 1.f / amp;
+
+    float cutoff = params.threshold * norm;
+
+    parallelForRows(area.height, [&](int begin, int end) {
+        std::vector<float> acc(area.width);
+        for (int r = begin; r < end; ++r) {
+            std::fill(acc.begin(), acc.end(), 0.f);
+            float freq = baseFreq, amp = 1.f;
+            for (int o = 0; o < params.octaves; ++o) {
+                addOctave(acc.data(), area.width, area.left, area.top + r, params.seed + o, freq, amp);
+                freq *= 2.f;
+                amp *= 0.5f;
+            }
+            Tile* line = grid.row(area.top + r) + area.left;
+            for (int c = 0; c < area.width; ++c)
+                line[c] = acc[c] >= cutoff ? params.solid : params.empty;
+        }
+    }, 16);
+}
+
+void generateCaves(TileGrid& grid, const GenRect& area, const CaveParams& params) {
+    int h = area.height, w = area.width;
+    if (h <= 0 || w <= 0) return;
+
+    BitGrid walls(h, w);
+    uint64_t threshold = static_cast<uint64_t>(std::clamp(params.fill, 0.f, 1.f) * 4294967296.0);
+    parallelForRows(h, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            uint64_t* line = walls.row(r);
+            for (int c = 0; c < w; ++c) {
+                bool wall = (hash3(params.seed, area.left + c, area.top + r) >> 32) < threshold;
+                line[c >> 6] |= uint64_t(wall) << (c & 63);
+            }
+        }
+    }, 16);
+
+    // Both rules count the 3x3 block with the tile itself; everything
+    // outside the area counts as wall
+    for (int it = 0; it < params.iterations; ++it) {
+        BitGrid stay = walls.atLeast(params.survival, true, true);
+        BitGrid next = walls.atLeast(params.birth, true, true);
+        stay &= walls;
+        next.subtract(walls);
+        next |= stay;
+        walls = std::move(next);
+    }
+
+    parallelForRows(h, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            Tile* line = grid.row(area.top + r) + area.left;
+            for (int c = 0; c < w; ++c)
+                line[c] = walls.get(r, c) ? params.solid : params.empty;
+        }
+    }, 16);
+}
+
+void generateScatter(TileGrid& grid, const GenRect& area, uint64_t seed, float density, Tile tile) {
+    uint64_t threshold = static_cast<uint64_t>(std::clamp(density, 0.f, 1.f) * 4294967296.0);
+    parallelForRows(area.height, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            Tile* line = grid.row(area.top + r) + area.left;
+            for (int c = 0; c < area.width; ++c)
+                if ((hash3(seed, area.left + c, area.top + r) >> 32) < threshold)
+                    line[c] = tile;
+        }
+    }, 16);
+}
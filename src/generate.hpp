@@ -0,0 +1,44 @@
+// Procedural fills for level prototyping
+//
+// All generators work on a rectangle of the grid, are split over row bands
+// and derive every random value from (seed, x, y), so the result doesn't
+// depend on how many threads ran it.
+
+#pragma once
+
+#include "tile_grid.hpp"
+
+#include <cstdint>
+
+struct GenRect {
+    int top, left, height, width;
+};
+
+struct NoiseParams {
+    uint64_t seed = 1;
+    float scale = 16.f;      // tiles per lattice cell of the first octave
+    int octaves = 4;
+    float threshold = 0.5f;  // noise >= threshold becomes `solid`
+    Tile solid = '#';
+    Tile empty = EMPTY_TILE;
+};
+
+struct CaveParams {
+    uint64_t seed = 1;
+    float fill = 0.45f;      // initial chance of a wall
+    int iterations = 5;
+    int birth = 5;           // walls in the 3x3 block (incl. self) to become a wall
+    int survival = 4;        // ...to stay a wall
+    Tile solid = '#';
+    Tile empty = EMPTY_TILE;
+};
+
+// Thresholded fractal value noise
+void generateNoise(TileGrid& grid, const GenRect& area, const NoiseParams& params);
+
+// Random fill followed by `iterations` cellular-automata smoothing steps.
+// Tiles outside the area count as walls, so caves stay closed.
+void generateCaves(TileGrid& grid, const GenRect& area, const CaveParams& params);
+
+// Set each tile to `tile` with probability `density`, leaving the rest
+void generateScatter(TileGrid& grid, const GenRect& area, uint64_t seed, float density, Tile tile);
@@ -0,0 +1,435 @@
+#include "hpa.hpp"
+
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+namespace {
+
+const float INF = std::numeric_limits<float>::infinity();
+const float SQRT2 = 1.41421356f;
+
+float octile(int r0, int c0, int r1, int c1) {
+    int dr = std::abs(r1 - r0), dc = std::abs(c1 - c0);
+    return static_cast<float>(std::max(dr, dc)) + (SQRT2 - 1.f) * static_cast<float>(std::min(dr, dc));
+}
+
+}  // namespace
+
+void HierarchicalPathCache::scanBorder(const TileGrid& grid, const TileProperties& props, int border) {
+    auto& transitions = borders[border];
+    transitions.clear();
+
+    int verticalCount = clusterRows * (clusterCols - 1);
+    bool vertical = border < verticalCount;
+    int cr, cc;
+    if (vertical) {
+        cr = border / (clusterCols - 1);
+        cc = border % (clusterCols - 1);
+    } else {
+        cr = (border - verticalCount) / clusterCols;
+        cc = (border - verticalCount) % clusterCols;
+    }
+
+    // Walk along the border; (r, c) is on the first cluster's side and
+    // (r + dr, c + dc) across it
+    int r, c, len, stepR, stepC, dr, dc;
+    if (vertical) {
+        r = cr * HPA_CLUSTER;
+        c = (cc + 1) * HPA_CLUSTER - 1;
+        len = std::min(HPA_CLUSTER, rows - r);
+        stepR = 1, stepC = 0, dr = 0, dc = 1;
+    } else {
+        r = (cr + 1) * HPA_CLUSTER - 1;
+        c = cc * HPA_CLUSTER;
+        len = std::min(HPA_CLUSTER, cols - c);
+        stepR = 0, stepC = 1, dr = 1, dc = 0;
+    }
+
+    auto open = [&](int i) {
+        int r0 = r + i * stepR, c0 = c + i * stepC;
+        return props.isPassable(grid.at(r0, c0)) && props.isPassable(grid.at(r0 + dr, c0 + dc));
+    };
+    auto add = [&](int i) {
+        int r0 = r + i * stepR, c0 = c + i * stepC;
+        transitions.push_back({static_cast<int>(grid.index(r0, c0)), static_cast<int>(grid.index(r0 + dr, c0 + dc))});
+    };
+
+    for (int i = 0; i < len;) {
+        if (!open(i)) {
+            ++i;
+            continue;
+        }
+        int start = i;
+        while (i < len && open(i)) ++i;
+        int end = i - 1;
+        if (end - start + 1 >= 6) {
+            add(start);
+            add(end);
+        } else {
+            add((start + end) / 2);
+        }
+    }
+}
+
+bool HierarchicalPathCache::collectNodes(int cluster) {
+    int cr = cluster / clusterCols, cc = cluster % clusterCols;
+    std::vector<std::pair<int, int>> links;  // (node tile, partner tile)
+    auto take = [&](int border, bool firstSide) {
+        for (const auto& t : borders[border])
+            links.emplace_back(firstSide ? t.a : t.b, firstSide ? t.b : t.a);
+    };
+    if (cc > 0) take(verticalBorder(cr, cc - 1), false);
+    if (cc < clusterCols - 1) take(verticalBorder(cr, cc), true);
+    if (cr > 0) take(horizontalBorder(cr - 1, cc), false);
+    if (cr < clusterRows - 1) take(horizontalBorder(cr, cc), true);
+    std::sort(links.begin(), links.end());
+
+    Cluster& cl = clusters[cluster];
+    std::vector<int> nodes;
+    std::vector<std::vector<int>> partners;
+    for (const auto& [node, partner] : links) {
+        if (nodes.empty() || nodes.back() != node) {
+            nodes.push_back(node);
+            partners.emplace_back();
+        }
+        partners.back().push_back(partner);
+    }
+    bool changed = nodes != cl.nodes;
+    cl.nodes = std::move(nodes);
+    cl.partners = std::move(partners);
+    return changed;
+}
+
+HierarchicalPathCache::ClusterPlane HierarchicalPathCache::clusterPlane(const TileGrid& grid,
+                                                                      const TileProperties& props,
+                                                                      int cluster) const {
+    ClusterPlane plane;
+    plane.top = (cluster / clusterCols) * HPA_CLUSTER;
+    plane.left = (cluster % clusterCols) * HPA_CLUSTER;
+    plane.height = std::min(HPA_CLUSTER, rows - plane.top);
+    plane.width = std::min(HPA_CLUSTER, cols - plane.left);
+    int stride = plane.width + 2;
+    plane.open.assign(static_cast<size_t>(plane.height + 2) * stride, 0);
+    for (int r = 0; r < plane.height; ++r) {
+        const Tile* src = grid.row(plane.top + r) + plane.left;
+        uint8_t* dst = &plane.open[(r + 1) * stride + 1];
+        for (int c = 0; c < plane.width; ++c) dst[c] = props.isPassable(src[c]);
+    }
+    return plane;
+}
+
+void HierarchicalPathCache::planeDijkstra(const ClusterPlane& plane, int source, const std::vector<int>& targets,
+                                          std::vector<float>& dist) {
+    const int stride = plane.width + 2;
+    const uint8_t* open = plane.open.data();
+
+    dist.assign(plane.open.size(), INF);
+    if (!open[source]) return;
+
+    std::vector<uint8_t> wanted(plane.open.size(), 0);
+    size_t remaining = 0;
+    for (int t : targets)
+        if (!wanted[t]) {
+            wanted[t] = 1;
+            ++remaining;
+        }
+
+    using Entry = std::pair<float, int>;
+    std::vector<Entry> heap;
+    heap.reserve(plane.open.size());
+    dist[source] = 0.f;
+    heap.push_back({0.f, source});
+
+    while (!heap.empty() && remaining > 0) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<Entry>());
+        auto [d, cell] = heap.back();
+        heap.pop_back();
+        if (d > dist[cell]) continue;
+        if (wanted[cell]) {
+            wanted[cell] = 0;
+            --remaining;
+        }
+
+        auto relax = [&](int next, float nd) {
+            if (nd < dist[next]) {
+                dist[next] = nd;
+                heap.push_back({nd, next});
+                std::push_heap(heap.begin(), heap.end(), std::greater<Entry>());
+            }
+        };
+        for (int step : {-stride, stride, -1, 1})
+            if (open[cell + step]) relax(cell + step, d + 1.f);
+        for (int v : {-stride, stride})
+            for (int h : {-1, 1})
+                if (open[cell + v + h] && open[cell + v] && open[cell + h]) relax(cell + v + h, d + SQRT2);
+    }
+}
+
+void HierarchicalPathCache::computeDistances(const TileGrid& grid, const TileProperties& props, int cluster) {
+    Cluster& cl = clusters[cluster];
+    size_t n = cl.nodes.size();
+    cl.dist.assign(n * n, INF);
+    for (size_t i = 0; i < n; ++i) cl.dist[i * n + i] = 0.f;
+    if (n < 2) return;
+
+    ClusterPlane plane = clusterPlane(grid, props, cluster);
+    std::vector<int> cells(n);
+    for (size_t i = 0; i < n; ++i) cells[i] = plane.cell(cl.nodes[i], cols);
+
+    // Distances are symmetric, so each search only has to reach the nodes
+    // after its own
+    std::vector<int> targets;
+    std::vector<float> field;
+    for (size_t i = 0; i + 1 < n; ++i) {
+        targets.assign(cells.begin() + i + 1, cells.end());
+        planeDijkstra(plane, cells[i], targets, field);
+        for (size_t j = i + 1; j < n; ++j) cl.dist[i * n + j] = cl.dist[j * n + i] = field[cells[j]];
+    }
+}
+
+void HierarchicalPathCache::rebuild(const TileGrid& grid, const TileProperties& props) {
+    rows = grid.rows();
+    cols = grid.cols();
+    clusterRows = (rows + HPA_CLUSTER - 1) / HPA_CLUSTER;
+    clusterCols = (cols + HPA_CLUSTER - 1) / HPA_CLUSTER;
+    borders.assign(static_cast<size_t>(clusterRows) * (clusterCols - 1) +
+                   static_cast<size_t>(clusterRows - 1) * clusterCols, {});
+    clusters.assign(static_cast<size_t>(clusterRows) * clusterCols, {});
+
+    for (size_t b = 0; b < borders.size(); ++b) scanBorder(grid, props, static_cast<int>(b));
+    parallelForRows(
+        clusterRows,
+        [&](int begin, int end) {
+            for (int c = begin * clusterCols; c < end * clusterCols; ++c) {
+                collectNodes(c);
+                computeDistances(grid, props, c);
+            }
+        },
+        4);
+    lastRebuilt = static_cast<int>(clusters.size());
+}
+
+void HierarchicalPathCache::markDirty(int row, int col) {
+    if (row < 0 || row >= rows || col < 0 || col >= cols) return;
+    clusters[clusterOf(row, col)].dirty = true;
+}
+
+void HierarchicalPathCache::refresh(const TileGrid& grid, const TileProperties& props) {
+    if (grid.rows() != rows || grid.cols() != cols) {
+        rebuild(grid, props);
+        return;
+    }
+
+    lastRebuilt = 0;
+    std::vector<int> dirty;
+    for (size_t c = 0; c < clusters.size(); ++c)
+        if (clusters[c].dirty) dirty.push_back(static_cast<int>(c));
+    if (dirty.empty()) return;
+
+    for (int c : dirty) {
+        int cr = c / clusterCols, cc = c % clusterCols;
+        if (cc > 0) scanBorder(grid, props, verticalBorder(cr, cc - 1));
+        if (cc < clusterCols - 1) scanBorder(grid, props, verticalBorder(cr, cc));
+        if (cr > 0) scanBorder(grid, props, horizontalBorder(cr - 1, cc));
+        if (cr < clusterRows - 1) scanBorder(grid, props, horizontalBorder(cr, cc));
+    }
+
+    // Dirty clusters always recompute their distances; neighbours only when
+    // their entrances actually moved
+    for (int c : dirty) {
+        int cr = c / clusterCols, cc = c % clusterCols;
+        collectNodes(c);
+        computeDistances(grid, props, c);
+        clusters[c].dirty = false;
+        ++lastRebuilt;
+
+        const int around[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+        for (const auto& d : around) {
+            int nr = cr + d[0], nc = cc + d[1];
+            if (nr < 0 || nr >= clusterRows || nc < 0 || nc >= clusterCols) continue;
+            int n = nr * clusterCols + nc;
+            if (clusters[n].dirty) continue;  // handled in its own turn
+            if (collectNodes(n)) {
+                computeDistances(grid, props, n);
+                ++lastRebuilt;
+            }
+        }
+    }
+}
+
+void HierarchicalPathCache::reframe(int newRows, int newCols, int rowOffset, int colOffset) {
+    bool whole = rows > 0 && rowOffset >= 0 && colOffset >= 0 && rowOffset % HPA_CLUSTER == 0 &&
+                 colOffset % HPA_CLUSTER == 0 && rowOffset + rows <= newRows && colOffset + cols <= newCols;
+    if (!whole) {
+        rows = cols = 0;  // refresh() rebuilds
+        return;
+    }
+
+    int newClusterRows = (newRows + HPA_CLUSTER - 1) / HPA_CLUSTER;
+    int newClusterCols = (newCols + HPA_CLUSTER - 1) / HPA_CLUSTER;
+    int rowShift = rowOffset / HPA_CLUSTER, colShift = colOffset / HPA_CLUSTER;
+    bool wider = cols % HPA_CLUSTER != 0 && colOffset + cols < newCols;
+    bool taller = rows % HPA_CLUSTER != 0 && rowOffset + rows < newRows;
+    // Row-major order survives the move, so node lists stay sorted
+    auto moveTile = [&](int& tile) { tile = (tile / cols + rowOffset) * newCols + tile % cols + colOffset; };
+
+    std::vector<Cluster> moved(static_cast<size_t>(newClusterRows) * newClusterCols);
+    for (auto& cl : moved) cl.dirty = true;
+    for (int cr = 0; cr < clusterRows; ++cr)
+        for (int cc = 0; cc < clusterCols; ++cc) {
+            Cluster& cl = clusters[cr * clusterCols + cc];
+            for (int& tile : cl.nodes) moveTile(tile);
+            for (auto& list : cl.partners)
+                for (int& tile : list) moveTile(tile);
+            cl.dirty = cl.dirty || (wider && cc == clusterCols - 1) || (taller && cr == clusterRows - 1);
+            moved[(cr + rowShift) * newClusterCols + cc + colShift] = std::move(cl);
+        }
+
+    // Borders between two old clusters move along; every other border
+    // touches a new cluster, which scans it on refresh
+    int newVertical = newClusterRows * (newClusterCols - 1);
+    std::vector<std::vector<Transition>> movedBorders(static_cast<size_t>(newVertical) +
+                                                      static_cast<size_t>(newClusterRows - 1) * newClusterCols);
+    auto moveBorder = [&](int from, int to) {
+        for (auto& t : borders[from]) {
+            moveTile(t.a);
+            moveTile(t.b);
+        }
+        movedBorders[to] = std::move(borders[from]);
+    };
+    for (int cr = 0; cr < clusterRows; ++cr)
+        for (int cc = 0; cc + 1 < clusterCols; ++cc)
+            moveBorder(verticalBorder(cr, cc), (cr + rowShift) * (newClusterCols - 1) + cc + colShift);
+    for (int cr = 0; cr + 1 < clusterRows; ++cr)
+        for (int cc = 0; cc < clusterCols; ++cc)
+            moveBorder(horizontalBorder(cr, cc), newVertical + (cr + rowShift) * newClusterCols + cc + colShift);
+
+    clusters.swap(moved);
+    borders.swap(movedBorders);
+    rows = newRows;
+    cols = newCols;
+    clusterRows = newClusterRows;
+    clusterCols = newClusterCols;
+}
+
+bool HierarchicalPathCache::findPath(const TileGrid& grid, const TileProperties& props, PathPoint start,
+                                     PathPoint goal, std::vector<PathPoint>& waypoints, float& length) const {
+    waypoints.clear();
+    length = 0.f;
+    if (!grid.inBounds(start.row, start.col) || !grid.inBounds(goal.row, goal.col) ||
+        !props.isPassable(grid.at(start.row, start.col)) || !props.isPassable(grid.at(goal.row, goal.col)))
+        return false;
+
+    int startTile = static_cast<int>(grid.index(start.row, start.col));
+    int goalTile = static_cast<int>(grid.index(goal.row, goal.col));
+    int startCluster = clusterOf(start.row, start.col), goalCluster = clusterOf(goal.row, goal.col);
+
+    // Connect start and goal to the nodes of their clusters
+    ClusterPlane startPlane = clusterPlane(grid, props, startCluster);
+    ClusterPlane goalPlane = clusterPlane(grid, props, goalCluster);
+    std::vector<int> targets;
+    for (int tile : clusters[startCluster].nodes) targets.push_back(startPlane.cell(tile, cols));
+    if (startCluster == goalCluster) targets.push_back(startPlane.cell(goalTile, cols));
+    std::vector<float> fromStart, toGoal;
+    planeDijkstra(startPlane, startPlane.cell(startTile, cols), targets, fromStart);
+    targets.clear();
+    for (int tile : clusters[goalCluster].nodes) targets.push_back(goalPlane.cell(tile, cols));
+    planeDijkstra(goalPlane, goalPlane.cell(goalTile, cols), targets, toGoal);
+    auto startDistance = [&](int tile) { return fromStart[startPlane.cell(tile, cols)]; };
+    auto goalDistance = [&](int tile) { return toGoal[goalPlane.cell(tile, cols)]; };
+
+    // A* over the abstract graph; the goal tile is a virtual node (key -1)
+    std::unordered_map<int, float> g;
+    std::unordered_map<int, int> parent;
+    using Entry = std::pair<float, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    auto push = [&](int tile, int from, float cost) {
+        auto it = g.find(tile);
+        if (it != g.end() && it->second <= cost) return;
+        g[tile] = cost;
+        parent[tile] = from;
+        float h = tile < 0 ? 0.f : octile(tile / cols, tile % cols, goal.row, goal.col);
+        open.push({cost + h, tile});
+    };
+
+    if (startCluster == goalCluster) {
+        float direct = startDistance(goalTile);
+        if (direct < INF) push(-1, startTile, direct);
+    }
+    const Cluster& sc = clusters[startCluster];
+    for (size_t i = 0; i < sc.nodes.size(); ++i) {
+        float d = startDistance(sc.nodes[i]);
+        if (d < INF) push(sc.nodes[i], startTile, d);
+    }
+
+    bool found = false;
+    while (!open.empty()) {
+        auto [f, tile] = open.top();
+        open.pop();
+        float cost = g[tile];
+        if (tile >= 0 && f > cost + octile(tile / cols, tile % cols, goal.row, goal.col) + 1e-4f) continue;  // stale
+        if (tile < 0) {
+            found = true;
+            break;
+        }
+
+        int cluster = clusterOf(tile / cols, tile % cols);
+        const Cluster& cl = clusters[cluster];
+        size_t i = std::lower_bound(cl.nodes.begin(), cl.nodes.end(), tile) - cl.nodes.begin();
+        if (i == cl.nodes.size() || cl.nodes[i] != tile) continue;
+        size_t n = cl.nodes.size();
+        for (size_t j = 0; j < n; ++j)
+            if (j != i && cl.dist[i * n + j] < INF) push(cl.nodes[j], tile, cost + cl.dist[i * n + j]);
+        for (int partner : cl.partners[i]) push(partner, tile, cost + 1.f);
+        if (cluster == goalCluster) {
+            float d = goalDistance(tile);
+            if (d < INF) push(-1, tile, cost + d);
+        }
+    }
+    if (!found) return false;
+
+    length = g[-1];
+    waypoints.push_back(goal);
+    for (int tile = parent[-1]; tile != startTile; tile = parent[tile])
+        waypoints.push_back({tile / cols, tile % cols});
+    waypoints.push_back(start);
+    std::reverse(waypoints.begin(), waypoints.end());
+    return true;
+}
+
+size_t HierarchicalPathCache::nodeCount() const {
+    size_t n = 0;
+    for (const auto& cl : clusters) n += cl.nodes.size();
+    return n;
+}
+
+json HierarchicalPathCache::exportGraph() const {
+    std::unordered_map<int, int> id;
+    json nodes = json::array(), edges = json::array();
+    for (const auto& cl : clusters)
+        for (int tile : cl.nodes) {
+            id[tile] = static_cast<int>(nodes.size());
+            nodes.push_back({tile / cols, tile % cols});
+        }
+
+    for (const auto& cl : clusters) {
+        size_t n = cl.nodes.size();
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = i + 1; j < n; ++j)
+                if (cl.dist[i * n + j] < INF)
+                    edges.push_back({id[cl.nodes[i]], id[cl.nodes[j]], cl.dist[i * n + j]});
+            for (int partner : cl.partners[i])
+                if (cl.nodes[i] < partner)
+                    edges.push_back({id[cl.nodes[i]], id[partner], 1.0});
+        }
+    }
+
+    return {{"cluster_size", HPA_CLUSTER}, {"rows", rows}, {"cols", cols}, {"nodes", nodes}, {"edges", edges}};
+}
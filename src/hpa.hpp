@@ -0,0 +1,90 @@
+// Hierarchical path cache (HPA*) for long-range queries on big maps
+//
+// The map is cut into HPA_CLUSTER x HPA_CLUSTER clusters. Along each border
+// between two clusters, every run of tiles that is open on both sides is an
+// entrance with one transition (two for runs of 6+ tiles, at its ends). The
+// transition tiles are the abstract nodes; inside a cluster they are joined
+// by their 8-connected distances (no corner cutting, like PathFinder).
+//
+// Edits mark their cluster dirty. refresh() recomputes the borders of dirty
+// clusters and the intra-cluster distances of those clusters, plus any
+// neighbour whose nodes changed as a result; the rest of the graph is kept.
+
+#pragma once
+
+#include "nlohmann/json.hpp"
+#include "pathfinding.hpp"
+#include "tile_grid.hpp"
+#include "tile_properties.hpp"
+
+#include <cstdint>
+#include <vector>
+
+const int HPA_CLUSTER = 32;
+
+class HierarchicalPathCache {
+public:
+    void rebuild(const TileGrid& grid, const TileProperties& props);
+    void markDirty(int row, int col);
+    void refresh(const TileGrid& grid, const TileProperties& props);
+
+    // The map grew, its old (0, 0) now at (rowOffset, colOffset). Moved by
+    // whole clusters, the old graph is kept (renumbered) and the next
+    // refresh() handles the new clusters like edited ones, along with old
+    // edge clusters that grew; any other change leaves that to a rebuild.
+    void reframe(int newRows, int newCols, int rowOffset, int colOffset);
+
+    // Near-optimal path as waypoints (start, transition tiles, goal).
+    // False if the goal is unreachable.
+    bool findPath(const TileGrid& grid, const TileProperties& props, PathPoint start, PathPoint goal,
+                  std::vector<PathPoint>& waypoints, float& length) const;
+
+    // Abstract graph for the game runtime: nodes as [row, col] and edges as
+    // [from, to, cost] (each undirected edge once)
+    nlohmann::json exportGraph() const;
+
+    size_t nodeCount() const;
+    int clustersRebuilt() const { return lastRebuilt; }
+
+private:
+    struct Transition {
+        int a, b;  // tile indices on either side of the border
+    };
+
+    struct Cluster {
+        std::vector<int> nodes;                  // tile indices, sorted
+        std::vector<float> dist;                 // nodes x nodes, INF if unreachable
+        std::vector<std::vector<int>> partners;  // per node: tiles across a border
+        bool dirty = false;
+    };
+
+    int rows = 0, cols = 0, clusterRows = 0, clusterCols = 0;
+    std::vector<std::vector<Transition>> borders;  // vertical ones first, then horizontal
+    std::vector<Cluster> clusters;
+    int lastRebuilt = 0;
+
+    int clusterOf(int row, int col) const { return (row / HPA_CLUSTER) * clusterCols + col / HPA_CLUSTER; }
+    int verticalBorder(int cr, int cc) const { return cr * (clusterCols - 1) + cc; }  // between cc and cc+1
+    int horizontalBorder(int cr, int cc) const {                                      // between cr and cr+1
+        return clusterRows * (clusterCols - 1) + cr * clusterCols + cc;
+    }
+
+    void scanBorder(const TileGrid& grid, const TileProperties& props, int border);
+    // Returns true if the node set changed
+    bool collectNodes(int cluster);
+    void computeDistances(const TileGrid& grid, const TileProperties& props, int cluster);
+
+    // One cluster's passability with a closed one-tile frame, so the search
+    // needs no bounds checks
+    struct ClusterPlane {
+        int top, left, height, width;
+        std::vector<uint8_t> open;
+        int cell(int tile, int cols) const { return (tile / cols - top + 1) * (width + 2) + tile % cols - left + 1; }
+    };
+    ClusterPlane clusterPlane(const TileGrid& grid, const TileProperties& props, int cluster) const;
+
+    // Distances from source to the plane's cells, 8-connected without corner
+    // cutting; stops once every target cell is settled
+    static void planeDijkstra(const ClusterPlane& plane, int source, const std::vector<int>& targets,
+                              std::vector<float>& dist);
+};
@@ -0,0 +1,113 @@
+#include "layer_render.hpp"
+
+#include <algorithm>
+
+void LayerRenderCache::setStyle(const sf::Font* f, const Palette* p, unsigned size, sf::Color c, sf::Vector2f a,
+                                bool skip) {
+    font = f;
+    palette = p;
+    characterSize = size;
+    color = c;
+    anchor = a;
+    skipEmpty = skip;
+    std::fill(dirty.begin(), dirty.end(), 1);
+}
+
+void LayerRenderCache::reset(int rows, int cols) {
+    blockRows = (rows + RENDER_CHUNK - 1) / RENDER_CHUNK;
+    blockCols = (cols + RENDER_CHUNK - 1) / RENDER_CHUNK;
+    blocks.assign(static_cast<size_t>(blockRows) * blockCols, sf::VertexArray(sf::Triangles));
+    dirty.assign(blocks.size(), 1);
+}
+
+void LayerRenderCache::reframe(int rows, int cols, int rowOffset, int colOffset) {
+    int oldRows = blockRows, oldCols = blockCols;
+    int newRows = (rows + RENDER_CHUNK - 1) / RENDER_CHUNK, newCols = (cols + RENDER_CHUNK - 1) / RENDER_CHUNK;
+    int rowShift = rowOffset / RENDER_CHUNK, colShift = colOffset / RENDER_CHUNK;
+    if (rowOffset < 0 || colOffset < 0 || rowOffset % RENDER_CHUNK != 0 || colOffset % RENDER_CHUNK != 0 ||
+        rowShift + oldRows > newRows || colShift + oldCols > newCols) {
+        reset(rows, cols);
+        return;
+    }
+    std::vector<sf::VertexArray> moved(static_cast<size_t>(newRows) * newCols, sf::VertexArray(sf::Triangles));
+    std::vector<uint8_t> marks(moved.size(), 1);
+    for (int br = 0; br < oldRows; ++br)
+        for (int bc = 0; bc < oldCols; ++bc) {
+            int from = br * oldCols + bc, to = (br + rowShift) * newCols + bc + colShift;
+            moved[to] = std::move(blocks[from]);
+            // The last row/column may have been partial
+            marks[to] = dirty[from] || (br == oldRows - 1 && rowShift + oldRows < newRows) ||
+                        (bc == oldCols - 1 && colShift + oldCols < newCols);
+        }
+    blocks.swap(moved);
+    dirty.swap(marks);
+    blockRows = newRows;
+    blockCols = newCols;
+}
+
+void LayerRenderCache::markDirty(int row, int col) {
+    if (row < 0 || col < 0 || row / RENDER_CHUNK >= blockRows || col / RENDER_CHUNK >= blockCols) return;
+    dirty[(row / RENDER_CHUNK) * blockCols + col / RENDER_CHUNK] = 1;
+}
+
+void LayerRenderCache::build(const LayerStack& layers, int layer, int tileSize, int block) {
+    int top = (block / blockCols) * RENDER_CHUNK, left = (block % blockCols) * RENDER_CHUNK;
+    int bottom = std::min(layers.rows(), top + RENDER_CHUNK), right = std::min(layers.cols(), left + RENDER_CHUNK);
+    sf::VertexArray& quads = blocks[block];
+    quads.clear();
+
+    // Same one-pixel padding around the glyph as sf::Text uses
+    const float pad = 1.f;
+    Tile line[RENDER_CHUNK];
+    for (int r = top; r < bottom; ++r) {
+        layers.readRow(layer, r, left, right - left, line);
+        for (int c = left; c < right; ++c) {
+            Tile t = line[c - left];
+            if (skipEmpty && t == EMPTY_TILE) continue;
+            uint32_t codePoint = palette->glyph(t);
+            if (codePoint == 0) continue;
+            const sf::Glyph& glyph = font->getGlyph(codePoint, characterSize, false);
+            if (glyph.textureRect.width == 0) continue;  // blank glyph (space)
+
+            float cx = (c - left + anchor.x) * tileSize, cy = (r - top + anchor.y) * tileSize;
+            float x0 = cx - glyph.bounds.width / 2 - pad, x1 = cx + glyph.bounds.width / 2 + pad;
+            float y0 = cy - glyph.bounds.height / 2 - pad, y1 = cy + glyph.bounds.height / 2 + pad;
+            float u0 = glyph.textureRect.left - pad, u1 = glyph.textureRect.left + glyph.textureRect.width + pad;
+            float v0 = glyph.textureRect.top - pad, v1 = glyph.textureRect.top + glyph.textureRect.height + pad;
+
+            quads.append(sf::Vertex({x0, y0}, color, {u0, v0}));
+            quads.append(sf::Vertex({x1, y0}, color, {u1, v0}));
+            quads.append(sf::Vertex({x0, y1}, color, {u0, v1}));
+            quads.append(sf::Vertex({x0, y1}, color, {u0, v1}));
+            quads.append(sf::Vertex({x1, y0}, color, {u1, v0}));
+            quads.append(sf::Vertex({x1, y1}, color, {u1, v1}));
+        }
+    }
+}
+
+void LayerRenderCache::draw(sf::RenderTarget& target, const LayerStack& layers, int layer, int tileSize,
+                            int firstRow, int lastRow, int firstCol, int lastCol) {
+    if (!font || !palette || blocks.empty() || firstRow > lastRow || firstCol > lastCol) return;
+
+    // Geometry first: building can add glyphs to the font texture
+    int br0 = firstRow / RENDER_CHUNK, br1 = lastRow / RENDER_CHUNK;
+    int bc0 = firstCol / RENDER_CHUNK, bc1 = lastCol / RENDER_CHUNK;
+    for (int br = br0; br <= br1; ++br)
+        for (int bc = bc0; bc <= bc1; ++bc) {
+            int block = br * blockCols + bc;
+            if (dirty[block]) {
+                build(layers, layer, tileSize, block);
+                dirty[block] = 0;
+            }
+        }
+
+    sf::RenderStates states;
+    states.texture = &font->getTexture(characterSize);
+    for (int br = br0; br <= br1; ++br)
+        for (int bc = bc0; bc <= bc1; ++bc) {
+            states.transform = sf::Transform();
+            states.transform.translate(static_cast<float>(bc * RENDER_CHUNK * tileSize),
+                                       static_cast<float>(br * RENDER_CHUNK * tileSize));
+            target.draw(blocks[br * blockCols + bc], states);
+        }
+}
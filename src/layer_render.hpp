@@ -0,0 +1,53 @@
+// Cached glyph geometry for drawing one tile layer
+//
+// Glyph quads are kept in RENDER_CHUNK x RENDER_CHUNK blocks of tiles and
+// drawn with the font's glyph texture, one draw call per visible block. A
+// block is only rebuilt after one of its tiles changed, so editing or
+// toggling one layer never rebuilds another layer's geometry. Glyphs are
+// placed relative to their block and drawn at its offset, so a canvas that
+// grows by whole blocks moves them over as they are.
+
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include "layers.hpp"
+#include "palette.hpp"
+
+#include <cstdint>
+#include <vector>
+
+const int RENDER_CHUNK = 32;
+
+class LayerRenderCache {
+public:
+    // Where in the tile the glyph is centred, as fractions of the tile size;
+    // skipEmpty leaves EMPTY_TILE out. Glyphs come from the palette.
+    void setStyle(const sf::Font* font, const Palette* palette, unsigned characterSize, sf::Color color,
+                  sf::Vector2f anchor, bool skipEmpty);
+
+    // Forget all geometry (new dimensions or content)
+    void reset(int rows, int cols);
+    // The map grew, its old (0, 0) now at (rowOffset, colOffset). Moved by
+    // whole blocks, the old ones are kept and only new blocks and old edge
+    // blocks that grew are built again; anything else is a reset.
+    void reframe(int rows, int cols, int rowOffset, int colOffset);
+    void markDirty(int row, int col);
+
+    // Tiles are read row by row, so packed layers draw without unpacking
+    void draw(sf::RenderTarget& target, const LayerStack& layers, int layer, int tileSize, int firstRow,
+              int lastRow, int firstCol, int lastCol);
+
+private:
+    const sf::Font* font = nullptr;
+    const Palette* palette = nullptr;
+    unsigned characterSize = 24;
+    sf::Color color = sf::Color::White;
+    sf::Vector2f anchor{0.5f, 0.5f};
+    bool skipEmpty = false;
+
+    int blockRows = 0, blockCols = 0;
+    std::vector<sf::VertexArray> blocks;
+    std::vector<uint8_t> dirty;
+
+    void build(const LayerStack& layers, int layer, int tileSize, int block);
+};
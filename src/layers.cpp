@@ -0,0 +1,251 @@
+#include "layers.hpp"
+
+#include <algorithm>
+
+LayerStack::LayerStack(int rows, int cols) : nRows(rows), nCols(cols) {
+    for (auto& p : planes) p = TileGrid(rows, cols, EMPTY_TILE);
+}
+
+void LayerStack::setPlane(int layer, TileGrid tiles) {
+    // Other layers keep their storage; terrain given as a dense grid is dense
+    LayerStorage target = layer == LAYER_TERRAIN ? LayerStorage::Dense : storageOf[layer];
+    storageOf[layer] = LayerStorage::Dense;
+    packedPlanes[layer] = PackedGrid();
+    pagedPlanes[layer] = PagedGrid();
+    planes[layer] = std::move(tiles);
+    if (layer == LAYER_TERRAIN) {
+        nRows = planes[layer].rows();
+        nCols = planes[layer].cols();
+    }
+    dropShadow(layer);
+    setStorage(layer, target);
+}
+
+void LayerStack::setPlane(int layer, PagedGrid tiles) {
+    planes[layer] = TileGrid();
+    packedPlanes[layer] = PackedGrid();
+    pagedPlanes[layer] = std::move(tiles);
+    pagedPlanes[layer].setBudget(pageBudget);
+    storageOf[layer] = LayerStorage::Paged;
+    if (layer == LAYER_TERRAIN) {
+        nRows = pagedPlanes[layer].rows();
+        nCols = pagedPlanes[layer].cols();
+    }
+    dropShadow(layer);
+}
+
+void LayerStack::readRow(int layer, int row, int col, int count, Tile* out) const {
+    switch (storageOf[layer]) {
+        case LayerStorage::Packed: packedPlanes[layer].readRow(row, col, count, out); break;
+        case LayerStorage::Paged: pagedPlanes[layer].readRow(row, col, count, out); break;
+        default: std::copy(planes[layer].row(row) + col, planes[layer].row(row) + col + count, out);
+    }
+}
+
+TileGrid LayerStack::copyRegion(int layer, int top, int left, int height, int width) const {
+    TileGrid out(height, width);
+    readRows(layer, top, left, out);
+    return out;
+}
+
+void LayerStack::readRows(int layer, int top, int left, TileGrid& band) const {
+    if (storageOf[layer] == LayerStorage::Paged) {
+        pagedPlanes[layer].readRows(top, left, band);
+        return;
+    }
+    for (int r = 0; r < band.rows(); ++r)
+        readRow(layer, top + r, left, band.cols(), band.row(r));
+}
+
+void LayerStack::makeDense(int layer) {
+    if (storageOf[layer] == LayerStorage::Packed) {
+        // The packed content becomes the shadow as is, nothing to re-encode
+        planes[layer] = packedPlanes[layer].unpack();
+        shadows[layer] = std::move(packedPlanes[layer]);
+        shadowDirty[layer].assign(shadows[layer].chunkCount(), 0);
+        packedPlanes[layer] = PackedGrid();
+    } else if (storageOf[layer] == LayerStorage::Paged) {
+        planes[layer] = pagedPlanes[layer].unpack();
+        pagedPlanes[layer] = PagedGrid();
+    }
+    storageOf[layer] = LayerStorage::Dense;
+}
+
+void LayerStack::setStorage(int layer, LayerStorage storage) {
+    if (storage == storageOf[layer]) return;
+    makeDense(layer);
+    if (storage == LayerStorage::Packed) {
+        packedPlanes[layer] = PackedGrid(planes[layer]);
+    } else if (storage == LayerStorage::Paged) {
+        pagedPlanes[layer] = PagedGrid(planes[layer], pageBudget);
+        if (!pagedPlanes[layer].ok()) {
+            pagedPlanes[layer] = PagedGrid();
+            return;  // stays dense
+        }
+    } else {
+        return;
+    }
+    planes[layer] = TileGrid();
+    storageOf[layer] = storage;
+    dropShadow(layer);
+}
+
+void LayerStack::setPageBudget(size_t budgetBytes) {
+    pageBudget = budgetBytes;
+    for (int l = 0; l < LAYER_COUNT; ++l)
+        if (storageOf[l] == LayerStorage::Paged) pagedPlanes[l].setBudget(budgetBytes);
+}
+
+void LayerStack::prefetch(int top, int left, int bottom, int right) const {
+    for (int l = 0; l < LAYER_COUNT; ++l)
+        if (storageOf[l] == LayerStorage::Paged) pagedPlanes[l].prefetch(top, left, bottom, right);
+}
+
+void LayerStack::dropShadow(int layer) {
+    shadows[layer] = PackedGrid();
+    shadowDirty[layer].clear();
+}
+
+MapSnapshot LayerStack::snapshot() {
+    MapSnapshot snap;
+    for (int l = 0; l < LAYER_COUNT; ++l) {
+        if (storageOf[l] == LayerStorage::Packed) {
+            snap.planes[l] = packedPlanes[l];
+            continue;
+        }
+        if (storageOf[l] == LayerStorage::Paged) {
+            // Streams the layer once; pages have no shared chunks to reuse
+            snap.planes[l] = pagedPlanes[l].snapshot();
+            continue;
+        }
+        if (shadowDirty[l].empty()) {
+            shadows[l] = PackedGrid(planes[l]);
+            shadowDirty[l].assign(shadows[l].chunkCount(), 0);
+        } else {
+            for (int chunk = 0; chunk < shadows[l].chunkCount(); ++chunk)
+                if (shadowDirty[l][chunk]) {
+                    shadows[l].encodeChunk(planes[l], chunk);
+                    shadowDirty[l][chunk] = 0;
+                }
+        }
+        snap.planes[l] = shadows[l];
+    }
+    return snap;
+}
+
+size_t LayerStack::memoryBytes(int layer) const {
+    switch (storageOf[layer]) {
+        case LayerStorage::Packed: return packedPlanes[layer].memoryBytes();
+        case LayerStorage::Paged: return pagedPlanes[layer].residentBytes();
+        default: return sizeof(TileGrid) + planes[layer].size() * sizeof(Tile);
+    }
+}
+
+bool LayerStack::blank(int layer) const {
+    switch (storageOf[layer]) {
+        case LayerStorage::Packed: return packedPlanes[layer].all(EMPTY_TILE);
+        case LayerStorage::Paged: return pagedPlanes[layer].all(EMPTY_TILE);
+        default: {
+            const TileGrid& p = planes[layer];
+            for (int r = 0; r < p.rows(); ++r)
+                if (!std::all_of(p.row(r), p.row(r) + p.cols(), [](Tile t) { return t == EMPTY_TILE; })) return false;
+            return true;
+        }
+    }
+}
+
+bool LayerStack::occupiedBounds(int layer, int& top, int& left, int& bottom, int& right) const {
+    switch (storageOf[layer]) {
+        case LayerStorage::Packed: return packedPlanes[layer].occupiedBounds(top, left, bottom, right);
+        case LayerStorage::Paged: return pagedPlanes[layer].occupiedBounds(top, left, bottom, right);
+        default: break;
+    }
+    const TileGrid& p = planes[layer];
+    bool found = false;
+    for (int r = 0; r < p.rows(); ++r) {
+        const Tile* line = p.row(r);
+        int c0 = 0, c1 = p.cols() - 1;
+        while (c0 <= c1 && line[c0] == EMPTY_TILE) ++c0;
+        if (c0 > c1) continue;
+        while (line[c1] == EMPTY_TILE) --c1;
+        top = found ? top : r;
+        left = found ? std::min(left, c0) : c0;
+        right = found ? std::max(right, c1) : c1;
+        bottom = r;
+        found = true;
+    }
+    return found;
+}
+
+template <typename Fn>
+void LayerStack::forEachDense(Fn&& fn) {
+    for (int l = 0; l < LAYER_COUNT; ++l) {
+        LayerStorage was = storageOf[l];
+        makeDense(l);
+        fn(planes[l]);
+        if (l == LAYER_TERRAIN) {
+            nRows = planes[l].rows();
+            nCols = planes[l].cols();
+        }
+        dropShadow(l);
+        setStorage(l, was);
+    }
+}
+
+void LayerStack::reframe(int newRows, int newCols, int rowOffset, int colOffset) {
+    reframeLayers(newRows, newCols, rowOffset, colOffset, false);
+}
+
+void LayerStack::grow(int up, int down, int left, int right) {
+    reframeLayers(nRows + up + down, nCols + left + right, up, left, true);
+}
+
+void LayerStack::reframeLayers(int newRows, int newCols, int rowOffset, int colOffset, bool spare) {
+    int oldRows = rows(), oldCols = cols();
+    bool whole = rowOffset >= 0 && colOffset >= 0 && rowOffset % PACK_CHUNK == 0 && colOffset % PACK_CHUNK == 0 &&
+                 rowOffset + oldRows <= newRows && colOffset + oldCols <= newCols;
+    for (int l = 0; l < LAYER_COUNT; ++l) {
+        if (storageOf[l] == LayerStorage::Packed) {
+            packedPlanes[l].reframe(newRows, newCols, rowOffset, colOffset);
+            continue;
+        }
+        if (storageOf[l] == LayerStorage::Paged) {
+            if (pagedPlanes[l].reframe(newRows, newCols, rowOffset, colOffset)) continue;
+            makeDense(l);  // no page file for the new frame
+        }
+        if (spare)
+            planes[l].grow(rowOffset, newRows - oldRows - rowOffset, colOffset, newCols - oldCols - colOffset);
+        else
+            planes[l].reframe(newRows, newCols, rowOffset, colOffset);
+
+        // The shadow moves along when that costs nothing; new chunks are
+        // blank in both
+        if (!whole || shadowDirty[l].empty()) {
+            dropShadow(l);
+            continue;
+        }
+        int oldChunkCols = (oldCols + PACK_CHUNK - 1) / PACK_CHUNK;
+        shadows[l].reframe(newRows, newCols, rowOffset, colOffset);
+        std::vector<uint8_t> dirty(shadows[l].chunkCount(), 0);
+        for (size_t chunk = 0; chunk < shadowDirty[l].size(); ++chunk) {
+            int row = static_cast<int>(chunk / oldChunkCols) * PACK_CHUNK + rowOffset;
+            int col = static_cast<int>(chunk % oldChunkCols) * PACK_CHUNK + colOffset;
+            dirty[shadows[l].chunkOf(row, col)] = shadowDirty[l][chunk];
+        }
+        shadowDirty[l].swap(dirty);
+    }
+    nRows = newRows;
+    nCols = newCols;
+}
+
+void LayerStack::crop(int top, int left, int height, int width) {
+    reframe(height, width, -top, -left);
+}
+
+void LayerStack::shift(int dr, int dc, bool wrap) {
+    forEachDense([&](TileGrid& p) { p.shift(dr, dc, wrap, EMPTY_TILE); });
+}
+
+void LayerStack::transform(GridTransform t) {
+    forEachDense([&](TileGrid& p) { transformGrid(p, t); });
+}
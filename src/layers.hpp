@@ -0,0 +1,153 @@
+// Tile layers of one map
+//
+// Every layer is its own contiguous TileGrid of the same size (structure of
+// arrays rather than a struct per tile), so a pass over one layer only
+// streams that layer's bytes. Terrain is the layer autotiling and the
+// analysis tools read.
+//
+// A layer that nothing reads tile by tile can also be stored packed into
+// palette-compressed chunks (packed_grid.hpp) or paged out to disk behind
+// a chunk cache (paged_grid.hpp). Such layers are read and written through
+// get/set/readRow, which work for every storage; plane() is only valid for
+// dense layers. A map too big for memory can have every layer paged,
+// terrain included.
+//
+// snapshot() freezes every layer as packed chunks shared with the live
+// map. Dense layers keep a packed shadow for this; writes made through
+// plane() must be reported with touch() so the next snapshot re-encodes
+// the chunks they landed in, and only those.
+
+#pragma once
+
+#include "packed_grid.hpp"
+#include "paged_grid.hpp"
+#include "tile_grid.hpp"
+#include "transform.hpp"
+
+#include <array>
+
+enum LayerId { LAYER_TERRAIN, LAYER_DECORATION, LAYER_COLLISION, LAYER_TRIGGER, LAYER_COUNT };
+
+inline constexpr const char* LAYER_NAMES[LAYER_COUNT] = {"terrain", "decoration", "collision", "trigger"};
+
+enum class LayerStorage { Dense, Packed, Paged };
+
+struct LayerFlags {
+    bool visible = true;
+    bool locked = false;  // refuses tile edits; structural changes still apply
+};
+
+// Frozen copy of every layer, safe to read from another thread while the
+// map keeps being edited
+struct MapSnapshot {
+    std::array<PackedGrid, LAYER_COUNT> planes;
+
+    int rows() const { return planes[LAYER_TERRAIN].rows(); }
+    int cols() const { return planes[LAYER_TERRAIN].cols(); }
+    bool blank(int layer) const { return planes[layer].all(EMPTY_TILE); }
+};
+
+class LayerStack {
+public:
+    std::array<LayerFlags, LAYER_COUNT> flags;
+
+    LayerStack() = default;
+    LayerStack(int rows, int cols);
+
+    int rows() const { return nRows; }
+    int cols() const { return nCols; }
+
+    // The dense tiles; empty for a layer in another storage
+    TileGrid& plane(int layer) { return planes[layer]; }
+    const TileGrid& plane(int layer) const { return planes[layer]; }
+    void setPlane(int layer, TileGrid tiles);
+    // The layer becomes paged as it is, for maps too big to hold in memory
+    void setPlane(int layer, PagedGrid tiles);
+
+    // Access that works whatever the layer's storage
+    Tile get(int layer, int row, int col) const {
+        switch (storageOf[layer]) {
+            case LayerStorage::Packed: return packedPlanes[layer].get(row, col);
+            case LayerStorage::Paged: return pagedPlanes[layer].get(row, col);
+            default: return planes[layer].at(row, col);
+        }
+    }
+    void set(int layer, int row, int col, Tile t) {
+        switch (storageOf[layer]) {
+            case LayerStorage::Packed: packedPlanes[layer].set(row, col, t); break;
+            case LayerStorage::Paged: pagedPlanes[layer].set(row, col, t); break;
+            default:
+                planes[layer].at(row, col) = t;
+                touch(layer, row, col);
+        }
+    }
+
+    // A tile of a dense layer was written through plane()
+    void touch(int layer, int row, int col) {
+        if (!shadowDirty[layer].empty()) shadowDirty[layer][shadows[layer].chunkOf(row, col)] = 1;
+    }
+
+    // O(chunks) plus the chunks touched since the last snapshot
+    MapSnapshot snapshot();
+    void readRow(int layer, int row, int col, int count, Tile* out) const;
+    // A rectangle of one layer as dense tiles
+    TileGrid copyRegion(int layer, int top, int left, int height, int width) const;
+    // The same into an existing band, for streaming a layer out; paged
+    // layers decode each chunk once, past their cache
+    void readRows(int layer, int top, int left, TileGrid& band) const;
+
+    // Move a layer to another storage; which layers may leave dense
+    // storage is up to the caller
+    void setStorage(int layer, LayerStorage storage);
+    LayerStorage storage(int layer) const { return storageOf[layer]; }
+
+    // Memory budget of each paged layer's chunk cache
+    void setPageBudget(size_t budgetBytes);
+    size_t pageBudgetBytes() const { return pageBudget; }
+
+    // Fault in the paged layers' chunks around the visible area
+    void prefetch(int top, int left, int bottom, int right) const;
+
+    // Resident bytes of a layer's tiles in its current storage
+    size_t memoryBytes(int layer) const;
+
+    // True when every tile of the layer is EMPTY_TILE
+    bool blank(int layer) const;
+    // Smallest rectangle holding every tile of the layer other than
+    // EMPTY_TILE; false when there are none
+    bool occupiedBounds(int layer, int& top, int& left, int& bottom, int& right) const;
+
+    // Structural edits, applied to every layer alike so they stay aligned.
+    // reframe, grow and crop keep each layer in its storage; growing by
+    // whole chunks moves packed and paged chunks (and snapshot shadows)
+    // without copying. grow also leaves dense layers spare room to grow
+    // into (TileGrid::grow), so growing again writes only the new tiles.
+    // shift and transform go through dense copies of every layer.
+    void reframe(int newRows, int newCols, int rowOffset, int colOffset);
+    void grow(int up, int down, int left, int right);
+    void crop(int top, int left, int height, int width);
+    void shift(int dr, int dc, bool wrap);
+    void transform(GridTransform t);
+
+private:
+    int nRows = 0, nCols = 0;
+    std::array<TileGrid, LAYER_COUNT> planes;
+    std::array<PackedGrid, LAYER_COUNT> packedPlanes;
+    std::array<PagedGrid, LAYER_COUNT> pagedPlanes;
+    std::array<LayerStorage, LAYER_COUNT> storageOf{};
+    size_t pageBudget = DEFAULT_PAGE_BUDGET;
+
+    // Packed copies of the dense layers for snapshots; an empty dirty list
+    // means the shadow has to be built from scratch
+    std::array<PackedGrid, LAYER_COUNT> shadows;
+    std::array<std::vector<uint8_t>, LAYER_COUNT> shadowDirty;
+
+    void reframeLayers(int newRows, int newCols, int rowOffset, int colOffset, bool spare);
+    void dropShadow(int layer);
+    void makeDense(int layer);
+
+    // Run a whole-layer operation on dense planes, returning every layer to
+    // its storage afterwards
+    template <typename Fn>
+    void forEachDense(Fn&& fn);
+};
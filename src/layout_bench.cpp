@@ -0,0 +1,198 @@
+#include "layout_bench.hpp"
+#include "generate.hpp"
+#include "tile_layout.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const Tile WALL = '#';
+const int RUNS = 3;
+const int FOV_RADIUS = 24;
+const int FOV_STEP = 16;  // one origin per FOV_STEP x FOV_STEP block
+
+// Storage-order iteration, so the kernels below run unchanged on TileGrid
+template <typename Fn>
+void forEachTile(const TileGrid& grid, Fn&& fn) {
+    for (int r = 0; r < grid.rows(); ++r)
+        for (int c = 0; c < grid.cols(); ++c) fn(r, c, grid.at(r, c));
+}
+template <typename Layout, typename Fn>
+void forEachTile(const ChunkedGrid<Layout>& grid, Fn&& fn) {
+    grid.forEachTile(fn);
+}
+
+// 8-neighbour "same tile" masks as the autotiler builds them; off-map
+// neighbours count as matching
+template <typename Grid>
+uint64_t autotileMasks(const Grid& grid) {
+    uint64_t sum = 0;
+    forEachTile(grid, [&](int r, int c, Tile t) {
+        int mask = 0, bit = 0;
+        for (int dr = -1; dr <= 1; ++dr)
+            for (int dc = -1; dc <= 1; ++dc) {
+                if (!dr && !dc) continue;
+                if (!grid.inBounds(r + dr, c + dc) || grid.at(r + dr, c + dc) == t) mask |= 1 << bit;
+                ++bit;
+            }
+        sum += mask;
+    });
+    return sum;
+}
+
+// One smoothing step of the cave generator: wall when 5+ of the 3x3 block
+// (off-map included) are walls
+template <typename Grid>
+uint64_t cellularStep(const Grid& grid, Grid& out) {
+    uint64_t walls = 0;
+    forEachTile(grid, [&](int r, int c, Tile) {
+        int count = 0;
+        for (int dr = -1; dr <= 1; ++dr)
+            for (int dc = -1; dc <= 1; ++dc)
+                count += !grid.inBounds(r + dr, c + dc) || grid.at(r + dr, c + dc) == WALL;
+        out.at(r, c) = count >= 5 ? WALL : EMPTY_TILE;
+        walls += count >= 5;
+    });
+    return walls;
+}
+
+// 4-connected fill of every open region, seeded in storage order; the
+// visited marks use the same layout as the map
+template <typename Grid>
+uint64_t floodFill(const Grid& grid, Grid& visited) {
+    uint64_t regions = 0;
+    std::vector<std::pair<int, int>> stack;
+    forEachTile(grid, [&](int row, int col, Tile t) {
+        if (t == WALL || visited.at(row, col)) return;
+        ++regions;
+        visited.at(row, col) = 1;
+        stack.emplace_back(row, col);
+        while (!stack.empty()) {
+            auto [r, c] = stack.back();
+            stack.pop_back();
+            const int dr[] = {-1, 1, 0, 0}, dc[] = {0, 0, -1, 1};
+            for (int i = 0; i < 4; ++i) {
+                int nr = r + dr[i], nc = c + dc[i];
+                if (grid.inBounds(nr, nc) && !visited.at(nr, nc) && grid.at(nr, nc) != WALL) {
+                    visited.at(nr, nc) = 1;
+                    stack.emplace_back(nr, nc);
+                }
+            }
+        }
+    });
+    return regions;
+}
+
+// The shadowcasting scan of fov.cpp, counting marks instead of storing them
+template <typename Grid>
+void castLight(const Grid& grid, int originRow, int originCol, int distance, float startSlope, float endSlope,
+               int xx, int xy, int yx, int yy, uint64_t& seen) {
+    if (startSlope < endSlope) return;
+    for (int d = distance; d <= FOV_RADIUS; ++d) {
+        bool blocked = false;
+        float nextStart = startSlope;
+        int dy = -d;
+        for (int dx = -d; dx <= 0; ++dx) {
+            float leftSlope = (dx - 0.5f) / (dy + 0.5f);
+            float rightSlope = (dx + 0.5f) / (dy - 0.5f);
+            if (startSlope < rightSlope) continue;
+            if (endSlope > leftSlope) break;
+
+            int col = originCol + dx * xx + dy * xy;
+            int row = originRow + dx * yx + dy * yy;
+            bool inside = grid.inBounds(row, col);
+            if (inside && dx * dx + dy * dy <= FOV_RADIUS * FOV_RADIUS) ++seen;
+            bool opaque = !inside || grid.at(row, col) == WALL;
+
+            if (blocked) {
+                if (opaque) {
+                    nextStart = rightSlope;
+                    continue;
+                }
+                blocked = false;
+                startSlope = nextStart;
+            } else if (opaque && d < FOV_RADIUS) {
+                blocked = true;
+                castLight(grid, originRow, originCol, d + 1, startSlope, leftSlope, xx, xy, yx, yy, seen);
+                nextStart = rightSlope;
+            }
+        }
+        if (blocked) break;
+    }
+}
+
+template <typename Grid>
+uint64_t fieldOfView(const Grid& grid) {
+    static const int octants[8][4] = {{1, 0, 0, 1},  {0, 1, 1, 0},  {0, -1, 1, 0}, {-1, 0, 0, 1},
+                                      {-1, 0, 0, -1}, {0, -1, -1, 0}, {0, 1, -1, 0}, {1, 0, 0, -1}};
+    uint64_t seen = 0;
+    for (int r = FOV_STEP / 2; r < grid.rows(); r += FOV_STEP)
+        for (int c = FOV_STEP / 2; c < grid.cols(); c += FOV_STEP) {
+            if (grid.at(r, c) == WALL) continue;
+            for (const auto& o : octants) castLight(grid, r, c, 1, 1.f, 0.f, o[0], o[1], o[2], o[3], seen);
+        }
+    return seen;
+}
+
+// Best of RUNS, in milliseconds; the checksum must match across layouts
+template <typename Fn>
+double timeKernel(Fn&& fn, uint64_t& checksum) {
+    double best = 1e30;
+    for (int i = 0; i < RUNS; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        checksum = fn();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+struct Timings {
+    double ms[4];
+    uint64_t checksum[4];
+};
+
+template <typename Grid>
+Timings runKernels(const Grid& grid) {
+    Timings t;
+    Grid scratch = grid;
+    t.ms[0] = timeKernel([&] { return autotileMasks(grid); }, t.checksum[0]);
+    t.ms[1] = timeKernel([&] { return cellularStep(grid, scratch); }, t.checksum[1]);
+    t.ms[2] = timeKernel([&] {
+        Grid visited(grid.rows(), grid.cols(), 0);
+        return floodFill(grid, visited);
+    }, t.checksum[2]);
+    t.ms[3] = timeKernel([&] { return fieldOfView(grid); }, t.checksum[3]);
+    return t;
+}
+
+}  // namespace
+
+void benchmarkLayouts(int size) {
+    TileGrid grid(size, size, EMPTY_TILE);
+    generateCaves(grid, GenRect{0, 0, size, size}, CaveParams());
+    std::cout << "Layout benchmark on a " << size << "x" << size << " cave map (best of " << RUNS << ", ms)\n";
+
+    const char* kernels[] = {"autotile masks", "cellular step", "flood fill", "field of view"};
+    const std::string names[] = {"TileGrid", std::string("chunked ") + RowMajorLayout::NAME,
+                                 std::string("chunked ") + MortonLayout::NAME};
+    Timings results[] = {runKernels(grid), runKernels(ChunkedGrid<RowMajorLayout>(grid)),
+                         runKernels(ChunkedGrid<MortonLayout>(grid))};
+
+    std::cout << std::left << std::setw(16) << "";
+    for (const auto& name : names) std::cout << std::right << std::setw(18) << name;
+    std::cout << "\n" << std::fixed << std::setprecision(2);
+    for (int k = 0; k < 4; ++k) {
+        std::cout << std::left << std::setw(16) << kernels[k];
+        for (const auto& r : results) std::cout << std::right << std::setw(18) << r.ms[k];
+        bool agree = results[1].checksum[k] == results[0].checksum[k] && results[2].checksum[k] == results[0].checksum[k];
+        std::cout << (agree ? "" : "  (results differ!)") << "\n";
+    }
+}
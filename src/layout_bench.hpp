@@ -0,0 +1,11 @@
+// Timing of neighbourhood-heavy kernels on each tile layout
+//
+// Generates a cave map of size x size and runs autotile masks, one
+// cellular-automaton step, a flood fill of every region and shadowcast
+// field of view on TileGrid and on ChunkedGrid with the row-major and
+// Morton layouts, printing the best of a few runs per kernel. Used by
+// STORM --bench-layout.
+
+#pragma once
+
+void benchmarkLayouts(int size);
@@ -3,42 +3,1126 @@
 
 #include <SFML/Graphics.hpp>
 #include "nlohmann/json.hpp"
+#include "autotile.hpp"
+#include "bit_grid.hpp"
+#include "dirty_region.hpp"
+#include "distance_field.hpp"
+#include "edit_session.hpp"
+#include "file_watch.hpp"
+#include "tile_grid.hpp"
+#include "transform.hpp"
+#include "fov.hpp"
+#include "generate.hpp"
+#include "hpa.hpp"
+#include "layer_render.hpp"
+#include "layers.hpp"
+#include "layout_bench.hpp"
+#include "map_document.hpp"
+#include "map_io.hpp"
+#include "palette.hpp"
+#include "pathfinding.hpp"
+#include "pattern_search.hpp"
+#include "regions.hpp"
+#include "selection_mask.hpp"
+#include "tile_properties.hpp"
+#include "validation.hpp"
 #include <iostream>
-#include <fstream>
 #include <vector>
+#include <algorithm>
+#include <unordered_set>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <functional>
+#include <future>
+#include <optional>
 
 using json = nlohmann::json;
 
 const int TILE_SIZE = 32;
+const Tile WILDCARD_TILE = '?';        // matches anything in a search pattern
+const unsigned MAX_WINDOW_SIZE = 1600; // larger maps scroll instead
+const int DENSITY_RADIUS = 4;         // window for the density overlay
+const int MAX_SIGHT_RADIUS = 256;     // for the field-of-view preview
+const int MAX_PAGE_BUDGET_MIB = 65536; // per paged layer
+const int CANVAS_MARGIN = 8;          // tiles of empty canvas shown around the map
+const int MAX_MORPH_STEPS = 64;       // for growing/shrinking solid tiles
+const float AUTOSAVE_SECONDS = 60.f;  // after the first unsaved edit
+const char* const AUTOSAVE_PATH = "map.autosave.json";
+const char* const PAGED_AUTOSAVE_PATH = "map.autosave.stormmap";  // paged maps autosave in binary
+
+// Tile index of a world coordinate, rounding towards -infinity so positions
+// left of/above the map stay out of bounds
+inline int tileIndex(int px) {
+    return px >= 0 ? px / TILE_SIZE : (px - TILE_SIZE + 1) / TILE_SIZE;
+}
+
+// A re-read of the map file, compared on a worker thread against what the
+// editor last read from or wrote to it
+struct ReloadResult {
+    bool ok = false;    // parsed
+    bool fits = false;  // lands on the map as it is; `diffs` are valid
+    MapFile file;
+    std::vector<TileDiff> diffs;
+    int generation = 0;  // reloadGeneration it was started in
+};
+
+// Heatmap overlays, cycled with F6
+enum class Overlay { None, WallDistance, SpawnDistance, Density };
+
+// What a left-button drag does (Ctrl+L / Ctrl+B toggle)
+enum class DragTool { Paint, Lasso, SelectBrush };
 
 class TileMapEditor {
 private:
-    std::vector<std::vector<char>> grid;
+    // Tiles, history and canvas frame; the editor adds the cursor, the
+    // selection and everything on screen. Every tile write goes through
+    // edits (see EditSession); everything derived from the tiles observes it.
+    MapDocument doc;
+    LayerStack& layers = doc.layers;
+    EditSession& edits = doc.edits;
+    TileGrid& grid = layers.plane(LAYER_TERRAIN);  // what autotiling and the analysis tools read
+    int activeLayer = LAYER_TERRAIN;               // tile edits go here
+    LayerStorage idleStorage = LayerStorage::Dense; // layers not being edited (Ctrl+P)
     int rows, cols;
     int selectedRow = 0, selectedCol = 0;
+    bool selecting = false;            // a rectangle from the anchor to the cursor
+    int anchorRow = 0, anchorCol = 0;
+    // Free-form selection from the magic wand, lasso or selection brush.
+    // While set it stands in for the rectangle in fill/replace/copy/delete.
+    // maskOp says how a new one combines with it (Ctrl+M).
+    SelectionMask mask;
+    bool masking = false;
+    MaskOp maskOp = MaskOp::Replace;
+    DragTool dragTool = DragTool::Paint;
+    std::vector<std::pair<int, int>> lassoPoints;  // also the brush path
+    SelectionMask brushMask;
+    // Ctrl+C/Ctrl+V: the copied bounding box and which of its tiles count
+    TileGrid clipboard;
+    SelectionMask clipboardMask;
+    bool dimensionsChanged = true;     // window/view need to follow the map size
+    sf::Vector2f viewCenter;
+    Tile activeTile = '#';
     sf::Font font;
-    sf::Text text;
+    std::array<LayerRenderCache, LAYER_COUNT> layerCaches;
+    Palette palette;
+    AutoTiler autotiler;
+    TileProperties props;
+
+    // Connected regions are labelled lazily the first time they are needed
+    // after a load/restructure, then kept up to date chunk by chunk
+    RegionMap regionMap;
+    bool regionsValid = false, showRegions = false;
+    int largestRegion = -1;
+
+    // Path preview between two marked tiles, recomputed at most once a frame
+    PathFinder pathFinder;
+    bool pathPlaneValid = false, pathDirty = false;
+    bool hasPathStart = false, hasPathGoal = false;
+    PathPoint pathStart{0, 0}, pathGoal{0, 0};
+    std::vector<PathPoint> pathTiles;
+    float pathLength = -1.f;
+
+    // Cluster graph for long-range queries; the preview uses it instead of
+    // the tile-level search while hierarchicalPath is on (F9)
+    HierarchicalPathCache hpaCache;
+    bool hpaValid = false, hierarchicalPath = false;
+
+    // Heatmap overlay, one texel per tile, stretched over the map in a single
+    // draw call; recomputed at most once a frame after edits
+    Overlay overlay = Overlay::None;
+    PathPoint overlaySpawn{0, 0};
+    bool overlayDirty = false;
+    sf::Texture overlayTexture;
+    std::vector<sf::Uint8> overlayPixels;
+
+    // Bit per terrain tile that tiles.json marks solid, built on first use
+    // and then kept in sync tile by tile
+    BitGrid collision;
+    bool collisionValid = false;
+
+    // Rule checks from validation.json, kept up to date chunk by chunk while
+    // the violation display is on (F4)
+    MapValidator validator;
+    bool validationValid = false, showValidation = false;
+    size_t reportedViolations = 0;
+
+    // Field of view from the cursor, recomputed whenever it moves or the
+    // map changes while the preview is on (F10)
+    FieldOfView fov;
+    bool showFov = false, fovDirty = false;
+    int sightRadius = 16;
+    PathPoint fovOrigin{-1, -1};
+
+    // Saves and exports write from a snapshot on a worker thread while
+    // editing continues. A save only counts once its write succeeded:
+    // then the snapshot becomes the on-disk state, and the edits made
+    // before it are saved (see finishWrite).
+    struct PendingSave {
+        std::string path;
+        MapSnapshot snap;
+        int generation;     // reloadGeneration when it was taken
+        size_t editCount;
+    };
+    std::future<bool> writing;
+    std::optional<PendingSave> pendingSave;
+
+    // Hot reload: the file the map came from (what it held is
+    // doc.diskState) and a re-read running in the background. Loads, saves
+    // and restructuring bump the generation, which voids a re-read in flight.
+    std::string mapPath;
+    FileWatcher watcher;
+    std::future<ReloadResult> reload;
+    int reloadGeneration = 0;
+    bool reloadAgain = false;  // the file changed again while it was being read
+
+    // Pattern search results; matchCovered marks every tile inside a match
+    std::vector<PatternMatch> matches;
+    int matchHeight = 0, matchWidth = 0, currentMatch = -1;
+    std::vector<uint8_t> matchCovered;
+
+    // Drag painting state: the stroke's last tile, the tiles queued since the
+    // last flush, and everything the stroke has touched so far
+    bool stroking = false, strokePainting = false;
+    int strokeRow = 0, strokeCol = 0;
+    std::vector<std::pair<int, int>> pendingTiles;
+    std::unordered_set<int> strokeTouched;
+    EditRecord strokeRecord;
+
+    // Edits since the last save/load; an autosave follows AUTOSAVE_SECONDS
+    // after the first of them. editCount tells a save whether more edits
+    // came in while it was being written.
+    bool unsavedEdits = false, autosavePending = false;
+    size_t editCount = 0;
+    sf::Clock autosaveClock;
+
+    void markUnsaved() {
+        ++editCount;
+        unsavedEdits = true;
+        if (!autosavePending) {
+            autosavePending = true;
+            autosaveClock.restart();
+        }
+    }
+
+    // Everything derived from the tiles subscribes here. Block-level caches
+    // mark each dirty block once; autotiling, the path planes and the
+    // collision bits follow the changed tiles themselves.
+    void registerEditObservers() {
+        static_assert(RENDER_CHUNK % DIRTY_CHUNK == 0 && PACK_CHUNK % DIRTY_CHUNK == 0 &&
+                      REGION_CHUNK % DIRTY_CHUNK == 0 && HPA_CLUSTER % DIRTY_CHUNK == 0 &&
+                      VALIDATION_CHUNK % DIRTY_CHUNK == 0, "a dirty block must not straddle two chunks");
+        static_assert(GROW_CHUNK % RENDER_CHUNK == 0 && GROW_CHUNK % REGION_CHUNK == 0 &&
+                      GROW_CHUNK % HPA_CLUSTER == 0 && GROW_CHUNK % VALIDATION_CHUNK == 0 && GROW_CHUNK % 64 == 0,
+                      "canvas growth must move every cache's chunks (and collision words) whole");
+
+        // Glyph cache of the edited layer
+        edits.observe([this](const EditBatch& batch) {
+            batch.region.forEachBlock([&](int row, int col) { layerCaches[batch.layer].markDirty(row, col); });
+        });
+        edits.observe([this](const EditBatch&) { markUnsaved(); });
+
+        // The other layers feed no derived data
+        auto terrainOnly = [this](auto observer) {
+            edits.observe([observer](const EditBatch& batch) {
+                if (batch.layer == LAYER_TERRAIN) observer(batch);
+            });
+        };
+        terrainOnly([this](const EditBatch& batch) {
+            if (terrainPaged()) return;  // not autotiled
+            // Past a point, one full pass is cheaper than many 3x3 updates
+            if (batch.changes.size() * 8 > grid.size()) {
+                autotiler.rebuild(grid);
+            } else {
+                for (const auto& change : batch.changes)
+                    autotiler.updateAround(grid, change.row, change.col);
+            }
+        });
+        terrainOnly([this](const EditBatch& batch) {
+            if (regionsValid)
+                batch.region.forEachBlock([this](int row, int col) { regionMap.markDirty(row, col); });
+            if (hpaValid)
+                batch.region.forEachBlock([this](int row, int col) { hpaCache.markDirty(row, col); });
+            if (validationValid)
+                batch.region.forEachBlock([this](int row, int col) { validator.markDirty(row, col); });
+        });
+        terrainOnly([this](const EditBatch& batch) {
+            if (pathPlaneValid)
+                for (const auto& change : batch.changes)
+                    pathFinder.updateTile(change.row, change.col, change.after, props);
+            if (collisionValid)
+                for (const auto& change : batch.changes)
+                    collision.set(change.row, change.col, props.isSolid(change.after));
+        });
+        terrainOnly([this](const EditBatch&) {
+            pathDirty = true;
+            overlayDirty = true;
+            fovDirty = true;
+        });
+    }
+
+    // Returns true when the number of violations changed since the last call
+    bool refreshValidation() {
+        refreshRegions();
+        if (validationValid) {
+            validator.refresh(grid, props, regionMap);
+        } else {
+            validator.rebuild(grid, props, regionMap);
+            validationValid = true;
+        }
+        size_t count = validator.violations().size();
+        bool changed = count != reportedViolations;
+        reportedViolations = count;
+        return changed;
+    }
+
+    void printViolations(size_t shown) const {
+        const auto& list = validator.violations();
+        std::cout << list.size() << " rule violation(s)\n";
+        for (size_t i = 0; i < std::min(shown, list.size()); ++i) {
+            std::cout << "  ";
+            if (list[i].row >= 0) std::cout << "(" << list[i].row << ", " << list[i].col << ") ";
+            std::cout << list[i].message << "\n";
+        }
+        if (list.size() > shown)
+            std::cout << "  ... and " << list.size() - shown << " more\n";
+    }
+
+    void refreshFov() {
+        if (!showFov) return;
+        PathPoint origin{selectedRow, selectedCol};
+        if (!fovDirty && origin.row == fovOrigin.row && origin.col == fovOrigin.col) return;
+        fovDirty = false;
+        fovOrigin = origin;
+        fov.compute(grid, props, origin, sightRadius);
+    }
+
+    void refreshOverlay() {
+        if (overlay == Overlay::None || !overlayDirty) return;
+        overlayDirty = false;
+
+        // Each mode reduces to a value in [0, 1] per tile, or < 0 for none
+        std::vector<float> value(grid.size());
+        if (overlay == Overlay::WallDistance) {
+            std::vector<float> dist = wallDistance(grid, props);
+            float maxDist = 0.f;
+            for (float d : dist)
+                if (std::isfinite(d)) maxDist = std::max(maxDist, d);
+            for (size_t i = 0; i < dist.size(); ++i)
+                value[i] = dist[i] == 0.f ? -1.f : std::isfinite(dist[i]) ? dist[i] / maxDist : 1.f;
+        } else if (overlay == Overlay::SpawnDistance) {
+            std::vector<int> dist = spawnDistance(grid, props, overlaySpawn);
+            int maxDist = std::max(1, *std::max_element(dist.begin(), dist.end()));
+            for (size_t i = 0; i < dist.size(); ++i)
+                value[i] = dist[i] < 0 ? -1.f : static_cast<float>(dist[i]) / maxDist;
+        } else {
+            value = solidDensity(grid, props, DENSITY_RADIUS);
+        }
+
+        // Cold blue to hot red, translucent so the tiles stay readable
+        overlayPixels.resize(grid.size() * 4);
+        for (size_t i = 0; i < value.size(); ++i) {
+            float t = value[i];
+            sf::Uint8* px = &overlayPixels[i * 4];
+            px[0] = static_cast<sf::Uint8>(40 + 200 * std::max(t, 0.f));
+            px[1] = static_cast<sf::Uint8>(90 - 40 * std::max(t, 0.f));
+            px[2] = static_cast<sf::Uint8>(220 - 190 * std::max(t, 0.f));
+            px[3] = t < 0.f ? 0 : 150;
+        }
+        if (overlayTexture.getSize() != sf::Vector2u(static_cast<unsigned>(cols), static_cast<unsigned>(rows)))
+            overlayTexture.create(cols, rows);
+        overlayTexture.update(overlayPixels.data());
+    }
+
+    // Brings the cluster graph up to date, rebuilding only edited clusters
+    void refreshNavGraph() {
+        if (hpaValid) {
+            hpaCache.refresh(grid, props);
+            return;
+        }
+        sf::Clock clock;
+        hpaCache.rebuild(grid, props);
+        hpaValid = true;
+        std::cout << "Navigation graph: " << hpaCache.nodeCount() << " node(s) over "
+                  << hpaCache.clustersRebuilt() << " cluster(s), built in "
+                  << clock.getElapsedTime().asMilliseconds() << " ms\n";
+    }
+
+    void refreshPath() {
+        if (!pathDirty || !hasPathStart || !hasPathGoal) return;
+        pathDirty = false;
+
+        float length;
+        bool found;
+        if (hierarchicalPath) {
+            refreshNavGraph();
+            found = hpaCache.findPath(grid, props, pathStart, pathGoal, pathTiles, length);
+        } else {
+            if (!pathPlaneValid) {
+                pathFinder.rebuild(grid, props);
+                pathPlaneValid = true;
+            }
+            found = pathFinder.findPath(pathStart, pathGoal, pathTiles, length);
+        }
+        if (!found) length = -1.f;
+        if (length != pathLength) {  // only report changes, not every drag frame
+            if (found && hierarchicalPath)
+                std::cout << "Path: " << pathTiles.size() - 2 << " waypoint(s), length " << length << "\n";
+            else if (found)
+                std::cout << "Path: " << pathTiles.size() - 1 << " step(s), length " << length << "\n";
+            else
+                std::cout << "Path: goal unreachable\n";
+        }
+        pathLength = length;
+    }
+
+    void refreshRegions() {
+        if (regionsValid) {
+            regionMap.refresh(grid, props);
+        } else {
+            regionMap.rebuild(grid, props);
+            regionsValid = true;
+        }
+        const auto& stats = regionMap.stats();
+        largestRegion = -1;
+        for (size_t i = 0; i < stats.size(); ++i)
+            if (largestRegion < 0 || stats[i].size > stats[largestRegion].size)
+                largestRegion = static_cast<int>(i);
+    }
+
+    TileGrid& activePlane() { return layers.plane(activeLayer); }
+
+    const BitGrid& refreshCollision() {
+        if (!collisionValid) {
+            collision = solidMask(grid, props);
+            collisionValid = true;
+        }
+        return collision;
+    }
+
+    // Every layer but terrain and the active one goes to idleStorage; those
+    // two are read tile by tile by the tools and brushes. A paged map keeps
+    // every layer paged.
+    void applyCompaction() {
+        if (terrainPaged()) return;
+        for (int l = 0; l < LAYER_COUNT; ++l)
+            if (l != LAYER_TERRAIN)
+                layers.setStorage(l, l == activeLayer ? LayerStorage::Dense : idleStorage);
+    }
+
+    // Set when the map was opened out of core (see loadFromFile)
+    bool terrainPaged() const { return layers.storage(LAYER_TERRAIN) == LayerStorage::Paged; }
+
+    // Encode and write (see writeMapFile) on a worker thread while editing
+    // continues; a new write waits for the previous one
+    void writeInBackground(const std::string& path, std::function<std::string()> encode, const std::string& done) {
+        finishWrite();
+        writing = std::async(std::launch::async, [path, encode = std::move(encode), done] {
+            if (!writeMapFile(path, encode())) return false;
+            std::cout << done << "\n";
+            return true;
+        });
+    }
+
+    // Wait for the write in flight, if any, and apply the outcome of a save
+    void finishWrite() {
+        if (!writing.valid()) return;
+        bool ok = writing.get();
+        std::optional<PendingSave> save = std::move(pendingSave);
+        pendingSave.reset();
+        if (!save) return;
+        if (!ok) {
+            std::cerr << "Map not saved; the edits are still unsaved\n";
+            return;
+        }
+        if (save->path == mapPath) {
+            // Unless the map was restructured meanwhile, which leaves
+            // nothing to line the file up with
+            doc.diskState = save->generation == reloadGeneration ? std::move(save->snap) : MapSnapshot();
+            ++reloadGeneration;
+        }
+        if (save->editCount == editCount)
+            unsavedEdits = autosavePending = false;
+    }
+
+    // Tile edits check this first; locked layers refuse them
+    bool layerEditable() const {
+        if (!layers.flags[activeLayer].locked) return true;
+        std::cout << "Layer '" << LAYER_NAMES[activeLayer] << "' is locked (F2 unlocks)\n";
+        return false;
+    }
+
+    // Tools that work on a whole plane, and the analyses (on terrain), need
+    // it in memory; on a paged map only painting and the tile-by-tile
+    // tools are available
+    bool planeInMemory(int layer) const {
+        if (layers.storage(layer) != LayerStorage::Paged) return true;
+        std::cout << "Not available on a paged map (layer '" << LAYER_NAMES[layer] << "' is on disk)\n";
+        return false;
+    }
+
+    // Copy of a rectangle of the active layer
+    TileGrid copyRegion(int top, int left, int height, int width) const {
+        return layers.copyRegion(activeLayer, top, left, height, width);
+    }
+
+    // Run every tile of `sel` on the active layer through rewrite(row, col,
+    // tile) as one undo step; returns the number of changed tiles
+    template <typename Rewrite>
+    size_t rewriteSelection(const SelectionMask& sel, Rewrite&& rewrite) {
+        endStroke();
+        if (!planeInMemory(activeLayer) || !layerEditable()) return 0;
+        return edits.rewrite(activeLayer, sel, std::forward<Rewrite>(rewrite));
+    }
+
+    // Grow the infinite canvas to take in grid rows [top, bottom] x cols
+    // [left, right] (see MapDocument::grow)
+    void growCanvas(int top, int left, int bottom, int right) {
+        CanvasGrowth growth = doc.grow(top, left, bottom, right);
+        if (growth.grew()) {
+            canvasGrown(growth.up, growth.left);
+            std::cout << "Canvas grew to " << rows << "x" << cols << ", origin (" << doc.originRow << ", "
+                      << doc.originCol << ")\n";
+        }
+        if (!growth.fits)
+            std::cerr << "Canvas is at the " << MAX_MAP_SIZE << " tile limit\n";
+    }
+
+    // The map grew by dr rows on top and dc columns on the left. Unlike
+    // mapReplaced() a stroke in progress survives (the document moved the
+    // history): every stored position moves along and the screen stays
+    // where it was. Caches and analyses move their chunks over and only
+    // take in the new area, now or on their next refresh.
+    void canvasGrown(int dr, int dc) {
+        rows = layers.rows();
+        cols = layers.cols();
+        auto move = [dr, dc](int& row, int& col) {
+            row += dr;
+            col += dc;
+        };
+        move(selectedRow, selectedCol);
+        move(anchorRow, anchorCol);
+        move(strokeRow, strokeCol);
+        move(pathStart.row, pathStart.col);
+        move(pathGoal.row, pathGoal.col);
+        move(overlaySpawn.row, overlaySpawn.col);
+        for (auto& tile : pendingTiles) move(tile.first, tile.second);
+        for (auto& point : lassoPoints) move(point.first, point.second);
+        if (masking) mask.reframe(rows, cols, dr, dc);
+        if (!lassoPoints.empty()) brushMask.reframe(rows, cols, dr, dc);
+        strokeTouched.clear();
+        for (auto& change : strokeRecord) {
+            move(change.row, change.col);
+            strokeTouched.insert(change.row * cols + change.col);
+        }
+        viewCenter += sf::Vector2f(static_cast<float>(dc * TILE_SIZE), static_cast<float>(dr * TILE_SIZE));
+
+        autotiler.reframe(grid, dr, dc);
+        for (auto& cache : layerCaches) cache.reframe(rows, cols, dr, dc);
+        if (regionsValid) regionMap.reframe(rows, cols, dr, dc);
+        if (hpaValid) hpaCache.reframe(rows, cols, dr, dc);
+        if (validationValid) validator.reframe(rows, cols, dr, dc);
+        if (pathPlaneValid) pathFinder.reframe(grid, props, dr, dc);
+        if (collisionValid) growSolidMask(collision, grid, props, dr, dc);
+        pathDirty = true;
+        overlayDirty = true;
+        fovDirty = true;
+        clearMatches();
+        markUnsaved();
+        ++reloadGeneration;
+        dimensionsChanged = true;
+    }
+
+    // Called after the grid was replaced or restructured (load, resize, crop,
+    // shift); the document has already dropped the history, which
+    // cell-based edits can't follow through such moves
+    void mapReplaced() {
+        rows = layers.rows();
+        cols = layers.cols();
+        selectedRow = std::clamp(selectedRow, 0, rows - 1);
+        selectedCol = std::clamp(selectedCol, 0, cols - 1);
+        selecting = false;
+        masking = false;
+        mask = SelectionMask();
+        stroking = strokePainting = false;
+        pendingTiles.clear();
+        lassoPoints.clear();
+        strokeTouched.clear();
+        strokeRecord.clear();
+        autotiler.rebuild(grid);
+        for (auto& cache : layerCaches) cache.reset(rows, cols);
+        applyCompaction();
+        regionsValid = false;
+        pathPlaneValid = false;
+        hpaValid = false;
+        validationValid = false;
+        collisionValid = false;
+        overlayDirty = true;
+        fovDirty = true;
+        hasPathStart = hasPathGoal = false;
+        pathTiles.clear();
+        clearMatches();
+        markUnsaved();
+        ++reloadGeneration;
+        dimensionsChanged = true;
+    }
+
+    void clearMatches() {
+        matches.clear();
+        matchCovered.clear();
+        currentMatch = -1;
+    }
+
+    template <typename Generator>
+    void applyGenerator(const char* name, Generator&& generator) {
+        endStroke();
+        if (!planeInMemory(activeLayer) || !layerEditable()) return;
+        sf::IntRect sel = selecting ? selectionRect() : sf::IntRect(0, 0, cols, rows);
+        TileGrid before = copyRegion(sel.top, sel.left, sel.height, sel.width);
+        sf::Clock clock;
+        generator(activePlane(), GenRect{sel.top, sel.left, sel.height, sel.width});
+        int ms = clock.getElapsedTime().asMilliseconds();
+        size_t changed = edits.commitRegion(activeLayer, before, sel.top, sel.left);
+        std::cout << "Generated " << name << " over " << sel.height << "x" << sel.width << " in " << ms
+                  << " ms (" << changed << " tile(s) changed)\n";
+    }
+
+    // Queue every tile on the line (r0, c0) -> (r1, c1), so fast mouse
+    // movement doesn't leave gaps (Bresenham)
+    void queueLine(int r0, int c0, int r1, int c1) {
+        int dr = std::abs(r1 - r0), dc = std::abs(c1 - c0);
+        int sr = r0 < r1 ? 1 : -1, sc = c0 < c1 ? 1 : -1;
+        int err = dc - dr;
+        while (true) {
+            // Off-map tiles are kept on the infinite canvas; flushStroke grows the map
+            if (doc.infiniteCanvas || (r0 >= 0 && r0 < rows && c0 >= 0 && c0 < cols))
+                pendingTiles.emplace_back(r0, c0);
+            if (r0 == r1 && c0 == c1) break;
+            int e2 = 2 * err;
+            if (e2 > -dr) { err -= dr; c0 += sc; }
+            if (e2 < dc)  { err += dc; r0 += sr; }
+        }
+    }
 
 public:
     TileMapEditor(int r, int c) : rows(r), cols(c) {
-        grid.resize(rows, std::vector<char>(cols, '.'));  // default empty tile is '.'
+        layers = LayerStack(rows, cols);
+        palette.loadFromFile("palette.json");
         font.loadFromFile("/usr/share/fonts/truetype/dejavu/DejaVuSans-Bold.ttf"); // Adjust path if needed
-        text.setFont(font);
-        text.setCharacterSize(24);
-        text.setFillColor(sf::Color::White);
+        // Terrain glyphs fill the tile; the other layers get a small glyph in
+        // their own corner so all four stay readable on top of each other
+        layerCaches[LAYER_TERRAIN].setStyle(&font, &palette, 24, sf::Color::White, {0.5f, 0.5f}, false);
+        layerCaches[LAYER_DECORATION].setStyle(&font, &palette, 12, sf::Color(140, 220, 140), {0.22f, 0.25f}, true);
+        layerCaches[LAYER_COLLISION].setStyle(&font, &palette, 12, sf::Color(240, 110, 110), {0.78f, 0.25f}, true);
+        layerCaches[LAYER_TRIGGER].setStyle(&font, &palette, 12, sf::Color(240, 220, 90), {0.78f, 0.75f}, true);
+        for (auto& cache : layerCaches) cache.reset(rows, cols);
+        autotiler.loadRules("autotile.json", palette);
+        props.loadFromFile("tiles.json", palette);
+        validator.rules.loadFromFile("validation.json", palette);
+        registerEditObservers();
+    }
+
+    ~TileMapEditor() {
+        if (writing.valid()) writing.wait();
+        if (reload.valid()) reload.wait();
     }
 
     int getRows() const { return rows; }
     int getCols() const { return cols; }
 
-    void handleMouseClick(int mouseX, int mouseY) {
-        int clickedCol = mouseX / TILE_SIZE;
-        int clickedRow = mouseY / TILE_SIZE;
+    // Top-left corner and size of the selection; just the cursor when
+    // nothing is selected
+    sf::IntRect selectionRect() const {
+        if (!selecting)
+            return {selectedCol, selectedRow, 1, 1};
+        int top = std::min(anchorRow, selectedRow), left = std::min(anchorCol, selectedCol);
+        return {left, top, std::abs(selectedCol - anchorCol) + 1, std::abs(selectedRow - anchorRow) + 1};
+    }
+
+    void clearSelection() {
+        selecting = false;
+        masking = false;
+    }
+
+    // What fill/replace/copy/delete work on: the free-form selection, else
+    // the rectangle (just the cursor when nothing is selected)
+    SelectionMask currentSelection() const {
+        if (masking) return mask;
+        sf::IntRect sel = selectionRect();
+        return SelectionMask::rect(rows, cols, sel.top, sel.left, sel.height, sel.width);
+    }
+
+    // Merge a wand/lasso/brush result into the selection according to maskOp.
+    // A rectangle in progress is the starting point for Add/Subtract/Intersect.
+    void combineSelection(SelectionMask picked) {
+        bool keep = maskOp != MaskOp::Replace && (masking || selecting);
+        mask = keep ? currentSelection() : SelectionMask(rows, cols);
+        mask.combine(std::move(picked), maskOp);
+        selecting = false;
+        masking = !mask.empty();
+        std::cout << "Selection: " << mask.count() << " tile(s) in " << mask.spanCount() << " span(s)\n";
+    }
+
+    void cycleMaskOp() {
+        maskOp = static_cast<MaskOp>((static_cast<int>(maskOp) + 1) % 4);
+        const char* names[] = {"replace", "add", "subtract", "intersect"};
+        std::cout << "New selections " << names[static_cast<int>(maskOp)] << " the current one\n";
+    }
+
+    void toggleDragTool(DragTool tool) {
+        endStroke();
+        dragTool = dragTool == tool ? DragTool::Paint : tool;
+        const char* names[] = {"Drag paints tiles", "Drag draws a lasso selection", "Drag brushes a selection"};
+        std::cout << names[static_cast<int>(dragTool)] << "\n";
+    }
+
+    // Tiles of the cursor's type on the active layer: the connected area,
+    // or with global every one of them
+    void magicWandSelect(bool global) {
+        endStroke();
+        if (!planeInMemory(activeLayer)) return;
+        sf::Clock clock;
+        SelectionMask picked = magicWand(activePlane(), selectedRow, selectedCol, !global);
+        int ms = clock.getElapsedTime().asMilliseconds();
+        std::cout << "Magic wand (" << ms << " ms): ";
+        combineSelection(std::move(picked));
+    }
+
+    void invertSelection() {
+        endStroke();
+        mask = currentSelection();
+        mask.invert();
+        selecting = false;
+        masking = !mask.empty();
+        std::cout << "Inverted selection: " << mask.count() << " tile(s)\n";
+    }
+
+    // Set every selected tile of the active layer to the active tile
+    void fillSelection() {
+        size_t changed = rewriteSelection(currentSelection(), [this](int, int, Tile) { return activeTile; });
+        std::cout << "Filled " << changed << " tile(s) with '" << palette.label(activeTile) << "'\n";
+    }
+
+    // Selected tiles of the cursor's type become the active tile
+    void replaceInSelection() {
+        Tile from = layers.get(activeLayer, selectedRow, selectedCol);
+        size_t changed = rewriteSelection(currentSelection(), [this, from](int, int, Tile t) {
+            return t == from ? activeTile : t;
+        });
+        std::cout << "Replaced " << changed << " '" << palette.label(from) << "' with '" << palette.label(activeTile)
+                  << "'\n";
+    }
+
+    void deleteSelection() {
+        size_t changed = rewriteSelection(currentSelection(), [](int, int, Tile) { return EMPTY_TILE; });
+        std::cout << "Deleted " << changed << " tile(s)\n";
+    }
+
+    // Keep the selected tiles of the active layer, relative to their
+    // bounding box
+    void copySelection() {
+        endStroke();
+        if (!planeInMemory(activeLayer)) return;
+        SelectionMask sel = currentSelection();
+        int top, left, bottom, right;
+        if (!sel.bounds(top, left, bottom, right)) return;
+        clipboard = copyRegion(top, left, bottom - top + 1, right - left + 1);
+        sel.reframe(clipboard.rows(), clipboard.cols(), -top, -left);
+        clipboardMask = std::move(sel);
+        std::cout << "Copied " << clipboardMask.count() << " tile(s)\n";
+    }
+
+    // Write the copied tiles with the bounding box's corner at the cursor;
+    // tiles outside the copied selection stay as they are
+    void pasteClipboard() {
+        if (clipboardMask.rows() == 0) {
+            std::cout << "Nothing copied (Ctrl+C)\n";
+            return;
+        }
+        int top = selectedRow, left = selectedCol;
+        SelectionMask target = clipboardMask;
+        target.reframe(rows, cols, top, left);
+        size_t changed = rewriteSelection(target, [this, top, left](int r, int c, Tile) {
+            return clipboard.at(r - top, c - left);
+        });
+        std::cout << "Pasted " << changed << " tile(s) at (" << top << ", " << left << ")\n";
+    }
+
+    // Grow or shrink to newRows x newCols. anchorV/anchorH (0 = top/left,
+    // 1 = centre, 2 = bottom/right) say which side keeps the content in place.
+    void resizeMap(int newRows, int newCols, int anchorV, int anchorH) {
+        endStroke();
+        int rowOffset = (newRows - rows) * anchorV / 2;
+        int colOffset = (newCols - cols) * anchorH / 2;
+        doc.reframe(newRows, newCols, rowOffset, colOffset);
+        selectedRow += rowOffset;
+        selectedCol += colOffset;
+        mapReplaced();
+        std::cout << "Resized map to " << rows << "x" << cols << " (undo history cleared)\n";
+    }
+
+    void cropToSelection() {
+        if (!selecting) {
+            std::cout << "Nothing selected (Shift+arrows or Shift+click to select)\n";
+            return;
+        }
+        endStroke();
+        sf::IntRect sel = selectionRect();
+        doc.crop(sel.top, sel.left, sel.height, sel.width);
+        selectedRow -= sel.top;
+        selectedCol -= sel.left;
+        mapReplaced();
+        std::cout << "Cropped map to " << rows << "x" << cols << " (undo history cleared)\n";
+    }
+
+    void shiftMap(int dr, int dc, bool wrap) {
+        endStroke();
+        if (!planeInMemory(LAYER_TERRAIN)) return;
+        doc.shift(dr, dc, wrap);
+        mapReplaced();
+        std::cout << "Shifted map by (" << dr << ", " << dc << ")" << (wrap ? " with wrap" : "")
+                  << " (undo history cleared)\n";
+    }
+
+    // Rotate/flip the selection on the active layer, or every layer of the
+    // whole map when nothing is selected. Selection transforms are undoable;
+    // whole-map ones restructure the grid.
+    void transform(GridTransform t) {
+        endStroke();
+        if (!planeInMemory(activeLayer)) return;
+        if (!selecting) {
+            doc.transform(t);
+            if (swapsDimensions(t)) std::swap(selectedRow, selectedCol);
+            mapReplaced();
+            std::cout << "Transformed map, now " << rows << "x" << cols << " (undo history cleared)\n";
+            return;
+        }
+
+        if (!layerEditable()) return;
+        sf::IntRect sel = selectionRect();
+        int height = sel.height, width = sel.width;
+        // A 90 degree turn of a non-square selection touches the union of the
+        // old and new footprints
+        int spanH = swapsDimensions(t) ? std::min(std::max(height, width), rows - sel.top) : height;
+        int spanW = swapsDimensions(t) ? std::min(std::max(height, width), cols - sel.left) : width;
+        TileGrid before = copyRegion(sel.top, sel.left, spanH, spanW);
+        transformRegion(activePlane(), sel.top, sel.left, height, width, t);
+        edits.commitRegion(activeLayer, before, sel.top, sel.left);
+
+        anchorRow = sel.top;
+        anchorCol = sel.left;
+        selectedRow = sel.top + height - 1;
+        selectedCol = sel.left + width - 1;
+        std::cout << "Transformed selection, now " << height << "x" << width << "\n";
+    }
+
+    // Search the active layer for the selected rectangle ('?' tiles match
+    // anything) and jump to the first match at or after the cursor
+    void findSelection() {
+        endStroke();
+        if (!planeInMemory(activeLayer)) return;
+        sf::IntRect sel = selectionRect();
+        TileGrid pattern = copyRegion(sel.top, sel.left, sel.height, sel.width);
+
+        sf::Clock clock;
+        matches = findPattern(activePlane(), pattern, WILDCARD_TILE);
+        int ms = clock.getElapsedTime().asMilliseconds();
+        matchHeight = sel.height;
+        matchWidth = sel.width;
+
+        matchCovered = matchCoverage(matches, matchHeight, matchWidth, rows, cols);
+
+        std::cout << "Found " << matches.size() << " match(es) of " << sel.height << "x" << sel.width
+                  << " pattern in " << ms << " ms\n";
+        currentMatch = -1;
+        if (!matches.empty()) {
+            selecting = false;
+            nextMatch(1);
+        }
+    }
+
+    // Move the cursor to the next (dir = 1) or previous (dir = -1) match
+    void nextMatch(int dir) {
+        if (matches.empty()) return;
+        if (currentMatch < 0) {
+            // Start from the cursor position
+            auto it = std::lower_bound(matches.begin(), matches.end(), std::pair{selectedRow, selectedCol},
+                                       [](const PatternMatch& m, std::pair<int, int> p) {
+                                           return std::pair{m.row, m.col} < p;
+                                       });
+            currentMatch = static_cast<int>(it - matches.begin());
+            if (dir < 0) --currentMatch;
+        } else {
+            currentMatch += dir;
+        }
+        int n = static_cast<int>(matches.size());
+        currentMatch = ((currentMatch % n) + n) % n;
+
+        selectedRow = matches[currentMatch].row;
+        selectedCol = matches[currentMatch].col;
+        std::cout << "Match " << currentMatch + 1 << "/" << n << " at (" << selectedRow << ", " << selectedCol << ")\n";
+    }
+
+    // Mark the cursor tile as path start or goal; the path is shown once both
+    // are set and follows every edit
+    void setPathEndpoint(bool goal) {
+        if (!planeInMemory(LAYER_TERRAIN)) return;
+        PathPoint p{selectedRow, selectedCol};
+        if (goal) {
+            pathGoal = p;
+            hasPathGoal = true;
+        } else {
+            pathStart = p;
+            hasPathStart = true;
+        }
+        pathDirty = true;
+        pathLength = -2.f;  // force a report
+        std::cout << "Path " << (goal ? "goal" : "start") << " at (" << p.row << ", " << p.col << ")\n";
+    }
+
+    void clearPath() {
+        hasPathStart = hasPathGoal = false;
+        pathTiles.clear();
+    }
+
+    // Cycle the heatmap overlay: wall distance, walking distance from the
+    // cursor (taken as spawn), solid density, off
+    void cycleOverlay() {
+        if (!planeInMemory(LAYER_TERRAIN)) return;
+        if (std::max(rows, cols) > static_cast<int>(sf::Texture::getMaximumSize())) {
+            std::cerr << "Map too large for the overlay texture\n";
+            return;
+        }
+        overlay = static_cast<Overlay>((static_cast<int>(overlay) + 1) % 4);
+        if (overlay == Overlay::SpawnDistance)
+            overlaySpawn = {selectedRow, selectedCol};
+        overlayDirty = true;
+
+        const char* names[] = {"Overlay off", "Overlay: distance to nearest wall", "Overlay: distance from spawn",
+                               "Overlay: solid density"};
+        sf::Clock clock;
+        refreshOverlay();
+        std::cout << names[static_cast<int>(overlay)];
+        if (overlay != Overlay::None)
+            std::cout << " (" << clock.getElapsedTime().asMilliseconds() << " ms)";
+        std::cout << "\n";
+    }
+
+    // Show rule violations live: offending tiles are outlined and the list is
+    // printed again whenever the number of violations changes
+    void toggleValidation() {
+        if (!planeInMemory(LAYER_TERRAIN)) return;
+        if (validator.rules.empty()) {
+            std::cerr << "No validation rules loaded (validation.json)\n";
+            return;
+        }
+        showValidation = !showValidation;
+        if (!showValidation) return;
+        refreshValidation();
+        printViolations(10);
+    }
+
+    // Check the whole map once and list every violation; for headless runs
+    size_t validate() {
+        if (validator.rules.empty())
+            std::cerr << "No validation rules loaded (validation.json)\n";
+        refreshValidation();
+        printViolations(validator.violations().size());
+        return validator.violations().size();
+    }
+
+    // Tab/Shift+Tab: pick the layer that receives edits
+    void cycleLayer(int step) {
+        endStroke();
+        activeLayer = (activeLayer + step + LAYER_COUNT) % LAYER_COUNT;
+        applyCompaction();
+        clearMatches();  // they were found on the previous layer
+        printLayer();
+    }
+
+    // Ctrl+P: keep the layers that aren't being edited dense, packed, or
+    // paged out to disk, in turn
+    void cycleIdleStorage() {
+        endStroke();
+        if (terrainPaged()) {
+            std::cout << "A paged map keeps every layer paged\n";
+            return;
+        }
+        size_t before = 0, after = 0;
+        for (int l = 0; l < LAYER_COUNT; ++l) before += layers.memoryBytes(l);
+        idleStorage = idleStorage == LayerStorage::Dense    ? LayerStorage::Packed
+                      : idleStorage == LayerStorage::Packed ? LayerStorage::Paged
+                                                            : LayerStorage::Dense;
+        applyCompaction();
+        for (int l = 0; l < LAYER_COUNT; ++l) after += layers.memoryBytes(l);
+        const char* names[] = {"dense", "packed", "paged"};
+        std::cout << "Idle layers " << names[static_cast<int>(idleStorage)] << ": " << before / 1024
+                  << " KiB -> " << after / 1024 << " KiB resident\n";
+    }
+
+    void setPageBudget(int mib) {
+        layers.setPageBudget(static_cast<size_t>(mib) << 20);
+        std::cout << "Page cache budget " << mib << " MiB per layer\n";
+    }
+
+    void toggleLayerVisible() {
+        layers.flags[activeLayer].visible = !layers.flags[activeLayer].visible;
+        printLayer();
+    }
+
+    void toggleLayerLocked() {
+        endStroke();
+        layers.flags[activeLayer].locked = !layers.flags[activeLayer].locked;
+        printLayer();
+    }
+
+    void printLayer() const {
+        const LayerFlags& f = layers.flags[activeLayer];
+        std::cout << "Layer " << activeLayer + 1 << "/" << LAYER_COUNT << ": " << LAYER_NAMES[activeLayer]
+                  << (f.visible ? "" : " (hidden)") << (f.locked ? " (locked)" : "") << "\n";
+    }
+
+    // Infinite canvas (F11): strokes and the cursor may leave the map,
+    // which then grows towards them
+    void toggleInfiniteCanvas() {
+        endStroke();
+        doc.infiniteCanvas = !doc.infiniteCanvas;
+        dimensionsChanged = true;
+        std::cout << "Infinite canvas " << (doc.infiniteCanvas ? "on" : "off") << "\n";
+    }
+
+    // Shade the tiles visible from the cursor within sightRadius, treating
+    // the "opaque" characters of tiles.json as blocking
+    void toggleFov() {
+        if (!planeInMemory(LAYER_TERRAIN)) return;
+        showFov = !showFov;
+        fovDirty = true;
+        if (!showFov) return;
+        sf::Clock clock;
+        refreshFov();
+        std::cout << "Field of view: " << fov.visible().size() << " tile(s) visible within " << sightRadius << " ("
+                  << clock.getElapsedTime().asMicroseconds() << " us)\n";
+    }
+
+    void setSightRadius(int radius) {
+        sightRadius = radius;
+        fovDirty = true;
+        std::cout << "Sight radius " << radius << "\n";
+    }
+
+    // Switch the path preview between the exact tile path and the cluster
+    // graph route, drawn as straight legs between border crossings
+    void toggleHierarchicalPath() {
+        hierarchicalPath = !hierarchicalPath;
+        pathDirty = true;
+        pathLength = -2.f;
+        std::cout << (hierarchicalPath ? "Hierarchical" : "Tile-level") << " path preview\n";
+    }
+
+    // Toggle the region overlay; turning it on prints the region report.
+    // Passable tiles outside the largest region (unreachable pockets) are
+    // tinted red while it is on.
+    void toggleRegions() {
+        if (!planeInMemory(LAYER_TERRAIN)) return;
+        showRegions = !showRegions;
+        if (!showRegions) return;
+
+        sf::Clock clock;
+        refreshRegions();
+        const auto& stats = regionMap.stats();
+        std::cout << stats.size() << " passable region(s), labelled in "
+                  << clock.getElapsedTime().asMilliseconds() << " ms\n";
+        if (stats.empty()) return;
+
+        std::vector<int> bySize(stats.size());
+        for (size_t i = 0; i < bySize.size(); ++i) bySize[i] = static_cast<int>(i);
+        std::sort(bySize.begin(), bySize.end(), [&](int a, int b) { return stats[a].size > stats[b].size; });
+        const size_t shown = 10;
+        for (size_t i = 0; i < std::min(shown, bySize.size()); ++i) {
+            const RegionStats& r = stats[bySize[i]];
+            std::cout << "  " << (i == 0 ? "main  " : "pocket") << " size " << r.size << ", bounds (" << r.top << ", "
+                      << r.left << ")-(" << r.bottom << ", " << r.right << ")\n";
+        }
+        if (bySize.size() > shown)
+            std::cout << "  ... and " << bySize.size() - shown << " smaller pocket(s)\n";
+    }
+
+    // Fill the selection (or the whole map) using activeTile as the solid tile
+    void generateNoise(NoiseParams params) {
+        params.solid = activeTile;
+        applyGenerator("noise", [&](TileGrid& g, const GenRect& area) { ::generateNoise(g, area, params); });
+    }
+
+    void generateCaves(CaveParams params) {
+        params.solid = activeTile;
+        applyGenerator("cave", [&](TileGrid& g, const GenRect& area) { ::generateCaves(g, area, params); });
+    }
+
+    // Grow (dilate) or shrink (erode) the solid tiles by `steps` inside the
+    // selection. Runs on the collision bits, 64 tiles per word operation;
+    // grown tiles get the active tile, shrunk ones become '.'
+    void morphSolid(int steps, bool grow) {
+        endStroke();
+        if (!planeInMemory(activeLayer)) return;
+        BitGrid before = activeLayer == LAYER_TERRAIN ? refreshCollision() : solidMask(activePlane(), props);
+        BitGrid after = before;
+        for (int i = 0; i < steps; ++i)
+            after = grow ? after.dilate() : after.erode();
+        applyGenerator(grow ? "grow" : "shrink", [&](TileGrid& g, const GenRect& area) {
+            for (int r = area.top; r < area.top + area.height; ++r)
+                for (int c = area.left; c < area.left + area.width; ++c)
+                    if (after.get(r, c) != before.get(r, c))
+                        g.at(r, c) = grow ? activeTile : EMPTY_TILE;
+        });
+    }
+
+    void generateScatter(uint64_t seed, float density) {
+        applyGenerator("scatter", [&](TileGrid& g, const GenRect& area) {
+            ::generateScatter(g, area, seed, density, activeTile);
+        });
+    }
+
+    // Keep the window sized to the map (up to MAX_WINDOW_SIZE) and scroll the
+    // view so the cursor stays visible. Call once per frame before draw().
+    void updateView(sf::RenderWindow& window) {
+        float mapW = static_cast<float>(cols * TILE_SIZE), mapH = static_cast<float>(rows * TILE_SIZE);
+        // The infinite canvas shows a strip of empty canvas to paint into
+        float margin = doc.infiniteCanvas ? static_cast<float>(CANVAS_MARGIN * TILE_SIZE) : 0.f;
+        if (dimensionsChanged) {
+            dimensionsChanged = false;
+            window.setSize(sf::Vector2u(std::min(static_cast<unsigned>(mapW + 2 * margin), MAX_WINDOW_SIZE),
+                                        std::min(static_cast<unsigned>(mapH + 2 * margin), MAX_WINDOW_SIZE)));
+        }
+
+        sf::Vector2f size(window.getSize());
+        float left = viewCenter.x - size.x / 2, top = viewCenter.y - size.y / 2;
+        float curX = static_cast<float>(selectedCol * TILE_SIZE), curY = static_cast<float>(selectedRow * TILE_SIZE);
+        left = std::clamp(left, curX + TILE_SIZE - size.x, curX);
+        top = std::clamp(top, curY + TILE_SIZE - size.y, curY);
+        left = std::max(-margin, std::min(left, mapW + margin - size.x));
+        top = std::max(-margin, std::min(top, mapH + margin - size.y));
+
+        viewCenter = sf::Vector2f(left + size.x / 2, top + size.y / 2);
+        window.setView(sf::View(viewCenter, size));
+    }
+
+    void handleMouseClick(int mouseX, int mouseY, bool extendSelection = false) {
+        int clickedCol = tileIndex(mouseX);
+        int clickedRow = tileIndex(mouseY);
 
         // Check bounds
         if (clickedRow < 0 || clickedRow >= rows || clickedCol < 0 || clickedCol >= cols)
             return;
 
+        if (extendSelection && !selecting) {
+            selecting = true;
+            masking = false;
+            anchorRow = selectedRow;
+            anchorCol = selectedCol;
+        } else if (!extendSelection) {
+            selecting = false;
+        }
+
         // Select the clicked tile
         selectedRow = clickedRow;
         selectedCol = clickedCol;
@@ -46,169 +1130,651 @@ public:
         std::cout << "Selected tile (" << selectedRow << ", " << selectedCol << ")\n";
     }
 
-    bool loadFromFile(const std::string& path) {
-        std::ifstream inFile(path);
-        if (!inFile) {
-            std::cerr << "Failed to open " << path << "\n";
-            return false;
+    // Start a drag stroke at the pressed tile. Nothing is painted until the
+    // mouse leaves that tile, so a plain click still only selects.
+    void beginStroke(int mouseX, int mouseY) {
+        int row = tileIndex(mouseY), col = tileIndex(mouseX);
+        if (!doc.infiniteCanvas && (row < 0 || row >= rows || col < 0 || col >= cols))
+            return;
+        stroking = true;
+        strokePainting = false;
+        strokeRow = row;
+        strokeCol = col;
+        if (dragTool != DragTool::Paint) {
+            lassoPoints.assign(1, {row, col});
+            brushMask = SelectionMask(rows, cols);
+            brushMask.add(row, col, col + 1);
         }
+    }
 
-        // 1) Parse JSON:
-        json j;
-        try {
-            inFile >> j;
-        } catch (json::parse_error& e) {
-            std::cerr << "JSON parse error: " << e.what() << "\n";
-            return false;
+    // Called for every MouseMoved event; only queues tiles; flushStroke()
+    // applies them once per frame
+    void continueStroke(int mouseX, int mouseY) {
+        if (!stroking) return;
+        int row = tileIndex(mouseY), col = tileIndex(mouseX);
+        if (row == strokeRow && col == strokeCol)
+            return;  // high polling rates report many moves within one tile
+
+        // Selection drags only collect their path; endStroke() selects
+        if (dragTool != DragTool::Paint) {
+            if (dragTool == DragTool::SelectBrush)
+                brushMask.addLine(strokeRow, strokeCol, row, col);
+            lassoPoints.emplace_back(row, col);
+            strokeRow = row;
+            strokeCol = col;
+            return;
         }
 
-        // 2) Extract the tiles-array, whichever shape it is:
-        json tilesArr;
-        if (j.is_object() && j.contains("tiles") && j["tiles"].is_array()) {
-            tilesArr = j["tiles"];
-        } else if (j.is_array()) {
-            tilesArr = j;
-        } else {
-            std::cerr << "Unexpected JSON format—expected array or { tiles: [...] }\n";
-            return false;
+        if (!strokePainting) {
+            if (!layerEditable()) {
+                stroking = false;
+                return;
+            }
+            strokePainting = true;
+            pendingTiles.emplace_back(strokeRow, strokeCol);
         }
+        queueLine(strokeRow, strokeCol, row, col);
+        strokeRow = row;
+        strokeCol = col;
+    }
 
-        // 3) Build a temporary vector<vector<char>> from that JSON:
-        std::vector<std::vector<char>> tempGrid;
-        tempGrid.reserve(tilesArr.size());
+    // Apply everything queued this frame as one batched edit
+    void flushStroke() {
+        if (pendingTiles.empty()) return;
 
-        size_t maxCols = 0;
-        for (const auto& rowJson : tilesArr) {
-            if (!rowJson.is_array()) {
-                std::cerr << "Each row must be an array\n";
-                return false;
+        if (doc.infiniteCanvas) {
+            int top = rows, left = cols, bottom = -1, right = -1;
+            for (auto [row, col] : pendingTiles) {
+                top = std::min(top, row);
+                left = std::min(left, col);
+                bottom = std::max(bottom, row);
+                right = std::max(right, col);
             }
+            growCanvas(top, left, bottom, right);
+            // Whatever the size limit kept out is dropped
+            pendingTiles.erase(std::remove_if(pendingTiles.begin(), pendingTiles.end(),
+                                              [this](std::pair<int, int> p) {
+                                                  return p.first < 0 || p.first >= rows || p.second < 0 ||
+                                                         p.second >= cols;
+                                              }),
+                               pendingTiles.end());
+        }
 
-            std::vector<char> row;
-            row.reserve(rowJson.size());
-            for (const auto& cellJson : rowJson) {
-                if (cellJson.is_string()) {
-                    std::string s = cellJson.get<std::string>();
-                    row.push_back(s.empty() ? '.' : s[0]);
-                } else {
-                    // you could allow numbers, nulls, etc.
-                    row.push_back('.');
-                }
-            }
-            maxCols = std::max(maxCols, row.size());
-            tempGrid.push_back(std::move(row));
+        edits.begin();
+        for (auto [row, col] : pendingTiles)
+            if (strokeTouched.insert(row * cols + col).second)
+                edits.set(activeLayer, row, col, activeTile);
+        pendingTiles.clear();
+
+        // The whole drag becomes one undo step in endStroke()
+        strokeRecord.insert(strokeRecord.end(), edits.pending().begin(), edits.pending().end());
+        size_t painted = edits.commit(false);
+        if (painted > 0) {
+            selectedRow = strokeRecord.back().row;
+            selectedCol = strokeRecord.back().col;
+            std::cout << "Painted " << painted << " tile(s) with '" << palette.label(activeTile) << "'\n";
         }
+    }
 
-        // 4) **Pad** every row so they all have length = maxCols:
-        for (auto& row : tempGrid) {
-            while (row.size() < maxCols)
-                row.push_back('.');   // Default empty tile is '.'
+    // Finish the stroke; the whole drag becomes a single undo step
+    void endStroke() {
+        if (!stroking) return;
+        if (!lassoPoints.empty()) {
+            stroking = false;
+            // A click without a drag leaves the selection alone
+            if (lassoPoints.size() > 1) {
+                SelectionMask picked = dragTool == DragTool::Lasso ? lassoMask(rows, cols, lassoPoints)
+                                                                   : std::move(brushMask);
+                std::cout << (dragTool == DragTool::Lasso ? "Lasso: " : "Brush: ");
+                combineSelection(std::move(picked));
+            }
+            lassoPoints.clear();
+            brushMask = SelectionMask();
+            return;
         }
+        flushStroke();
+        stroking = strokePainting = false;
+        strokeTouched.clear();
+        edits.pushHistory(std::move(strokeRecord));
+        strokeRecord.clear();
+    }
 
-        // 5) Finally commit into your editor:
-        rows = tempGrid.size();
-        cols = maxCols;
-        grid = std::move(tempGrid);
-        selectedRow = selectedCol = 0;
+    void undo() {
+        if (!edits.canUndo()) return;
+        endStroke();
+        size_t count = edits.undo();
+        std::cout << "Undo (" << count << " tile(s))\n";
+    }
+
+    void redo() {
+        if (!edits.canRedo()) return;
+        endStroke();
+        size_t count = edits.redo();
+        std::cout << "Redo (" << count << " tile(s))\n";
+    }
+
+    // A binary map bigger than one layer's page budget is opened out of
+    // core: streamed into paged storage, every layer included, unless
+    // mayPage is false
+    bool loadFromFile(const std::string& path, bool mayPage = true) {
+        int fileRows, fileCols;
+        if (mayPage && peekMapSize(path, fileRows, fileCols) &&
+            static_cast<size_t>(fileRows) * fileCols * sizeof(Tile) > layers.pageBudgetBytes())
+            return loadPaged(path);
+
+        MapFile file;
+        if (!readMapFile(path, palette, file))
+            return false;
+        size_t unknown = file.unknown;
+        applyMapFile(std::move(file));
+        mapPath = path;
+        watcher.watch(path);
 
         std::cout << "Loaded map.json (" << rows << "×" << cols << ")\n";
+        if (unknown > 0)
+            std::cerr << unknown << " tile value(s) not in the palette were left empty\n";
         return true;
     }
 
-    void saveToFile(const std::string& path) {
-        // Determine the correct width
-        int maxCols = 0;
-        for (const auto& row : grid) {
-            if (row.size() > maxCols) maxCols = row.size();
-        }
+    // Replace every layer with the file's; it becomes the on-disk state hot
+    // reload compares against
+    void applyMapFile(MapFile&& file) {
+        doc.load(std::move(file));
+        activeLayer = LAYER_TERRAIN;
+        selectedRow = selectedCol = 0;
+        mapReplaced();
+        unsavedEdits = autosavePending = false;
+    }
+
+    bool loadPaged(const std::string& path) {
+        PagedMapFile file;
+        if (!readMapPaged(path, layers.pageBudgetBytes(), file))
+            return false;
+        size_t unknown = file.unknown;
+        doc.load(std::move(file));
+        activeLayer = LAYER_TERRAIN;
+        selectedRow = selectedCol = 0;
+        // None of the analyses run on a paged map
+        overlay = Overlay::None;
+        showValidation = showFov = showRegions = false;
+        mapReplaced();
+        unsavedEdits = autosavePending = false;
 
-        // Pad all rows to match the longest one
-        for (auto& row : grid) {
-            while (row.size() < maxCols)
-                row.push_back('.'); // Default tile fill is '.'
+        // No hot reload: a re-read would have to hold the whole file
+        mapPath = path;
+        watcher.stop();
+        std::cout << "Loaded " << path << " (" << rows << "×" << cols << ") paged, "
+                  << (layers.pageBudgetBytes() >> 20) << " MiB cache per layer\n";
+        if (unknown > 0)
+            std::cerr << unknown << " tile value(s) not in the palette were left empty\n";
+        return true;
+    }
+
+    // Called every frame: re-reads the map file in the background when
+    // another program rewrote it, and applies the result once it is ready
+    void pollReload() {
+        bool changed = watcher.changed();
+        if (!reload.valid()) {
+            if (changed) startReload();
+            return;
+        }
+        reloadAgain = reloadAgain || changed;
+        if (reload.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return;
+        ReloadResult result = reload.get();
+        if (result.generation == reloadGeneration)
+            applyReload(result);
+        else
+            reloadAgain = true;  // the map moved under it; compare again
+        if (reloadAgain) {
+            reloadAgain = false;
+            startReload();
         }
+    }
 
-        json j = json::array();
-        for (const auto& row : grid) {
-            json line = json::array();
-            for (char cell : row) {
-                std::string s(1, cell);
-                line.push_back(s);
+    // Parse and diff against the on-disk state on a worker thread (see
+    // diffReload). Paged maps aren't re-read at all.
+    void startReload() {
+        if (terrainPaged()) return;
+        reload = std::async(std::launch::async, [this, path = mapPath, frame = doc.diskFrame(),
+                                                 generation = reloadGeneration] {
+            ReloadResult result;
+            result.generation = generation;
+            if ((result.ok = readMapFile(path, palette, result.file)))
+                result.fits = diffReload(frame, result.file, result.diffs);
+            return result;
+        });
+    }
+
+    // Merge the tiles that changed on disk (see MapDocument::mergeReload);
+    // other unsaved edits survive. A file of another shape replaces the map
+    // unless there are unsaved edits.
+    void applyReload(ReloadResult& result) {
+        if (!result.ok) return;  // e.g. caught half-written; the next write triggers again
+        if (result.fits) {
+            if (result.diffs.empty()) return;  // our own save, or the same content rewritten
+            // Ending the stroke may grow the canvas, which moves the frame
+            // the diffs were made in; compare again then
+            int generation = reloadGeneration;
+            endStroke();
+            if (reloadGeneration != generation) {
+                reloadAgain = true;
+                return;
+            }
+            bool hadLocalEdits = unsavedEdits;
+            ReloadMerge merge;
+            if (doc.mergeReload(result.diffs, merge)) {
+                if (!hadLocalEdits)
+                    unsavedEdits = autosavePending = false;
+                std::cout << mapPath << " changed on disk: " << merge.applied << " tile(s) updated in "
+                          << merge.blocks << " block(s)\n";
+                if (merge.conflicts > 0)
+                    std::cerr << merge.conflicts << " tile(s) changed both here and on disk kept the unsaved "
+                              << "local edit (first at (" << merge.conflictRow << ", " << merge.conflictCol
+                              << ")); Ctrl+S overwrites the file\n";
+                return;
             }
-            j.push_back(line);
         }
+        if (unsavedEdits) {
+            std::cerr << mapPath << " changed shape on disk; keeping the editor's copy (unsaved edits)\n";
+            return;
+        }
+        applyMapFile(std::move(result.file));
+        std::cout << "Reloaded " << mapPath << " (" << rows << "x" << cols << ", undo history cleared)\n";
+    }
+
+    // Ctrl+S: back to the file the map came from, in its format
+    void save() { saveToFile(mapPath.empty() ? "map.json" : mapPath); }
+
+    void saveToFile(const std::string& path) {
+        if (terrainPaged()) {
+            if (writePaged(path))
+                unsavedEdits = autosavePending = false;
+            else
+                std::cerr << "Map not saved; the edits are still unsaved\n";
+            return;
+        }
+        MapSnapshot snap = layers.snapshot();
+        writeMap(path, snap, doc.format);
+        pendingSave = PendingSave{path, std::move(snap), reloadGeneration, editCount};
+    }
+
+    // A paged map is never snapshotted whole: it goes out in binary a band
+    // at a time straight from the page store, on this thread since the
+    // page cache serves only one
+    bool writePaged(const std::string& path) {
+        finishWrite();
+        sf::Clock clock;
+        if (!writeMapStreamed(path, layers, doc.infiniteCanvas, doc.originRow, doc.originCol))
+            return false;
+        std::cout << "Saved " << path << " (" << clock.getElapsedTime().asMilliseconds() << " ms)\n";
+        return true;
+    }
+
+    // Called every frame, before pollReload so a re-read of our own save
+    // compares against what the save wrote
+    void pollWrite() {
+        if (writing.valid() && writing.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            finishWrite();
+    }
 
-        std::ofstream outFile(path);
-        if (!outFile) {
-            std::cerr << "Failed to write to file: " << path << "\n";
+    // Called every frame; writes AUTOSAVE_PATH (PAGED_AUTOSAVE_PATH for a
+    // paged map) once the oldest unsaved edit is AUTOSAVE_SECONDS old. The
+    // map itself stays unsaved.
+    void autosave() {
+        if (!autosavePending || autosaveClock.getElapsedTime().asSeconds() < AUTOSAVE_SECONDS)
             return;
+        autosavePending = false;
+        if (terrainPaged())
+            writePaged(PAGED_AUTOSAVE_PATH);
+        else
+            writeMap(AUTOSAVE_PATH, layers.snapshot(), MapFormat::Json);
+    }
+
+    // See encodeMap: the map as it looks, cut to the occupied rectangle on
+    // the infinite canvas
+    void writeMap(const std::string& path, MapSnapshot snap, MapFormat format) {
+        writeInBackground(path, [this, snap = std::move(snap), canvas = doc.infiniteCanvas,
+                                 origin = PathPoint{doc.originRow, doc.originCol}, format] {
+            return encodeMap(snap, canvas, origin.row, origin.col, palette, format);
+        }, "Saved " + path);
+    }
+
+    // Write the map together with its autotiled variants (when autotile.json
+    // was loaded) and the navigation graph. The result is still loadable,
+    // since loadFromFile accepts { tiles: [...] }.
+    // The derived parts need the live caches and are built here; the tiles
+    // are serialized from a snapshot on the worker thread
+    void exportToFile(const std::string& path) {
+        if (!planeInMemory(LAYER_TERRAIN)) return;
+        refreshNavGraph();
+
+        json derived = {{"navgraph", hpaCache.exportGraph()}};
+        if (autotiler.enabled()) {
+            autotiler.rebuild(grid);
+            derived["autotile"] = autotiler.exportTiles(grid, palette);
+        } else {
+            std::cerr << "No autotile rules loaded (autotile.json), exporting tiles only\n";
         }
 
-        outFile << j.dump(2);
-        std::cout << "Saved map.json\n";
+        writeInBackground(path, [this, snap = layers.snapshot(), derived = std::move(derived)] {
+            json j = derived;
+            TileArea area{0, 0, snap.rows(), snap.cols()};
+            j["tiles"] = planeToJson(snap.planes[LAYER_TERRAIN], area, palette);
+            json extra = layersToJson(snap, area, palette);
+            if (!extra.empty())
+                j["layers"] = extra;
+            return j.dump(2);
+        }, "Exported " + path);
     }
 
     void draw(sf::RenderWindow& window) {
-        for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
+        // Only the tiles inside the view
+        const sf::View& view = window.getView();
+        sf::Vector2f topLeft = view.getCenter() - view.getSize() / 2.f;
+        int firstCol = std::max(0, static_cast<int>(topLeft.x) / TILE_SIZE);
+        int firstRow = std::max(0, static_cast<int>(topLeft.y) / TILE_SIZE);
+        int lastCol = std::min(cols - 1, static_cast<int>(topLeft.x + view.getSize().x) / TILE_SIZE);
+        int lastRow = std::min(rows - 1, static_cast<int>(topLeft.y + view.getSize().y) / TILE_SIZE);
+        sf::IntRect sel = selectionRect();
+        if (showRegions)
+            refreshRegions();  // only relabels chunks edited since the last frame
+        refreshFov();
+
+        for (int y = firstRow; y <= lastRow; ++y) {
+            for (int x = firstCol; x <= lastCol; ++x) {
                 sf::RectangleShape rect(sf::Vector2f(TILE_SIZE - 1, TILE_SIZE - 1));
                 rect.setPosition(x * TILE_SIZE, y * TILE_SIZE);
                 rect.setFillColor(sf::Color(50, 50, 50));
 
                 if (x == selectedCol && y == selectedRow) {
                     rect.setFillColor(sf::Color(100, 100, 200)); // Highlight selected tile
+                } else if (selecting && x >= sel.left && x < sel.left + sel.width &&
+                           y >= sel.top && y < sel.top + sel.height) {
+                    rect.setFillColor(sf::Color(70, 70, 120));   // Selection rectangle
+                } else if ((masking && mask.contains(y, x)) || brushMask.contains(y, x)) {
+                    rect.setFillColor(sf::Color(70, 70, 120));   // Free-form selection
+                } else if (currentMatch >= 0 && x >= matches[currentMatch].col && x < matches[currentMatch].col + matchWidth &&
+                           y >= matches[currentMatch].row && y < matches[currentMatch].row + matchHeight) {
+                    rect.setFillColor(sf::Color(150, 110, 40));  // Current search match
+                } else if (!matchCovered.empty() && matchCovered[grid.index(y, x)]) {
+                    rect.setFillColor(sf::Color(90, 70, 30));    // Other search matches
+                } else if (showFov && fov.isVisible(y, x)) {
+                    rect.setFillColor(sf::Color(95, 90, 55));    // In view of the cursor
+                } else if (showRegions) {
+                    int region = regionMap.regionAt(y, x);
+                    if (region >= 0 && region != largestRegion)
+                        rect.setFillColor(sf::Color(120, 40, 40)); // Unreachable pocket
                 }
 
                 window.draw(rect);
+            }
+        }
 
-                text.setString(std::string(1, grid[y][x]));
+        if (dragTool == DragTool::Lasso && lassoPoints.size() > 1) {
+            sf::VertexArray outline(sf::LineStrip, lassoPoints.size() + 1);
+            for (size_t i = 0; i <= lassoPoints.size(); ++i) {
+                auto [row, col] = lassoPoints[i % lassoPoints.size()];
+                outline[i].position = sf::Vector2f((col + 0.5f) * TILE_SIZE, (row + 0.5f) * TILE_SIZE);
+                outline[i].color = sf::Color(140, 140, 230);
+            }
+            window.draw(outline);
+        }
+
+        // Paged layers fault in the view plus a chunk of margin, so short
+        // scrolls find their tiles resident
+        layers.prefetch(firstRow - PACK_CHUNK, firstCol - PACK_CHUNK, lastRow + PACK_CHUNK, lastCol + PACK_CHUNK);
+
+        // Glyphs come from the per-layer caches, bottom layer first
+        for (int l = 0; l < LAYER_COUNT; ++l)
+            if (layers.flags[l].visible)
+                layerCaches[l].draw(window, layers, l, TILE_SIZE, firstRow, lastRow, firstCol, lastCol);
+
+        if (showValidation) {
+            if (refreshValidation())
+                printViolations(10);
+            sf::RectangleShape outline(sf::Vector2f(TILE_SIZE - 3, TILE_SIZE - 3));
+            outline.setFillColor(sf::Color::Transparent);
+            outline.setOutlineThickness(1);
+            outline.setOutlineColor(sf::Color(230, 60, 200));
+            for (const auto& v : validator.violations()) {
+                if (v.row < firstRow || v.row > lastRow || v.col < firstCol || v.col > lastCol) continue;
+                outline.setPosition(v.col * TILE_SIZE + 1, v.row * TILE_SIZE + 1);
+                window.draw(outline);
+            }
+        }
 
-                sf::FloatRect textBounds = text.getLocalBounds();
-                float textX = x * TILE_SIZE + (TILE_SIZE - textBounds.width) / 2 - textBounds.left;
-                float textY = y * TILE_SIZE + (TILE_SIZE - textBounds.height) / 2 - textBounds.top;
-                text.setPosition(textX, textY);
+        refreshOverlay();
+        if (overlay != Overlay::None) {
+            sf::Sprite heat(overlayTexture);
+            heat.setScale(TILE_SIZE, TILE_SIZE);
+            window.draw(heat);
+        }
 
-                window.draw(text);
+        refreshPath();
+        if (hasPathStart && hasPathGoal && hierarchicalPath && pathTiles.size() > 1) {
+            sf::VertexArray legs(sf::LineStrip, pathTiles.size());
+            for (size_t i = 0; i < pathTiles.size(); ++i) {
+                legs[i].position = sf::Vector2f((pathTiles[i].col + 0.5f) * TILE_SIZE, (pathTiles[i].row + 0.5f) * TILE_SIZE);
+                legs[i].color = sf::Color(60, 200, 90);
             }
+            window.draw(legs);
+        }
+        if (hasPathStart && hasPathGoal) {
+            sf::RectangleShape dot(sf::Vector2f(TILE_SIZE / 3.f, TILE_SIZE / 3.f));
+            dot.setFillColor(sf::Color(60, 200, 90));
+            for (const auto& p : pathTiles) {
+                if (p.row < firstRow || p.row > lastRow || p.col < firstCol || p.col > lastCol) continue;
+                dot.setPosition(p.col * TILE_SIZE + TILE_SIZE / 3.f, p.row * TILE_SIZE + TILE_SIZE / 3.f);
+                window.draw(dot);
+            }
+        }
+        for (int i = 0; i < 2; ++i) {
+            bool set = i == 0 ? hasPathStart : hasPathGoal;
+            PathPoint p = i == 0 ? pathStart : pathGoal;
+            if (!set) continue;
+            sf::RectangleShape marker(sf::Vector2f(TILE_SIZE - 5, TILE_SIZE - 5));
+            marker.setPosition(p.col * TILE_SIZE + 2, p.row * TILE_SIZE + 2);
+            marker.setFillColor(sf::Color::Transparent);
+            marker.setOutlineThickness(2);
+            marker.setOutlineColor(i == 0 ? sf::Color(60, 200, 90) : sf::Color(220, 80, 80));
+            window.draw(marker);
         }
     }
 
-    void handleInput(sf::Keyboard::Key key) {
+    // Arrow keys move the cursor; with extendSelection (Shift) they grow a
+    // selection rectangle from where the cursor was
+    void handleInput(sf::Keyboard::Key key, bool extendSelection = false) {
+        bool arrow = key == sf::Keyboard::Up || key == sf::Keyboard::Down ||
+                     key == sf::Keyboard::Left || key == sf::Keyboard::Right;
+        if (arrow && extendSelection && !selecting) {
+            selecting = true;
+            masking = false;  // a new rectangle replaces a free-form selection
+            anchorRow = selectedRow;
+            anchorCol = selectedCol;
+        } else if ((arrow && !extendSelection) || key == sf::Keyboard::Escape) {
+            selecting = false;
+        }
+        if (key == sf::Keyboard::Escape) {
+            masking = false;
+            clearMatches();
+        }
+        if (key == sf::Keyboard::Delete)
+            deleteSelection();
+        if (key == sf::Keyboard::Tab)
+            cycleLayer(extendSelection ? -1 : 1);
+        if (key == sf::Keyboard::F1)
+            toggleLayerVisible();
+        if (key == sf::Keyboard::F2)
+            toggleLayerLocked();
+        if (key == sf::Keyboard::F3)
+            nextMatch(extendSelection ? -1 : 1);
+        if (key == sf::Keyboard::F4)
+            toggleValidation();
+        if (key == sf::Keyboard::F5)
+            toggleRegions();
+        if (key == sf::Keyboard::F6)
+            cycleOverlay();
+        if (key == sf::Keyboard::F7) {
+            if (extendSelection) clearPath();
+            else setPathEndpoint(false);
+        }
+        if (key == sf::Keyboard::F8)
+            setPathEndpoint(true);
+        if (key == sf::Keyboard::F9)
+            toggleHierarchicalPath();
+        if (key == sf::Keyboard::F10)
+            toggleFov();
+
+        if (arrow && doc.infiniteCanvas) {
+            int row = selectedRow + (key == sf::Keyboard::Down) - (key == sf::Keyboard::Up);
+            int col = selectedCol + (key == sf::Keyboard::Right) - (key == sf::Keyboard::Left);
+            growCanvas(row, col, row, col);
+        }
+        if (key == sf::Keyboard::F11)
+            toggleInfiniteCanvas();
+
         if (key == sf::Keyboard::Up)    selectedRow = std::max(0, selectedRow - 1);
         if (key == sf::Keyboard::Down)  selectedRow = std::min(rows - 1, selectedRow + 1);
         if (key == sf::Keyboard::Left)  selectedCol = std::max(0, selectedCol - 1);
         if (key == sf::Keyboard::Right) selectedCol = std::min(cols - 1, selectedCol + 1);
+        refreshFov();
     }
 
-    void handleChar(char c) {
-        std::cout << "Writing '" << c << "' to tile (" << selectedRow << ", " << selectedCol << ")\n";
-        grid[selectedRow][selectedCol] = c;
+    // A typed character paints the tile whose palette glyph it is
+    void handleChar(uint32_t codePoint) {
+        Tile c;
+        if (!palette.fromGlyph(codePoint, c)) {
+            std::cout << "No tile for that character (see palette.json)\n";
+            return;
+        }
+        activeTile = c;  // also becomes the drag-paint tile
+        if (!layerEditable()) return;
+        std::cout << "Writing '" << palette.label(c) << "' to tile (" << selectedRow << ", " << selectedCol << ")"
+                  << (activeLayer != LAYER_TERRAIN ? std::string(" on ") + LAYER_NAMES[activeLayer] : "") << "\n";
+        edits.begin();
+        edits.set(activeLayer, selectedRow, selectedCol, c);
+        edits.commit();
     }
 };
 
-// Helper function to create an empty map.json file with '.' placeholders
-void createEmptyMapFile(int rows, int cols, const std::string& path = "map.json") {
-    json j = json::array();
+// Parse a resize anchor such as "nw", "c" or "se" into vertical/horizontal
+// positions (0 = top/left, 1 = centre, 2 = bottom/right)
+bool parseAnchor(const std::string& anchor, int& vertical, int& horizontal) {
+    vertical = horizontal = 1;
+    if (anchor == "c") return true;
+    if (anchor.empty() || anchor.size() > 2) return false;
+    for (char ch : anchor) {
+        switch (ch) {
+            case 'n': vertical = 0; break;
+            case 's': vertical = 2; break;
+            case 'w': horizontal = 0; break;
+            case 'e': horizontal = 2; break;
+            default: return false;
+        }
+    }
+    return true;
+}
 
-    for (int r = 0; r < rows; ++r) {
-        json row = json::array();
-        for (int c = 0; c < cols; ++c) {
-            row.push_back(".");
+// Asks on the console which generator to run over the selection/map
+void promptGenerate(TileMapEditor& editor) {
+    std::string kind;
+    uint64_t seed;
+    int steps;
+    std::cout << "Generate: noise <seed> <scale> <threshold 0-1> | cave <seed> <fill 0-1> <iterations>"
+                 " | scatter <seed> <density 0-1> | grow <steps> | shrink <steps>\n> ";
+    bool ok = static_cast<bool>(std::cin >> kind);
+    if (ok && (kind == "grow" || kind == "shrink")) {
+        if ((ok = static_cast<bool>(std::cin >> steps) && steps >= 1 && steps <= MAX_MORPH_STEPS))
+            editor.morphSolid(steps, kind == "grow");
+    } else if (ok && (ok = static_cast<bool>(std::cin >> seed))) {
+        if (kind == "noise") {
+            NoiseParams params;
+            params.seed = seed;
+            if ((ok = static_cast<bool>(std::cin >> params.scale >> params.threshold)))
+                editor.generateNoise(params);
+        } else if (kind == "cave") {
+            CaveParams params;
+            params.seed = seed;
+            if ((ok = static_cast<bool>(std::cin >> params.fill >> params.iterations) &&
+                      params.iterations >= 0 && params.iterations <= 100))
+                editor.generateCaves(params);
+        } else if (kind == "scatter") {
+            float density;
+            if ((ok = static_cast<bool>(std::cin >> density)))
+                editor.generateScatter(seed, density);
+        } else {
+            ok = false;
         }
-        j.push_back(row);
     }
 
-    std::ofstream outFile(path);
-    if (!outFile) {
-        std::cerr << "Failed to create " << path << "\n";
+    if (!ok) {
+        std::cout << "Invalid generator, map unchanged\n";
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+}
+
+// Asks on the console for the new map size; the window waits meanwhile
+void promptResize(TileMapEditor& editor) {
+    int rows, cols;
+    std::string anchor;
+    int vertical, horizontal;
+    std::cout << "Resize " << editor.getRows() << "x" << editor.getCols()
+              << " to <rows> <cols> <anchor: nw n ne w c e sw s se>: ";
+    if (!(std::cin >> rows >> cols >> anchor) || rows <= 0 || rows > MAX_MAP_SIZE ||
+        cols <= 0 || cols > MAX_MAP_SIZE || !parseAnchor(anchor, vertical, horizontal)) {
+        std::cout << "Invalid size or anchor, map unchanged\n";
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
         return;
     }
+    editor.resizeMap(rows, cols, vertical, horizontal);
+}
 
-    outFile << j.dump(2);
-    std::cout << "Created empty map.json (" << rows << "x" << cols << ") with '.' tiles\n";
+void promptPageBudget(TileMapEditor& editor) {
+    int mib;
+    std::cout << "Page cache budget per layer in MiB (1-" << MAX_PAGE_BUDGET_MIB << "): ";
+    if (!(std::cin >> mib) || mib < 1 || mib > MAX_PAGE_BUDGET_MIB) {
+        std::cout << "Invalid budget, unchanged\n";
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        return;
+    }
+    editor.setPageBudget(mib);
 }
 
-int main() {
+void promptSightRadius(TileMapEditor& editor) {
+    int radius;
+    std::cout << "Sight radius (1-" << MAX_SIGHT_RADIUS << "): ";
+    if (!(std::cin >> radius) || radius < 1 || radius > MAX_SIGHT_RADIUS) {
+        std::cout << "Invalid radius, unchanged\n";
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        return;
+    }
+    editor.setSightRadius(radius);
+}
+
+int main(int argc, char* argv[]) {
+    // Headless check for CI: STORM --validate [map.json]; exit code 1 on
+    // violations, 2 when the map cannot be loaded
+    if (argc >= 2 && std::string(argv[1]) == "--validate") {
+        std::string path = argc >= 3 ? argv[2] : "map.json";
+        TileMapEditor editor(1, 1);
+        if (!editor.loadFromFile(path, false))
+            return 2;
+        return editor.validate() > 0 ? 1 : 0;
+    }
+
+    // STORM --bench-layout [size]: time the neighbourhood kernels on each
+    // chunk layout and exit
+    if (argc >= 2 && std::string(argv[1]) == "--bench-layout") {
+        int size = argc >= 3 ? std::atoi(argv[2]) : 2000;
+        benchmarkLayouts(std::clamp(size, 1, MAX_MAP_SIZE));
+        return 0;
+    }
+
     std::cout << "STORM - Tilemap Editor\n";
     std::cout << "(N)ew map or (L)oad map.json? ";
     char choice;
@@ -234,7 +1800,8 @@ int main() {
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
             }
 
-            createEmptyMapFile(rows, cols, "map.json");
+            if (createEmptyMapFile("map.json", rows, cols, Palette()))
+                std::cout << "Created empty map.json (" << rows << "x" << cols << ") with '.' tiles\n";
             delete tempEditor;
 
             auto* newEditor = new TileMapEditor(rows, cols);
@@ -262,7 +1829,8 @@ int main() {
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
         }
 
-        createEmptyMapFile(rows, cols, "map.json");
+        if (createEmptyMapFile("map.json", rows, cols, Palette()))
+            std::cout << "Created empty map.json (" << rows << "x" << cols << ") with '.' tiles\n";
 
         auto* tempEditor = new TileMapEditor(1, 1);
         if (!tempEditor->loadFromFile("map.json")) {
@@ -275,7 +1843,15 @@ int main() {
 
     TileMapEditor& editor = *editorPtr;
 
-    sf::RenderWindow window(sf::VideoMode(editor.getCols() * TILE_SIZE, editor.getRows() * TILE_SIZE), "STORM Editor");
+    sf::RenderWindow window(sf::VideoMode(std::min(static_cast<unsigned>(editor.getCols() * TILE_SIZE), MAX_WINDOW_SIZE),
+                                          std::min(static_cast<unsigned>(editor.getRows() * TILE_SIZE), MAX_WINDOW_SIZE)),
+                            "STORM Editor");
+
+    // Window pixel -> map coordinates under the current (scrolled) view
+    auto toWorld = [&window](int x, int y) {
+        sf::Vector2f p = window.mapPixelToCoords({x, y});
+        return sf::Vector2i(static_cast<int>(std::floor(p.x)), static_cast<int>(std::floor(p.y)));
+    };
 
     while (window.isOpen()) {
         sf::Event event;
@@ -284,22 +1860,102 @@ int main() {
                 window.close();
             else if (event.type == sf::Event::KeyPressed) {
                 if (event.key.control && event.key.code == sf::Keyboard::S) {
-                    editor.saveToFile("map.json");
-                    std::cout << "Saved map.json\n";
+                    editor.save();
+                } else if (event.key.control && event.key.code == sf::Keyboard::E) {
+                    editor.exportToFile("map_export.json");
+                } else if (event.key.control && event.key.code == sf::Keyboard::Z) {
+                    editor.undo();
+                } else if (event.key.control && event.key.code == sf::Keyboard::Y) {
+                    editor.redo();
+                } else if (event.key.control && event.key.code == sf::Keyboard::R) {
+                    promptResize(editor);
+                } else if (event.key.control && event.key.code == sf::Keyboard::F) {
+                    editor.findSelection();
+                } else if (event.key.control && event.key.code == sf::Keyboard::G) {
+                    promptGenerate(editor);
+                } else if (event.key.control && event.key.code == sf::Keyboard::K) {
+                    editor.cropToSelection();
+                } else if (event.key.control && event.key.code == sf::Keyboard::W) {
+                    // Ctrl+W selects the connected area of the cursor's tile, Ctrl+Shift+W every such tile
+                    editor.magicWandSelect(event.key.shift);
+                } else if (event.key.control && event.key.code == sf::Keyboard::L) {
+                    editor.toggleDragTool(DragTool::Lasso);
+                } else if (event.key.control && event.key.code == sf::Keyboard::B) {
+                    editor.toggleDragTool(DragTool::SelectBrush);
+                } else if (event.key.control && event.key.code == sf::Keyboard::M) {
+                    editor.cycleMaskOp();
+                } else if (event.key.control && event.key.code == sf::Keyboard::I) {
+                    editor.invertSelection();
+                } else if (event.key.control && event.key.code == sf::Keyboard::D) {
+                    // Ctrl+D fills the selection, Ctrl+Shift+D replaces the cursor's tile type in it
+                    if (event.key.shift)
+                        editor.replaceInSelection();
+                    else
+                        editor.fillSelection();
+                } else if (event.key.control && event.key.code == sf::Keyboard::C) {
+                    editor.copySelection();
+                } else if (event.key.control && event.key.code == sf::Keyboard::X) {
+                    editor.copySelection();
+                    editor.deleteSelection();
+                } else if (event.key.control && event.key.code == sf::Keyboard::V) {
+                    editor.pasteClipboard();
+                } else if (event.key.control && event.key.code == sf::Keyboard::P) {
+                    if (event.key.shift)
+                        promptPageBudget(editor);
+                    else
+                        editor.cycleIdleStorage();
+                } else if (event.key.control && event.key.code == sf::Keyboard::RBracket) {
+                    // Ctrl+] turns clockwise, Ctrl+[ counter-clockwise, either with Shift a half turn
+                    editor.transform(event.key.shift ? GridTransform::Rotate180 : GridTransform::Rotate90);
+                } else if (event.key.control && event.key.code == sf::Keyboard::LBracket) {
+                    editor.transform(event.key.shift ? GridTransform::Rotate180 : GridTransform::Rotate270);
+                } else if (event.key.control && event.key.code == sf::Keyboard::H) {
+                    // Ctrl+H mirrors left-right, Ctrl+Shift+H top-bottom
+                    editor.transform(event.key.shift ? GridTransform::FlipVertical : GridTransform::FlipHorizontal);
+                } else if (event.key.control && (event.key.code == sf::Keyboard::Up ||
+                                                 event.key.code == sf::Keyboard::Down ||
+                                                 event.key.code == sf::Keyboard::Left ||
+                                                 event.key.code == sf::Keyboard::Right)) {
+                    // Ctrl+arrow shifts the content with wrap, Ctrl+Shift+arrow fills with '.'
+                    int dr = event.key.code == sf::Keyboard::Up ? -1 : event.key.code == sf::Keyboard::Down ? 1 : 0;
+                    int dc = event.key.code == sf::Keyboard::Left ? -1 : event.key.code == sf::Keyboard::Right ? 1 : 0;
+                    editor.shiftMap(dr, dc, !event.key.shift);
+                } else if (event.key.shift && event.key.code == sf::Keyboard::F10) {
+                    promptSightRadius(editor);
                 } else {
-                    editor.handleInput(event.key.code);
+                    editor.handleInput(event.key.code, event.key.shift);
                 }
             } else if (event.type == sf::Event::TextEntered) {
-                if (event.text.unicode >= 32 && event.text.unicode < 128)
-                    editor.handleChar(static_cast<char>(event.text.unicode));
+                if (event.text.unicode >= 32 && event.text.unicode != 127)
+                    editor.handleChar(event.text.unicode);
             } else if (event.type == sf::Event::MouseButtonPressed) {
                 if (event.mouseButton.button == sf::Mouse::Left) {
-                    editor.handleMouseClick(event.mouseButton.x, event.mouseButton.y);
+                    sf::Vector2i pos = toWorld(event.mouseButton.x, event.mouseButton.y);
+                    bool shift = sf::Keyboard::isKeyPressed(sf::Keyboard::LShift) ||
+                                 sf::Keyboard::isKeyPressed(sf::Keyboard::RShift);
+                    editor.handleMouseClick(pos.x, pos.y, shift);
+                    if (!shift)
+                        editor.beginStroke(pos.x, pos.y);
                 }
+            } else if (event.type == sf::Event::MouseMoved) {
+                sf::Vector2i pos = toWorld(event.mouseMove.x, event.mouseMove.y);
+                editor.continueStroke(pos.x, pos.y);
+            } else if (event.type == sf::Event::MouseButtonReleased) {
+                if (event.mouseButton.button == sf::Mouse::Left)
+                    editor.endStroke();
+            } else if (event.type == sf::Event::LostFocus) {
+                editor.endStroke();
             }
         }
 
+        // All MouseMoved events of this frame land as one batched edit
+        editor.flushStroke();
+        editor.autosave();
+        editor.pollWrite();
+        editor.pollReload();
+
         window.clear();
+        editor.updateView(window);
         editor.draw(window);
         window.display();
     }
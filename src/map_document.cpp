@@ -0,0 +1,133 @@
+#include "map_document.hpp"
+
+#include <algorithm>
+
+bool diffReload(const DiskFrame& frame, const MapFile& file, std::vector<TileDiff>& out) {
+    const TileGrid& terrain = file.planes[LAYER_TERRAIN];
+    bool known = frame.base.rows() == frame.rows && frame.base.cols() == frame.cols;
+    bool sameFrame = known && (frame.canvas ? file.hasOrigin
+                                            : !file.hasOrigin && terrain.rows() == frame.base.rows() &&
+                                                  terrain.cols() == frame.base.cols());
+    if (!sameFrame) return false;
+    int dr = frame.canvas ? file.originRow - frame.originRow : 0;
+    int dc = frame.canvas ? file.originCol - frame.originCol : 0;
+    return diffMap(frame.base, file, dr, dc, out);
+}
+
+void MapDocument::load(MapFile&& file) {
+    int fileRows = file.planes[LAYER_TERRAIN].rows(), fileCols = file.planes[LAYER_TERRAIN].cols();
+    for (int l = 0; l < LAYER_COUNT; ++l)
+        layers.setPlane(l, file.planes[l].empty() ? TileGrid(fileRows, fileCols) : std::move(file.planes[l]));
+    infiniteCanvas = file.hasOrigin;
+    originRow = file.originRow;
+    originCol = file.originCol;
+    format = file.format;
+    edits.clearHistory();
+    diskState = layers.snapshot();
+}
+
+void MapDocument::load(PagedMapFile&& file) {
+    for (int l = 0; l < LAYER_COUNT; ++l)
+        layers.setPlane(l, std::move(file.planes[l]));
+    infiniteCanvas = file.hasOrigin;
+    originRow = file.originRow;
+    originCol = file.originCol;
+    format = MapFormat::Binary;
+    restructured();
+}
+
+CanvasGrowth MapDocument::grow(int top, int left, int bottom, int right) {
+    int rows = this->rows(), cols = this->cols();
+    int needUp = std::max(0, -top), needDown = std::max(0, bottom - (rows - 1));
+    int needLeft = std::max(0, -left), needRight = std::max(0, right - (cols - 1));
+    CanvasGrowth g;
+    if (needUp + needDown + needLeft + needRight == 0) return g;
+
+    auto step = [](int need) { return (need + GROW_CHUNK - 1) / GROW_CHUNK * GROW_CHUNK; };
+    g.up = step(needUp);
+    g.down = step(needDown);
+    g.left = step(needLeft);
+    g.right = step(needRight);
+    // Near MAX_MAP_SIZE drop the rounding, then whatever still doesn't fit
+    auto fit = [](int& a, int& b, int needA, int needB, int size) {
+        if (size + a + b <= MAX_MAP_SIZE) return;
+        a = std::max(0, std::min(needA, MAX_MAP_SIZE - size));
+        b = std::max(0, std::min(needB, MAX_MAP_SIZE - size - a));
+    };
+    fit(g.up, g.down, needUp, needDown, rows);
+    fit(g.left, g.right, needLeft, needRight, cols);
+    g.fits = g.up >= needUp && g.down >= needDown && g.left >= needLeft && g.right >= needRight;
+    if (!g.grew()) return g;
+
+    rows += g.up + g.down;
+    cols += g.left + g.right;
+    layers.grow(g.up, g.down, g.left, g.right);
+    originRow -= g.up;
+    originCol -= g.left;
+    edits.moveHistory(g.up, g.left);
+    if (diskState.rows() > 0)
+        for (auto& plane : diskState.planes) plane.reframe(rows, cols, g.up, g.left);
+    return g;
+}
+
+void MapDocument::reframe(int newRows, int newCols, int rowOffset, int colOffset) {
+    layers.reframe(newRows, newCols, rowOffset, colOffset);
+    restructured();
+}
+
+void MapDocument::crop(int top, int left, int height, int width) {
+    layers.crop(top, left, height, width);
+    restructured();
+}
+
+void MapDocument::shift(int dr, int dc, bool wrap) {
+    layers.shift(dr, dc, wrap);
+    restructured();
+}
+
+void MapDocument::transform(GridTransform t) {
+    layers.transform(t);
+    restructured();
+}
+
+void MapDocument::restructured() {
+    edits.clearHistory();
+    diskState = MapSnapshot();
+}
+
+DiskFrame MapDocument::diskFrame() const {
+    return {diskState, infiniteCanvas, originRow, originCol, rows(), cols()};
+}
+
+bool MapDocument::mergeReload(const std::vector<TileDiff>& diffs, ReloadMerge& out) {
+    // Diffs are positions in diskState, which must still be the map's size
+    int rows = this->rows(), cols = this->cols();
+    auto inside = [rows, cols](const TileDiff& diff) {
+        return diff.layer >= 0 && diff.layer < LAYER_COUNT && diff.row >= 0 && diff.row < rows && diff.col >= 0 &&
+               diff.col < cols;
+    };
+    if (diskState.rows() != rows || diskState.cols() != cols || !std::all_of(diffs.begin(), diffs.end(), inside))
+        return false;
+
+    out = ReloadMerge();
+    for (size_t i = 0; i < diffs.size();) {
+        int layer = diffs[i].layer;
+        edits.begin();
+        for (; i < diffs.size() && diffs[i].layer == layer; ++i) {
+            const TileDiff& diff = diffs[i];
+            diskState.planes[layer].set(diff.row, diff.col, diff.after);
+            Tile local = layers.get(layer, diff.row, diff.col);
+            if (local != diff.before && local != diff.after) {
+                if (out.conflicts++ == 0) {
+                    out.conflictRow = diff.row;
+                    out.conflictCol = diff.col;
+                }
+                continue;
+            }
+            edits.set(layer, diff.row, diff.col, diff.after);
+        }
+        out.blocks += edits.pendingBlocks();
+        out.applied += edits.commit();
+    }
+    return true;
+}
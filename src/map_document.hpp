@@ -0,0 +1,106 @@
+// The map being edited: its layers, edit history, canvas frame and the
+// state of the file it came from
+//
+// Structural edits (growing the canvas, resize, crop, shift, transform)
+// keep these consistent with each other: growing moves the history and
+// the on-disk state along with the tiles, the others restructure in a way
+// cell positions can't follow, so they drop both. Merging a hot reload
+// into the tiles lives here too. The editor adds the cursor, selection
+// and display on top; nothing here draws or reads input.
+
+#pragma once
+
+#include "edit_session.hpp"
+#include "layers.hpp"
+#include "map_io.hpp"
+#include "transform.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// A growing canvas adds whole GROW_CHUNK blocks on each side. It is a
+// multiple of every chunk the layers and the editor's caches key on, so
+// growing moves their chunks over instead of redoing them.
+const int GROW_CHUNK = 64;
+static_assert(GROW_CHUNK % PACK_CHUNK == 0, "growth must move packed chunks whole");
+
+// Tiles a canvas grew by on each side; `fits` is false when MAX_MAP_SIZE
+// kept part of the requested area out
+struct CanvasGrowth {
+    int up = 0, down = 0, left = 0, right = 0;
+    bool fits = true;
+
+    bool grew() const { return up + down + left + right > 0; }
+};
+
+// What the editor knows about the file, captured to diff a re-read of it
+// on another thread
+struct DiskFrame {
+    MapSnapshot base;  // as of the last load/save; empty when unknown
+    bool canvas = false;
+    int originRow = 0, originCol = 0;
+    int rows = 0, cols = 0;  // the map's size when captured
+};
+
+// The outcome of merging a re-read file into the map
+struct ReloadMerge {
+    size_t applied = 0, blocks = 0, conflicts = 0;
+    int conflictRow = 0, conflictCol = 0;  // the first conflict
+};
+
+// The tiles `file` changes relative to the frame's base. Only a file of
+// the same kind and frame can be diffed: same size, or on the infinite
+// canvas anything that fits the canvas at its origin; without a base of
+// the map's size there is nothing to line it up with. False when the file
+// has to replace the map instead.
+bool diffReload(const DiskFrame& frame, const MapFile& file, std::vector<TileDiff>& out);
+
+class MapDocument {
+public:
+    LayerStack layers;
+    EditSession edits{layers};
+    // Infinite canvas: world position = grid position + origin, so growing
+    // up or left moves the origin instead of the world
+    bool infiniteCanvas = false;
+    int originRow = 0, originCol = 0;
+    // The file as of the last load/save, in the map's frame; empty once a
+    // restructure left no way to line the two up
+    MapSnapshot diskState;
+    // The file's format, which saves keep
+    MapFormat format = MapFormat::Json;
+
+    int rows() const { return layers.rows(); }
+    int cols() const { return layers.cols(); }
+
+    // Replace every layer with the file's and clear the history. A file
+    // read whole becomes the on-disk state; a paged one leaves it empty
+    // (paged maps are always binary).
+    void load(MapFile&& file);
+    void load(PagedMapFile&& file);
+
+    // Make grid rows [top, bottom] x cols [left, right] (may lie outside
+    // the map) part of the map. Each side grows by what is needed, rounded
+    // up to GROW_CHUNK. The cost is in the new tiles: dense layers grow
+    // into spare room, packed chunks and the on-disk state move whole, and
+    // the history only moves its origin.
+    CanvasGrowth grow(int top, int left, int bottom, int right);
+
+    // Restructures; each clears the history and the on-disk state
+    void reframe(int newRows, int newCols, int rowOffset, int colOffset);
+    void crop(int top, int left, int height, int width);
+    void shift(int dr, int dc, bool wrap);
+    void transform(GridTransform t);
+
+    DiskFrame diskFrame() const;
+
+    // Apply the tiles that changed on disk (diffReload's output), one
+    // undoable edit per layer, and move the on-disk state to the file. A
+    // tile that is neither the old nor the new disk value was edited here
+    // since the last save; it is a conflict and keeps the local value.
+    // False, with nothing applied, when the map no longer has the frame the
+    // diffs were made against.
+    bool mergeReload(const std::vector<TileDiff>& diffs, ReloadMerge& out);
+
+private:
+    void restructured();
+};
@@ -0,0 +1,715 @@
+#include "map_io.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <istream>
+#include <iterator>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+const char MAGIC[8] = {'S', 'T', 'O', 'R', 'M', 'M', 'A', 'P'};
+const uint8_t BINARY_VERSION = 1;
+const uint8_t FLAG_ORIGIN = 1;
+const size_t STREAM_BUFFER = 1 << 16;  // bytes read at a time by the paged reader
+
+static_assert(LAYER_COUNT <= 8, "the binary layer mask is one byte");
+
+// Little-endian and LEB128 writers for the binary format
+void putU8(std::string& out, uint8_t v) {
+    out.push_back(static_cast<char>(v));
+}
+
+void putU32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i)
+        putU8(out, static_cast<uint8_t>(v >> (8 * i)));
+}
+
+void putVarint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        putU8(out, static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    putU8(out, static_cast<uint8_t>(v));
+}
+
+// Reads past the end set `ok` to false and return 0. Given a stream, the
+// bytes come from it a buffer at a time instead.
+struct ByteReader {
+    const unsigned char* p;
+    const unsigned char* end;
+    bool ok = true;
+    std::istream* stream = nullptr;
+    std::vector<unsigned char> buffer{};
+
+    uint8_t u8() {
+        if (p == end && !refill()) {
+            ok = false;
+            return 0;
+        }
+        return *p++;
+    }
+
+    bool refill() {
+        if (!stream) return false;
+        buffer.resize(STREAM_BUFFER);
+        stream->read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        p = buffer.data();
+        end = p + stream->gcount();
+        return p != end;
+    }
+
+    bool atEnd() { return p == end && !refill(); }
+
+    uint32_t u32() {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i)
+            v |= static_cast<uint32_t>(u8()) << (8 * i);
+        return v;
+    }
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = u8();
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+bool isBinary(const std::string& data) {
+    return data.size() >= sizeof MAGIC && std::equal(MAGIC, MAGIC + sizeof MAGIC, data.begin());
+}
+
+// Reads one run; false at the end of the data or on a malformed run
+bool readRun(ByteReader& in, uint8_t tileBytes, uint64_t& count, uint32_t& id) {
+    count = in.varint();
+    id = in.u8();
+    if (tileBytes == 2) id |= static_cast<uint32_t>(in.u8()) << 8;
+    return in.ok && count > 0;
+}
+
+struct BinaryHeader {
+    uint8_t tileBytes, flags, layerMask;
+    uint32_t rows, cols;
+    int32_t originRow, originCol;
+};
+
+// The header after the magic, checked; errors go to std::cerr
+bool readHeader(ByteReader& in, BinaryHeader& h) {
+    uint8_t version = in.u8();
+    h.tileBytes = in.u8();
+    h.flags = in.u8();
+    h.layerMask = in.u8();
+    h.rows = in.u32();
+    h.cols = in.u32();
+    h.originRow = static_cast<int32_t>(in.u32());
+    h.originCol = static_cast<int32_t>(in.u32());
+    if (!in.ok || version != BINARY_VERSION || (h.tileBytes != 1 && h.tileBytes != 2)) {
+        std::cerr << "Unsupported binary map (version " << int(version) << ", " << int(h.tileBytes)
+                  << "-byte tiles)\n";
+        return false;
+    }
+    // Sides and chunk numbers are ints in paged storage; whether the runs
+    // really cover this size is up to the caller (scanRuns)
+    const uint64_t maxSide = static_cast<uint64_t>(INT_MAX) - PACK_CHUNK;
+    auto chunksOf = [](uint32_t side) { return (uint64_t(side) + PACK_CHUNK - 1) / PACK_CHUNK; };
+    uint64_t chunks = chunksOf(h.rows) * chunksOf(h.cols);
+    if (h.rows > maxSide || h.cols > maxSide || chunks > static_cast<uint64_t>(INT_MAX) ||
+        h.layerMask >= (1u << LAYER_COUNT) || !(h.layerMask & 1u)) {
+        std::cerr << "Binary map header is corrupt (" << h.rows << "x" << h.cols << ", layers " << int(h.layerMask)
+                  << ")\n";
+        return false;
+    }
+    return true;
+}
+
+// Check that the runs cover every stored layer exactly and use up the
+// data, without storing any tiles, so a corrupt header costs nothing
+bool scanRuns(ByteReader& in, const BinaryHeader& h) {
+    uint64_t total = uint64_t(h.rows) * h.cols;
+    for (int l = 0; l < LAYER_COUNT; ++l) {
+        if (!(h.layerMask & (1u << l))) continue;
+        uint64_t count;
+        uint32_t id;
+        for (uint64_t done = 0; done < total; done += count)
+            if (!readRun(in, h.tileBytes, count, id) || count > total - done) {
+                std::cerr << "Binary map is truncated or corrupt (layer '" << LAYER_NAMES[l] << "')\n";
+                return false;
+            }
+    }
+    if (!in.atEnd()) {
+        std::cerr << "Binary map has trailing data\n";
+        return false;
+    }
+    return true;
+}
+
+// Opens a binary map and reads its header; false without a message when
+// the file isn't one
+bool openBinary(const std::string& path, std::ifstream& inFile, ByteReader& in, BinaryHeader& h) {
+    inFile.open(path, std::ios::binary);
+    char magic[sizeof MAGIC];
+    if (!inFile || !inFile.read(magic, sizeof magic) || !std::equal(MAGIC, MAGIC + sizeof MAGIC, magic))
+        return false;
+    in.stream = &inFile;
+    return readHeader(in, h);
+}
+
+bool parseBinaryMap(const std::string& data, MapFile& out) {
+    ByteReader in{reinterpret_cast<const unsigned char*>(data.data()) + sizeof MAGIC,
+                  reinterpret_cast<const unsigned char*>(data.data()) + data.size()};
+    BinaryHeader h;
+    if (!readHeader(in, h)) return false;
+    uint8_t tileBytes = h.tileBytes, layerMask = h.layerMask;
+    uint32_t rows = h.rows, cols = h.cols;
+
+    // Before allocating anything
+    ByteReader scan = in;
+    if (!scanRuns(scan, h)) return false;
+    size_t total = static_cast<size_t>(rows) * cols;
+
+    // Layers not stored stay unallocated
+    out = MapFile();
+    for (int l = 0; l < LAYER_COUNT; ++l) {
+        if (!(layerMask & (1u << l))) continue;
+        TileGrid plane(static_cast<int>(rows), static_cast<int>(cols), EMPTY_TILE);
+        Tile* cell = plane.row(0);  // a new grid has its rows back to back
+        uint64_t count;
+        uint32_t id;
+        for (size_t done = 0; done < total; done += count) {
+            readRun(in, tileBytes, count, id);
+            Tile t = EMPTY_TILE;
+            if (id < TILE_KINDS)
+                t = static_cast<Tile>(id);
+            else
+                out.unknown += count;
+            std::fill_n(cell + done, count, t);
+        }
+        out.planes[l] = std::move(plane);
+    }
+
+    out.hasOrigin = h.flags & FLAG_ORIGIN;
+    out.originRow = out.hasOrigin ? h.originRow : 0;
+    out.originCol = out.hasOrigin ? h.originCol : 0;
+    return true;
+}
+
+// Row access for both kinds of plane, so snapshots and freshly read files
+// serialize through the same code
+void readPlaneRow(const PackedGrid& plane, int row, int col, int count, Tile* out) {
+    plane.readRow(row, col, count, out);
+}
+
+void readPlaneRow(const TileGrid& plane, int row, int col, int count, Tile* out) {
+    std::copy_n(plane.row(row) + col, count, out);
+}
+
+template <typename Plane>
+json planeValues(const Plane& plane, const TileArea& area, const Palette& palette) {
+    json j = json::array();
+    std::vector<Tile> line(area.width);
+    for (int r = area.top; r < area.top + area.height; ++r) {
+        readPlaneRow(plane, r, area.left, area.width, line.data());
+        json lineJson = json::array();
+        for (Tile t : line)
+            lineJson.push_back(palette.toJson(t));
+        j.push_back(lineJson);
+    }
+    return j;
+}
+
+// The parts of a map document: `area` of each non-blank plane, and the
+// world position of its top-left tile when it is a canvas map
+template <typename Plane>
+struct MapParts {
+    const std::array<Plane, LAYER_COUNT>& planes;
+    std::array<bool, LAYER_COUNT> blank;
+    TileArea area;
+    bool canvas;
+    int originRow, originCol;
+};
+
+template <typename Plane>
+json documentJson(const MapParts<Plane>& map, const Palette& palette) {
+    json j = planeValues(map.planes[LAYER_TERRAIN], map.area, palette);
+    json extra = json::object();
+    for (int l = 1; l < LAYER_COUNT; ++l)
+        if (!map.blank[l])
+            extra[LAYER_NAMES[l]] = planeValues(map.planes[l], map.area, palette);
+    if (map.canvas)
+        j = {{"tiles", j}, {"origin", {map.originRow, map.originCol}}};
+    else if (!extra.empty())
+        j = {{"tiles", j}};
+    if (!extra.empty())
+        j["layers"] = extra;
+    return j;
+}
+
+// Appends one layer's runs to `out`, fed any number of tiles at a time;
+// runs continue across calls (and so across row ends)
+struct RunWriter {
+    std::string& out;
+    uint64_t count = 0;
+    Tile current = EMPTY_TILE;
+
+    void add(const Tile* tiles, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            if (count > 0 && tiles[i] != current) {
+                flush();
+                count = 0;
+            }
+            current = tiles[i];
+            ++count;
+        }
+    }
+
+    void finish() {
+        if (count > 0) flush();
+        count = 0;
+    }
+
+    void flush() {
+        putVarint(out, count);
+        putU8(out, static_cast<uint8_t>(current));
+        if (sizeof(Tile) == 2) putU8(out, static_cast<uint8_t>(current >> 8));
+    }
+};
+
+// One plane's runs, row by row
+template <typename Plane>
+void encodeRuns(std::string& out, const Plane& plane, const TileArea& area) {
+    std::vector<Tile> line(area.width);
+    RunWriter runs{out};
+    for (int r = area.top; r < area.top + area.height; ++r) {
+        readPlaneRow(plane, r, area.left, area.width, line.data());
+        runs.add(line.data(), line.size());
+    }
+    runs.finish();
+}
+
+// Terrain is always stored, so the size is never ambiguous
+uint8_t layerMaskOf(const std::array<bool, LAYER_COUNT>& blank) {
+    uint8_t layerMask = 1;
+    for (int l = 1; l < LAYER_COUNT; ++l)
+        if (!blank[l])
+            layerMask |= static_cast<uint8_t>(1u << l);
+    return layerMask;
+}
+
+void putHeader(std::string& out, uint8_t layerMask, const TileArea& area, bool canvas, int originRow,
+               int originCol) {
+    out.append(MAGIC, sizeof MAGIC);
+    putU8(out, BINARY_VERSION);
+    putU8(out, sizeof(Tile));
+    putU8(out, canvas ? FLAG_ORIGIN : 0);
+    putU8(out, layerMask);
+    putU32(out, static_cast<uint32_t>(area.height));
+    putU32(out, static_cast<uint32_t>(area.width));
+    putU32(out, static_cast<uint32_t>(canvas ? originRow : 0));
+    putU32(out, static_cast<uint32_t>(canvas ? originCol : 0));
+}
+
+template <typename Plane>
+std::string documentBinary(const MapParts<Plane>& map) {
+    uint8_t layerMask = layerMaskOf(map.blank);
+    std::string out;
+    putHeader(out, layerMask, map.area, map.canvas, map.originRow, map.originCol);
+    for (int l = 0; l < LAYER_COUNT; ++l)
+        if (layerMask & (1u << l))
+            encodeRuns(out, map.planes[l], map.area);
+    return out;
+}
+
+template <typename Plane>
+std::string encodeDocument(const MapParts<Plane>& map, const Palette& palette, MapFormat format) {
+    switch (format) {
+        case MapFormat::Json: return documentJson(map, palette).dump(2);
+        case MapFormat::Compact: return documentJson(map, palette).dump();
+        case MapFormat::Binary: break;
+    }
+    return documentBinary(map);
+}
+
+// Union of the per-layer bounds; just the top-left tile when all are blank
+template <typename Bounds>
+TileArea unionArea(Bounds&& bounds) {
+    bool found = false;
+    int top = 0, left = 0, bottom = 0, right = 0;
+    for (int l = 0; l < LAYER_COUNT; ++l) {
+        int t, lf, b, r;
+        if (!bounds(l, t, lf, b, r)) continue;
+        top = found ? std::min(top, t) : t;
+        left = found ? std::min(left, lf) : lf;
+        bottom = found ? std::max(bottom, b) : b;
+        right = found ? std::max(right, r) : r;
+        found = true;
+    }
+    return {top, left, bottom - top + 1, right - left + 1};
+}
+
+// Through `path`.tmp renamed over `path`, so the file is never left
+// half-written and a hot reload sees one complete change
+bool replaceFile(const std::string& path, const std::function<bool(std::ostream&)>& write) {
+    namespace fs = std::filesystem;
+    fs::path temp = path + ".tmp";
+    {
+        std::ofstream outFile(temp, std::ios::binary | std::ios::trunc);
+        if (!outFile || !write(outFile) || !outFile.flush()) {
+            std::cerr << "Failed to write to file: " << temp.string() << "\n";
+            outFile.close();
+            std::error_code ec;
+            fs::remove(temp, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temp, path, ec);
+    if (ec) {
+        std::cerr << "Failed to replace " << path << ": " << ec.message() << "\n";
+        fs::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+MapParts<PackedGrid> snapshotParts(const MapSnapshot& snap, bool canvas, int originRow, int originCol) {
+    TileArea area = canvas ? occupiedArea(snap) : TileArea{0, 0, snap.rows(), snap.cols()};
+    MapParts<PackedGrid> map{snap.planes, {}, area, canvas, originRow + area.top, originCol + area.left};
+    for (int l = 0; l < LAYER_COUNT; ++l)
+        map.blank[l] = snap.blank(l);
+    return map;
+}
+
+}  // namespace
+
+bool readMapFile(const std::string& path, const Palette& palette, MapFile& out) {
+    std::ifstream inFile(path, std::ios::binary);
+    if (!inFile) {
+        std::cerr << "Failed to open " << path << "\n";
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+    return parseMap(data, palette, out);
+}
+
+bool parseMap(const std::string& data, const Palette& palette, MapFile& out) {
+    if (isBinary(data)) {
+        if (!parseBinaryMap(data, out)) return false;
+        out.format = MapFormat::Binary;
+        return true;
+    }
+    // An indented document always breaks lines
+    out.format = data.find('\n') == std::string::npos ? MapFormat::Compact : MapFormat::Json;
+
+    // 1) Parse JSON:
+    json j;
+    try {
+        j = json::parse(data);
+    } catch (json::parse_error& e) {
+        std::cerr << "JSON parse error: " << e.what() << "\n";
+        return false;
+    }
+
+    // 2) Extract the tiles-array, whichever shape it is:
+    json tilesArr;
+    if (j.is_object() && j.contains("tiles") && j["tiles"].is_array()) {
+        tilesArr = j["tiles"];
+    } else if (j.is_array()) {
+        tilesArr = j;
+    } else {
+        std::cerr << "Unexpected JSON format—expected array or { tiles: [...] }\n";
+        return false;
+    }
+
+    // 3) Validate the rows and find the widest one:
+    size_t maxCols = 0;
+    for (const auto& rowJson : tilesArr) {
+        if (!rowJson.is_array()) {
+            std::cerr << "Each row must be an array\n";
+            return false;
+        }
+        maxCols = std::max(maxCols, rowJson.size());
+    }
+
+    // 4) Fill a single contiguous grid; short rows stay padded with '.':
+    //    Values go through the palette; unknown ones stay '.':
+    TileGrid terrain(static_cast<int>(tilesArr.size()), static_cast<int>(maxCols), EMPTY_TILE);
+    out.unknown = 0;
+    int r = 0;
+    for (const auto& rowJson : tilesArr) {
+        int c = 0;
+        for (const auto& cellJson : rowJson) {
+            Tile id;
+            if (palette.fromJson(cellJson, id))
+                terrain.at(r, c) = id;
+            else
+                ++out.unknown;
+            ++c;
+        }
+        ++r;
+    }
+
+    // 5) Any extra layers the file has, sized to match the terrain:
+    for (int l = 1; l < LAYER_COUNT; ++l) {
+        out.planes[l] = TileGrid();
+        if (!j.is_object() || !j.contains("layers") || !j["layers"].contains(LAYER_NAMES[l]))
+            continue;
+        TileGrid plane(terrain.rows(), terrain.cols(), EMPTY_TILE);
+        const json& layerArr = j["layers"][LAYER_NAMES[l]];
+        for (int lr = 0; lr < std::min(plane.rows(), static_cast<int>(layerArr.size())); ++lr) {
+            const json& rowJson = layerArr[lr];
+            if (!rowJson.is_array()) continue;
+            for (int lc = 0; lc < std::min(plane.cols(), static_cast<int>(rowJson.size())); ++lc) {
+                Tile id;
+                if (palette.fromJson(rowJson[lc], id))
+                    plane.at(lr, lc) = id;
+                else
+                    ++out.unknown;
+            }
+        }
+        out.planes[l] = std::move(plane);
+    }
+    out.planes[LAYER_TERRAIN] = std::move(terrain);
+
+    // An "origin" marks a map saved from the infinite canvas
+    out.hasOrigin = j.is_object() && j.contains("origin") && j["origin"].is_array() && j["origin"].size() == 2 &&
+                    j["origin"][0].is_number_integer() && j["origin"][1].is_number_integer();
+    out.originRow = out.hasOrigin ? j["origin"][0].get<int>() : 0;
+    out.originCol = out.hasOrigin ? j["origin"][1].get<int>() : 0;
+    return true;
+}
+
+bool peekMapSize(const std::string& path, int& rows, int& cols) {
+    std::ifstream inFile;
+    ByteReader in{nullptr, nullptr};
+    BinaryHeader h;
+    if (!openBinary(path, inFile, in, h)) return false;
+    rows = static_cast<int>(h.rows);
+    cols = static_cast<int>(h.cols);
+    return true;
+}
+
+bool readMapPaged(const std::string& path, size_t budgetBytes, PagedMapFile& out) {
+    // One pass over the runs before the page files are sized by the header
+    {
+        std::ifstream scanFile;
+        ByteReader scan{nullptr, nullptr};
+        BinaryHeader h;
+        if (!openBinary(path, scanFile, scan, h)) {
+            std::cerr << "Failed to open " << path << " as a binary map\n";
+            return false;
+        }
+        if (!scanRuns(scan, h)) return false;
+    }
+    std::ifstream inFile;
+    ByteReader in{nullptr, nullptr};
+    BinaryHeader h;
+    if (!openBinary(path, inFile, in, h)) {
+        std::cerr << "Failed to open " << path << " as a binary map\n";
+        return false;
+    }
+    int rows = static_cast<int>(h.rows), cols = static_cast<int>(h.cols);
+
+    // Runs are decoded a band of PACK_CHUNK rows at a time, each band going
+    // to the page file before the next is read
+    out = PagedMapFile();
+    for (int l = 0; l < LAYER_COUNT; ++l) {
+        PagedGrid plane(rows, cols, budgetBytes);
+        if (!plane.ok()) return false;
+        if (h.layerMask & (1u << l)) {
+            // Made and cut down tight, so runs fill it as one array
+            TileGrid band(std::min(PACK_CHUNK, rows), cols, EMPTY_TILE);
+            uint64_t count = 0;
+            uint32_t id = 0;
+            for (int top = 0; top < rows; top += PACK_CHUNK) {
+                int height = std::min(PACK_CHUNK, rows - top);
+                if (height < band.rows()) band.reframe(height, cols, 0, 0);
+                for (size_t filled = 0; filled < band.size();) {
+                    if (count == 0) {
+                        if (!readRun(in, h.tileBytes, count, id)) {
+                            std::cerr << "Binary map is truncated or corrupt (layer '" << LAYER_NAMES[l] << "')\n";
+                            return false;
+                        }
+                        if (id >= TILE_KINDS) out.unknown += count;
+                    }
+                    size_t n = static_cast<size_t>(std::min<uint64_t>(count, band.size() - filled));
+                    std::fill_n(band.row(0) + filled, n, id < TILE_KINDS ? static_cast<Tile>(id) : EMPTY_TILE);
+                    filled += n;
+                    count -= n;
+                }
+                plane.writeRows(top, band);
+            }
+            if (count > 0) {
+                std::cerr << "Binary map is corrupt (layer '" << LAYER_NAMES[l] << "' runs past its end)\n";
+                return false;
+            }
+        }
+        out.planes[l] = std::move(plane);
+    }
+    if (!in.atEnd()) {
+        std::cerr << "Binary map has trailing data\n";
+        return false;
+    }
+
+    out.hasOrigin = h.flags & FLAG_ORIGIN;
+    out.originRow = out.hasOrigin ? h.originRow : 0;
+    out.originCol = out.hasOrigin ? h.originCol : 0;
+    return true;
+}
+
+TileArea occupiedArea(const MapSnapshot& snap) {
+    return unionArea([&](int layer, int& top, int& left, int& bottom, int& right) {
+        return snap.planes[layer].occupiedBounds(top, left, bottom, right);
+    });
+}
+
+TileArea occupiedArea(const LayerStack& layers) {
+    return unionArea([&](int layer, int& top, int& left, int& bottom, int& right) {
+        return layers.occupiedBounds(layer, top, left, bottom, right);
+    });
+}
+
+json planeToJson(const PackedGrid& plane, const TileArea& area, const Palette& palette) {
+    return planeValues(plane, area, palette);
+}
+
+json layersToJson(const MapSnapshot& snap, const TileArea& area, const Palette& palette) {
+    json j = json::object();
+    for (int l = 1; l < LAYER_COUNT; ++l)
+        if (!snap.blank(l))
+            j[LAYER_NAMES[l]] = planeValues(snap.planes[l], area, palette);
+    return j;
+}
+
+json mapToJson(const MapSnapshot& snap, bool canvas, int originRow, int originCol, const Palette& palette) {
+    return documentJson(snapshotParts(snap, canvas, originRow, originCol), palette);
+}
+
+std::string encodeMap(const MapSnapshot& snap, bool canvas, int originRow, int originCol,
+                      const Palette& palette, MapFormat format) {
+    return encodeDocument(snapshotParts(snap, canvas, originRow, originCol), palette, format);
+}
+
+std::string encodeMap(const MapFile& file, const Palette& palette, MapFormat format) {
+    const TileGrid& terrain = file.planes[LAYER_TERRAIN];
+    MapParts<TileGrid> map{file.planes, {}, {0, 0, terrain.rows(), terrain.cols()},
+                           file.hasOrigin, file.originRow, file.originCol};
+    for (int l = 0; l < LAYER_COUNT; ++l) {
+        const TileGrid& plane = file.planes[l];
+        map.blank[l] = true;
+        for (int r = 0; r < plane.rows() && map.blank[l]; ++r)
+            map.blank[l] = std::all_of(plane.row(r), plane.row(r) + plane.cols(), [](Tile t) { return t == EMPTY_TILE; });
+    }
+    return encodeDocument(map, palette, format);
+}
+
+bool writeMapFile(const std::string& path, const std::string& data) {
+    return replaceFile(path, [&](std::ostream& os) {
+        return static_cast<bool>(os.write(data.data(), static_cast<std::streamsize>(data.size())));
+    });
+}
+
+bool writeMapStreamed(const std::string& path, const LayerStack& layers, bool canvas, int originRow,
+                      int originCol) {
+    TileArea area = canvas ? occupiedArea(layers) : TileArea{0, 0, layers.rows(), layers.cols()};
+    std::array<bool, LAYER_COUNT> blank{};
+    for (int l = 1; l < LAYER_COUNT; ++l)
+        blank[l] = layers.blank(l);
+    uint8_t layerMask = layerMaskOf(blank);
+
+    return replaceFile(path, [&](std::ostream& os) {
+        // Encoded bytes go out whenever a buffer's worth has built up
+        std::string out;
+        auto drain = [&] {
+            os.write(out.data(), static_cast<std::streamsize>(out.size()));
+            out.clear();
+        };
+        putHeader(out, layerMask, area, canvas, originRow + area.top, originCol + area.left);
+        TileGrid band;
+        for (int l = 0; l < LAYER_COUNT; ++l) {
+            if (!(layerMask & (1u << l))) continue;
+            RunWriter runs{out};
+            for (int top = 0; top < area.height && os; top += PACK_CHUNK) {
+                int height = std::min(PACK_CHUNK, area.height - top);
+                if (band.rows() != height) band = TileGrid(height, area.width);
+                layers.readRows(l, area.top + top, area.left, band);
+                runs.add(band.row(0), band.size());
+                if (out.size() >= STREAM_BUFFER) drain();
+            }
+            runs.finish();
+        }
+        drain();
+        return static_cast<bool>(os);
+    });
+}
+
+bool createEmptyMapFile(const std::string& path, int rows, int cols, const Palette& palette) {
+    MapFile file;
+    file.planes[LAYER_TERRAIN] = TileGrid(rows, cols);
+    return writeMapFile(path, encodeMap(file, palette, MapFormat::Json));
+}
+
+bool diffMap(const MapSnapshot& base, const MapFile& file, int rowOffset, int colOffset,
+             std::vector<TileDiff>& out) {
+    int rows = base.rows(), cols = base.cols();
+    int fileRows = file.planes[LAYER_TERRAIN].rows(), fileCols = file.planes[LAYER_TERRAIN].cols();
+
+    // Part of the file that lands inside the snapshot, in file coordinates
+    int top = std::max(0, -rowOffset), bottom = std::min(fileRows, rows - rowOffset);
+    int left = std::max(0, -colOffset), right = std::min(fileCols, cols - colOffset);
+    if (top > 0 || left > 0 || bottom < fileRows || right < fileCols) {
+        for (const TileGrid& plane : file.planes)
+            for (int r = 0; r < (plane.empty() ? 0 : fileRows); ++r)
+                for (int c = 0; c < fileCols; ++c)
+                    if (plane.at(r, c) != EMPTY_TILE && (r < top || r >= bottom || c < left || c >= right))
+                        return false;
+    }
+
+    // Bands of chunk rows, each with its own output
+    int chunkRows = (rows + PACK_CHUNK - 1) / PACK_CHUNK, chunkCols = (cols + PACK_CHUNK - 1) / PACK_CHUNK;
+    std::vector<std::vector<TileDiff>> bandDiffs(workerCount());
+    for (int l = 0; l < LAYER_COUNT; ++l) {
+        const PackedGrid& have = base.planes[l];
+        const TileGrid& plane = file.planes[l];
+        parallelForRows(chunkRows, [&](int begin, int end, int band) {
+            auto& found = bandDiffs[band];
+            Tile current[PACK_CHUNK], incoming[PACK_CHUNK];
+            for (int cr = begin; cr < end; ++cr)
+                for (int cc = 0; cc < chunkCols; ++cc) {
+                    int c0 = cc * PACK_CHUNK, width = std::min(PACK_CHUNK, cols - c0);
+                    for (int r = cr * PACK_CHUNK; r < std::min(rows, (cr + 1) * PACK_CHUNK); ++r) {
+                        have.readRow(r, c0, width, current);
+                        std::fill(incoming, incoming + width, EMPTY_TILE);
+                        int fr = r - rowOffset;
+                        if (!plane.empty() && fr >= top && fr < bottom) {
+                            int from = std::max(c0 - colOffset, left), to = std::min(c0 + width - colOffset, right);
+                            if (from < to)
+                                std::copy(plane.row(fr) + from, plane.row(fr) + to, incoming + (from + colOffset - c0));
+                        }
+                        if (std::equal(current, current + width, incoming)) continue;
+                        for (int i = 0; i < width; ++i)
+                            if (current[i] != incoming[i])
+                                found.push_back({l, r, c0 + i, current[i], incoming[i]});
+                    }
+                }
+        }, 1);
+        // Layer by layer, so each layer's tiles stay together
+        for (auto& found : bandDiffs) {
+            out.insert(out.end(), found.begin(), found.end());
+            found.clear();
+        }
+    }
+    return true;
+}
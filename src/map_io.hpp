@@ -0,0 +1,128 @@
+// Reading and writing map files, and comparing one against a snapshot of
+// the map
+//
+// map.json is either a nested array of terrain values or an object
+// { tiles, layers?, origin? }; values go through the palette. The same
+// document can be written without whitespace (MapFormat::Compact), or as
+// a binary file:
+//
+//   "STORMMAP"                 magic
+//   u8 version (1), u8 tile bytes (1 or 2), u8 flags (1 = has origin),
+//   u8 layer mask (bit l set when layer l is stored)
+//   u32 rows, u32 cols, i32 originRow, i32 originCol
+//   per stored layer: (varint count, tile) runs covering it row by row
+//
+// Integers are little-endian, varints LEB128. Binary files hold raw tile
+// IDs rather than palette values, so they only round-trip with the same
+// palette. Layers left out are empty. A header is only held to what paged
+// storage can address; the runs are checked to cover exactly the size it
+// gives before anything of that size is allocated. Nothing here touches the editor, so
+// reading and writing can run on worker threads.
+
+#pragma once
+
+#include "layers.hpp"
+#include "palette.hpp"
+#include "tile_grid.hpp"
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Largest map, per side, the editor creates or grows to. Files may be
+// larger; those that don't fit in memory are opened paged.
+const int MAX_MAP_SIZE = 10000;
+
+enum class MapFormat {
+    Json,     // indented, as the editor saves
+    Compact,  // the same document without whitespace
+    Binary,
+};
+
+// A map file as read from disk. Layers the file has are the terrain's size;
+// the others stay empty (0x0) and mean blank.
+struct MapFile {
+    std::array<TileGrid, LAYER_COUNT> planes;
+    bool hasOrigin = false;  // saved from the infinite canvas
+    int originRow = 0, originCol = 0;
+    size_t unknown = 0;      // values not in the palette, left empty
+    MapFormat format = MapFormat::Json;  // as found, so a save can keep it
+};
+
+// Either format, told apart by the magic. Errors go to std::cerr.
+bool readMapFile(const std::string& path, const Palette& palette, MapFile& out);
+bool parseMap(const std::string& data, const Palette& palette, MapFile& out);
+
+// A binary map read straight into paged storage. Every layer is the
+// terrain's size; those the file doesn't have are blank.
+struct PagedMapFile {
+    std::array<PagedGrid, LAYER_COUNT> planes;
+    bool hasOrigin = false;
+    int originRow = 0, originCol = 0;
+    size_t unknown = 0;  // tile IDs past TILE_KINDS, left empty
+};
+
+// Size from a binary map's header without reading the rest; false for
+// JSON files
+bool peekMapSize(const std::string& path, int& rows, int& cols);
+
+// Streams the file a band of chunk rows at a time, so the map never has to
+// fit in memory; only binary maps can be read this way
+bool readMapPaged(const std::string& path, size_t budgetBytes, PagedMapFile& out);
+
+// A rectangle of the map in tile coordinates
+struct TileArea {
+    int top, left, height, width;
+};
+
+// Rectangle around every non-empty tile of any layer; just the top-left
+// tile for a blank map
+TileArea occupiedArea(const MapSnapshot& snap);
+TileArea occupiedArea(const LayerStack& layers);
+
+// Nested array of one plane's values within `area`
+nlohmann::json planeToJson(const PackedGrid& plane, const TileArea& area, const Palette& palette);
+
+// Non-terrain layers with content, by name
+nlohmann::json layersToJson(const MapSnapshot& snap, const TileArea& area, const Palette& palette);
+
+// Plain nested array of the terrain, or { tiles, layers } once any other
+// layer has content. A canvas map keeps only its occupied rectangle, with
+// that rectangle's world position as "origin" (originRow/originCol being
+// where the snapshot's top-left tile sits).
+nlohmann::json mapToJson(const MapSnapshot& snap, bool canvas, int originRow, int originCol,
+                         const Palette& palette);
+
+// The file contents for `format`; the JSON ones are mapToJson
+std::string encodeMap(const MapSnapshot& snap, bool canvas, int originRow, int originCol,
+                      const Palette& palette, MapFormat format);
+
+// A file as read, in another format: same frame and origin, no cropping
+std::string encodeMap(const MapFile& file, const Palette& palette, MapFormat format);
+
+// Through a temporary file renamed over `path`, so the file is never left
+// half-written and a hot reload sees one complete change
+bool writeMapFile(const std::string& path, const std::string& data);
+
+// The live layers as a binary map (see encodeMap), encoded a band of
+// PACK_CHUNK rows at a time straight from their storage, so a paged map is
+// never in memory whole. Runs on the calling thread, since paged layers
+// can't be read from two; written like writeMapFile.
+bool writeMapStreamed(const std::string& path, const LayerStack& layers, bool canvas, int originRow,
+                      int originCol);
+
+// A rows x cols map of EMPTY_TILE, in the format the editor saves
+bool createEmptyMapFile(const std::string& path, int rows, int cols, const Palette& palette);
+
+// One tile where a file and a snapshot disagree
+struct TileDiff {
+    int layer, row, col;
+    Tile before, after;  // snapshot, file
+};
+
+// Tiles of `base` that differ from `file` placed with its top-left corner
+// at (rowOffset, colOffset), layer by layer and chunk by chunk. Tiles the
+// file doesn't cover, and layers it doesn't have, count as EMPTY_TILE.
+// False when the file has content outside the snapshot's area.
+bool diffMap(const MapSnapshot& base, const MapFile& file, int rowOffset, int colOffset,
+             std::vector<TileDiff>& out);
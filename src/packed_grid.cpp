@@ -0,0 +1,248 @@
+#include "packed_grid.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Unpack with the width fixed at compile time, so the shift and mask fold
+// into constants and whole words are consumed at a time
+template <int Bits>
+void decodeSpan(const uint64_t* words, const Tile* palette, int index, int count, Tile* out) {
+    constexpr int PER_WORD = 64 / Bits;
+    constexpr uint64_t MASK = (uint64_t(1) << Bits) - 1;
+    int w = index / PER_WORD, slot = index % PER_WORD;
+    uint64_t word = words[w] >> (slot * Bits);
+    for (int i = 0; i < count; ++i) {
+        out[i] = palette[word & MASK];
+        word >>= Bits;
+        if (++slot == PER_WORD && i + 1 < count) {
+            slot = 0;
+            word = words[++w];
+        }
+    }
+}
+
+// Tile -> palette slot scratch table, kept all -1 between uses so a chunk
+// only pays for the entries it touches (TILE_KINDS is 65536 with wide tiles)
+std::vector<int>& slotTable() {
+    thread_local std::vector<int> table(TILE_KINDS, -1);
+    return table;
+}
+
+}  // namespace
+
+int PackedChunk::bitsFor(size_t paletteSize) {
+    if (paletteSize <= 1) return 0;
+    int bits = 1;
+    while ((size_t(1) << bits) < paletteSize) bits *= 2;
+    return bits;
+}
+
+void PackedChunk::repack(int newBits) {
+    std::vector<Tile> tiles(PACK_CHUNK_TILES);
+    decode(0, PACK_CHUNK_TILES, tiles.data());
+    bitsPerTile = newBits;
+    words.assign(static_cast<size_t>(PACK_CHUNK_TILES) * newBits / 64, 0);
+
+    // Palette order is unchanged, so each tile keeps its index
+    std::vector<int>& indexOf = slotTable();
+    for (size_t i = 0; i < palette.size(); ++i) indexOf[palette[i]] = static_cast<int>(i);
+    for (int i = 0; i < PACK_CHUNK_TILES; ++i) {
+        int bit = i * newBits;
+        words[bit >> 6] |= uint64_t(indexOf[tiles[i]]) << (bit & 63);
+    }
+    for (Tile t : palette) indexOf[t] = -1;
+}
+
+void PackedChunk::set(int index, Tile t) {
+    auto it = std::find(palette.begin(), palette.end(), t);
+    size_t slot = it - palette.begin();
+    if (it == palette.end()) {
+        palette.push_back(t);
+        int needed = bitsFor(palette.size());
+        if (needed != bitsPerTile) repack(needed);
+    }
+    if (bitsPerTile == 0) return;
+
+    int bit = index * bitsPerTile;
+    uint64_t mask = ((uint64_t(1) << bitsPerTile) - 1) << (bit & 63);
+    uint64_t& word = words[bit >> 6];
+    word = (word & ~mask) | (uint64_t(slot) << (bit & 63));
+}
+
+void PackedChunk::decode(int index, int count, Tile* out) const {
+    switch (bitsPerTile) {
+        case 0: std::fill(out, out + count, palette[0]); break;
+        case 1: decodeSpan<1>(words.data(), palette.data(), index, count, out); break;
+        case 2: decodeSpan<2>(words.data(), palette.data(), index, count, out); break;
+        case 4: decodeSpan<4>(words.data(), palette.data(), index, count, out); break;
+        case 8: decodeSpan<8>(words.data(), palette.data(), index, count, out); break;
+        default: decodeSpan<16>(words.data(), palette.data(), index, count, out); break;
+    }
+}
+
+void PackedChunk::encode(const Tile* tiles) {
+    std::vector<int>& indexOf = slotTable();
+    palette.clear();
+    for (int i = 0; i < PACK_CHUNK_TILES; ++i)
+        if (indexOf[tiles[i]] < 0) {
+            indexOf[tiles[i]] = static_cast<int>(palette.size());
+            palette.push_back(tiles[i]);
+        }
+
+    bitsPerTile = bitsFor(palette.size());
+    words.assign(static_cast<size_t>(PACK_CHUNK_TILES) * bitsPerTile / 64, 0);
+    if (bitsPerTile > 0)
+        for (int i = 0; i < PACK_CHUNK_TILES; ++i) {
+            int bit = i * bitsPerTile;
+            words[bit >> 6] |= uint64_t(indexOf[tiles[i]]) << (bit & 63);
+        }
+    for (Tile t : palette) indexOf[t] = -1;
+}
+
+size_t PackedChunk::memoryBytes() const {
+    return sizeof(PackedChunk) + palette.capacity() * sizeof(Tile) + words.capacity() * sizeof(uint64_t);
+}
+
+bool PackedChunk::occupiedBounds(int height, int width, int& top, int& left, int& bottom, int& right) const {
+    if (uniform() && uniformTile() == EMPTY_TILE) return false;
+    bool found = false;
+    Tile line[PACK_CHUNK];
+    for (int r = 0; r < height; ++r) {
+        decode(r * PACK_CHUNK, width, line);
+        for (int c = 0; c < width; ++c) {
+            if (line[c] == EMPTY_TILE) continue;
+            if (!found) {
+                top = bottom = r;
+                left = right = c;
+                found = true;
+            }
+            bottom = r;
+            left = std::min(left, c);
+            right = std::max(right, c);
+        }
+    }
+    return found;
+}
+
+PackedGrid::PackedGrid(int rows, int cols) : nRows(rows), nCols(cols) {
+    chunkCols = (nCols + PACK_CHUNK - 1) / PACK_CHUNK;
+    int chunkRows = (nRows + PACK_CHUNK - 1) / PACK_CHUNK;
+    // Blank chunks are all alike and never modified in place, so one is shared
+    chunks.assign(static_cast<size_t>(chunkRows) * chunkCols, std::make_shared<PackedChunk>());
+}
+
+PackedGrid::PackedGrid(const TileGrid& grid) : nRows(grid.rows()), nCols(grid.cols()) {
+    int chunkRows = (nRows + PACK_CHUNK - 1) / PACK_CHUNK;
+    chunkCols = (nCols + PACK_CHUNK - 1) / PACK_CHUNK;
+    chunks.resize(static_cast<size_t>(chunkRows) * chunkCols);
+
+    parallelForRows(chunkRows, [&](int begin, int end) {
+        for (int cr = begin; cr < end; ++cr)
+            for (int cc = 0; cc < chunkCols; ++cc) encodeChunk(grid, cr * chunkCols + cc);
+    }, 4);
+}
+
+void PackedGrid::encodeChunk(const TileGrid& grid, int chunk) {
+    // Tiles past the map edge pad the chunk as EMPTY_TILE
+    Tile tiles[PACK_CHUNK_TILES];
+    int top = (chunk / chunkCols) * PACK_CHUNK, left = (chunk % chunkCols) * PACK_CHUNK;
+    int height = std::min(PACK_CHUNK, nRows - top), width = std::min(PACK_CHUNK, nCols - left);
+    std::fill(tiles, tiles + PACK_CHUNK_TILES, EMPTY_TILE);
+    for (int r = 0; r < height; ++r)
+        std::copy(grid.row(top + r) + left, grid.row(top + r) + left + width, &tiles[r * PACK_CHUNK]);
+
+    // A fresh chunk rather than an in-place encode: a snapshot may hold the old one
+    auto fresh = std::make_shared<PackedChunk>();
+    fresh->encode(tiles);
+    chunks[chunk] = std::move(fresh);
+}
+
+PackedChunk& PackedGrid::writable(int chunk) {
+    if (chunks[chunk].use_count() > 1) chunks[chunk] = std::make_shared<PackedChunk>(*chunks[chunk]);
+    return *chunks[chunk];
+}
+
+void PackedGrid::readRow(int row, int col, int count, Tile* out) const {
+    int rowInChunk = (row % PACK_CHUNK) * PACK_CHUNK;
+    while (count > 0) {
+        int inChunk = col % PACK_CHUNK;
+        int n = std::min(count, PACK_CHUNK - inChunk);
+        chunks[chunkOf(row, col)]->decode(rowInChunk + inChunk, n, out);
+        out += n;
+        col += n;
+        count -= n;
+    }
+}
+
+TileGrid PackedGrid::unpack() const {
+    TileGrid grid(nRows, nCols);
+    parallelForRows(nRows, [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) readRow(r, 0, nCols, grid.row(r));
+    });
+    return grid;
+}
+
+void PackedGrid::reframe(int newRows, int newCols, int rowOffset, int colOffset) {
+    // Chunks that stay whole keep their EMPTY_TILE padding; a cut or an
+    // unaligned move goes through a dense copy
+    bool whole = rowOffset >= 0 && colOffset >= 0 && rowOffset % PACK_CHUNK == 0 && colOffset % PACK_CHUNK == 0 &&
+                 rowOffset + nRows <= newRows && colOffset + nCols <= newCols;
+    if (!whole) {
+        TileGrid dense = unpack();
+        dense.reframe(newRows, newCols, rowOffset, colOffset);
+        *this = PackedGrid(dense);
+        return;
+    }
+    PackedGrid grown(newRows, newCols);
+    int chunkRows = (nRows + PACK_CHUNK - 1) / PACK_CHUNK;
+    int rowShift = rowOffset / PACK_CHUNK, colShift = colOffset / PACK_CHUNK;
+    for (int cr = 0; cr < chunkRows; ++cr)
+        for (int cc = 0; cc < chunkCols; ++cc)
+            grown.chunks[(cr + rowShift) * grown.chunkCols + cc + colShift] = std::move(chunks[cr * chunkCols + cc]);
+    *this = std::move(grown);
+}
+
+bool PackedGrid::all(Tile t) const {
+    // Edge chunks carry EMPTY_TILE padding, so mixed chunks are only
+    // checked over the part inside the map
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const PackedChunk& chunk = *chunks[i];
+        if (chunk.uniform()) {
+            if (chunk.uniformTile() != t) return false;
+            continue;
+        }
+        int top = static_cast<int>(i / chunkCols) * PACK_CHUNK, left = static_cast<int>(i % chunkCols) * PACK_CHUNK;
+        int height = std::min(PACK_CHUNK, nRows - top), width = std::min(PACK_CHUNK, nCols - left);
+        Tile line[PACK_CHUNK];
+        for (int r = 0; r < height; ++r) {
+            chunk.decode(r * PACK_CHUNK, width, line);
+            if (!std::all_of(line, line + width, [t](Tile x) { return x == t; })) return false;
+        }
+    }
+    return true;
+}
+
+bool PackedGrid::occupiedBounds(int& top, int& left, int& bottom, int& right) const {
+    bool found = false;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        int chunkTop = static_cast<int>(i / chunkCols) * PACK_CHUNK;
+        int chunkLeft = static_cast<int>(i % chunkCols) * PACK_CHUNK;
+        int height = std::min(PACK_CHUNK, nRows - chunkTop), width = std::min(PACK_CHUNK, nCols - chunkLeft);
+        int t, l, b, r;
+        if (!chunks[i]->occupiedBounds(height, width, t, l, b, r)) continue;
+        top = found ? std::min(top, chunkTop + t) : chunkTop + t;
+        left = found ? std::min(left, chunkLeft + l) : chunkLeft + l;
+        bottom = found ? std::max(bottom, chunkTop + b) : chunkTop + b;
+        right = found ? std::max(right, chunkLeft + r) : chunkLeft + r;
+        found = true;
+    }
+    return found;
+}
+
+size_t PackedGrid::memoryBytes() const {
+    size_t total = sizeof(PackedGrid);
+    for (const auto& chunk : chunks) total += chunk->memoryBytes();
+    return total;
+}
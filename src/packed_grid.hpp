@@ -0,0 +1,104 @@
+// Palette-compressed tile storage for low-entropy layers
+//
+// The map is cut into PACK_CHUNK x PACK_CHUNK chunks. Each chunk keeps a
+// small local palette of the tiles it uses and stores per-tile palette
+// indices packed at 0 (uniform chunk), 1, 2, 4 or 8 bits (16 with wide
+// tiles). Widths are powers of two, so no index straddles a 64-bit word.
+// Writing a tile the chunk has not seen grows its palette and repacks the
+// chunk at the next width when needed.
+
+#pragma once
+
+#include "tile_grid.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+const int PACK_CHUNK = 32;
+const int PACK_CHUNK_TILES = PACK_CHUNK * PACK_CHUNK;
+
+class PackedChunk {
+public:
+    explicit PackedChunk(Tile fill = EMPTY_TILE) : palette(1, fill) {}
+
+    // index = row * PACK_CHUNK + col within the chunk
+    Tile get(int index) const {
+        if (bitsPerTile == 0) return palette[0];
+        int bit = index * bitsPerTile;
+        return palette[(words[bit >> 6] >> (bit & 63)) & ((uint64_t(1) << bitsPerTile) - 1)];
+    }
+    void set(int index, Tile t);
+
+    // Unpack count tiles starting at index
+    void decode(int index, int count, Tile* out) const;
+
+    // Replace the content with PACK_CHUNK_TILES tiles, using the smallest
+    // palette and width that fit
+    void encode(const Tile* tiles);
+
+    // Inclusive bounds, within the chunk, of the tiles other than
+    // EMPTY_TILE in its top-left height x width; false when there are none
+    bool occupiedBounds(int height, int width, int& top, int& left, int& bottom, int& right) const;
+
+    bool uniform() const { return bitsPerTile == 0; }
+    Tile uniformTile() const { return palette[0]; }
+    int bits() const { return bitsPerTile; }
+    size_t memoryBytes() const;
+
+private:
+    std::vector<Tile> palette;
+    std::vector<uint64_t> words;
+    int bitsPerTile = 0;
+
+    static int bitsFor(size_t paletteSize);
+    void repack(int newBits);
+};
+
+class PackedGrid {
+public:
+    PackedGrid() = default;
+    PackedGrid(int rows, int cols);  // all EMPTY_TILE
+    explicit PackedGrid(const TileGrid& grid);
+
+    int rows() const { return nRows; }
+    int cols() const { return nCols; }
+
+    Tile get(int row, int col) const {
+        return chunks[chunkOf(row, col)]->get((row % PACK_CHUNK) * PACK_CHUNK + col % PACK_CHUNK);
+    }
+    void set(int row, int col, Tile t) {
+        writable(chunkOf(row, col)).set((row % PACK_CHUNK) * PACK_CHUNK + col % PACK_CHUNK, t);
+    }
+
+    // Chunks in row-major order; chunkOf maps a tile to its chunk
+    int chunkCount() const { return static_cast<int>(chunks.size()); }
+    int chunkOf(int row, int col) const { return (row / PACK_CHUNK) * chunkCols + col / PACK_CHUNK; }
+
+    // Re-encode one chunk from a dense grid of the same size
+    void encodeChunk(const TileGrid& grid, int chunk);
+    void setChunk(int chunk, const PackedChunk& content) { chunks[chunk] = std::make_shared<PackedChunk>(content); }
+
+    // Unpacked copy of count tiles of a row, starting at col
+    void readRow(int row, int col, int count, Tile* out) const;
+
+    TileGrid unpack() const;
+
+    // As TileGrid::reframe, with the gap EMPTY_TILE. Growing by whole
+    // chunks moves the existing chunks over without decoding them.
+    void reframe(int newRows, int newCols, int rowOffset, int colOffset);
+
+    // True when every tile is `t`
+    bool all(Tile t) const;
+    // Smallest rectangle holding every tile other than EMPTY_TILE; false
+    // when there are none. Blank chunks are skipped without decoding.
+    bool occupiedBounds(int& top, int& left, int& bottom, int& right) const;
+    size_t memoryBytes() const;
+
+private:
+    int nRows = 0, nCols = 0, chunkCols = 0;
+    std::vector<std::shared_ptr<PackedChunk>> chunks;
+
+    // The chunk, cloned first if another copy shares it
+    PackedChunk& writable(int chunk);
+};
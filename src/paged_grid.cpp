@@ -0,0 +1,290 @@
+#include "paged_grid.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+const long SLOT_BYTES = static_cast<long>(PACK_CHUNK_TILES * sizeof(Tile));
+
+}  // namespace
+
+PagedGrid::PagedGrid(int rows, int cols, size_t budgetBytes)
+    : nRows(rows), nCols(cols), budget(budgetBytes), file(std::tmpfile(), &std::fclose) {
+    if (!file) {
+        std::cerr << "Failed to create page file\n";
+        return;
+    }
+    chunkCols = (nCols + PACK_CHUNK - 1) / PACK_CHUNK;
+    chunkTotal = ((nRows + PACK_CHUNK - 1) / PACK_CHUNK) * chunkCols;
+    slotOf.assign(chunkTotal, -1);
+}
+
+PagedGrid::PagedGrid(const TileGrid& grid, size_t budgetBytes) : PagedGrid(grid.rows(), grid.cols(), budgetBytes) {
+    if (!file) return;
+    Tile tiles[PACK_CHUNK_TILES];
+    for (int chunk = 0; chunk < chunkTotal; ++chunk) {
+        int top = (chunk / chunkCols) * PACK_CHUNK, left = (chunk % chunkCols) * PACK_CHUNK;
+        int height = std::min(PACK_CHUNK, nRows - top), width = std::min(PACK_CHUNK, nCols - left);
+        std::fill(tiles, tiles + PACK_CHUNK_TILES, EMPTY_TILE);
+        for (int r = 0; r < height; ++r)
+            std::copy(grid.row(top + r) + left, grid.row(top + r) + left + width, &tiles[r * PACK_CHUNK]);
+        storeTiles(chunk, tiles);
+    }
+}
+
+void PagedGrid::storeTiles(int chunk, const Tile* tiles) {
+    // A blank chunk needs no slot; one it had is left unused
+    if (std::all_of(tiles, tiles + PACK_CHUNK_TILES, [](Tile t) { return t == EMPTY_TILE; })) {
+        slotOf[chunk] = -1;
+        return;
+    }
+    PackedChunk content;
+    content.encode(tiles);
+    store(chunk, content);
+}
+
+PackedChunk PagedGrid::load(int chunk) const {
+    PackedChunk content;
+    if (slotOf[chunk] < 0) return content;
+    Tile tiles[PACK_CHUNK_TILES];
+    std::fseek(file.get(), slotOf[chunk] * SLOT_BYTES, SEEK_SET);
+    if (std::fread(tiles, sizeof(Tile), PACK_CHUNK_TILES, file.get()) != PACK_CHUNK_TILES) {
+        std::cerr << "Failed to read chunk " << chunk << " from the page file\n";
+        return content;
+    }
+    content.encode(tiles);
+    return content;
+}
+
+void PagedGrid::store(int chunk, const PackedChunk& content) const {
+    Tile tiles[PACK_CHUNK_TILES];
+    content.decode(0, PACK_CHUNK_TILES, tiles);
+    int slot = slotOf[chunk] < 0 ? slotCount : slotOf[chunk];
+    std::fseek(file.get(), slot * SLOT_BYTES, SEEK_SET);
+    if (std::fwrite(tiles, sizeof(Tile), PACK_CHUNK_TILES, file.get()) != PACK_CHUNK_TILES) {
+        std::cerr << "Failed to write chunk " << chunk << " to the page file\n";
+        return;
+    }
+    if (slotOf[chunk] < 0) slotOf[chunk] = slotCount++;
+}
+
+PagedGrid::Page& PagedGrid::page(int chunk) const {
+    auto it = pages.find(chunk);
+    if (it != pages.end()) {
+        lru.splice(lru.begin(), lru, it->second.lruPos);
+        return it->second;
+    }
+
+    ++faultCount;
+    lru.push_front(chunk);
+    Page& p = pages[chunk];
+    p.chunk = load(chunk);
+    p.lruPos = lru.begin();
+    resident += p.chunk.memoryBytes();
+    evict();
+    return p;
+}
+
+// Drop least recently used chunks until the cache fits the budget, always
+// keeping the one just touched
+void PagedGrid::evict() const {
+    while (resident > budget && lru.size() > 1) {
+        int victim = lru.back();
+        Page& p = pages[victim];
+        if (p.dirty) store(victim, p.chunk);
+        resident -= p.chunk.memoryBytes();
+        lru.pop_back();
+        pages.erase(victim);
+    }
+}
+
+void PagedGrid::set(int row, int col, Tile t) {
+    Page& p = page(chunkOf(row, col));
+    resident -= p.chunk.memoryBytes();
+    p.chunk.set((row % PACK_CHUNK) * PACK_CHUNK + col % PACK_CHUNK, t);
+    resident += p.chunk.memoryBytes();
+    p.dirty = true;
+}
+
+void PagedGrid::readRow(int row, int col, int count, Tile* out) const {
+    int rowInChunk = (row % PACK_CHUNK) * PACK_CHUNK;
+    while (count > 0) {
+        int inChunk = col % PACK_CHUNK;
+        int n = std::min(count, PACK_CHUNK - inChunk);
+        page(chunkOf(row, col)).chunk.decode(rowInChunk + inChunk, n, out);
+        out += n;
+        col += n;
+        count -= n;
+    }
+}
+
+void PagedGrid::writeRows(int top, const TileGrid& band) {
+    Tile tiles[PACK_CHUNK_TILES];
+    for (int bandTop = 0; bandTop < band.rows(); bandTop += PACK_CHUNK) {
+        int height = std::min(PACK_CHUNK, band.rows() - bandTop);
+        int chunkRow = (top + bandTop) / PACK_CHUNK;
+        for (int cc = 0; cc < chunkCols; ++cc) {
+            int chunk = chunkRow * chunkCols + cc, left = cc * PACK_CHUNK;
+            int width = std::min(PACK_CHUNK, nCols - left);
+            // A partial band keeps the rest of the chunk
+            if (height < PACK_CHUNK) peek(chunk).decode(0, PACK_CHUNK_TILES, tiles);
+            for (int r = 0; r < height; ++r)
+                std::copy(band.row(bandTop + r) + left, band.row(bandTop + r) + left + width, &tiles[r * PACK_CHUNK]);
+
+            auto it = pages.find(chunk);
+            if (it != pages.end()) {
+                resident -= it->second.chunk.memoryBytes();
+                lru.erase(it->second.lruPos);
+                pages.erase(it);
+            }
+            storeTiles(chunk, tiles);
+        }
+    }
+}
+
+void PagedGrid::readRows(int top, int left, TileGrid& band) const {
+    int bottom = top + band.rows(), right = left + band.cols();
+    for (int cr = top / PACK_CHUNK; cr * PACK_CHUNK < bottom; ++cr)
+        for (int cc = left / PACK_CHUNK; cc * PACK_CHUNK < right; ++cc) {
+            PackedChunk content = peek(cr * chunkCols + cc);
+            int rowBegin = std::max(top, cr * PACK_CHUNK), rowEnd = std::min(bottom, (cr + 1) * PACK_CHUNK);
+            int colBegin = std::max(left, cc * PACK_CHUNK), colEnd = std::min(right, (cc + 1) * PACK_CHUNK);
+            for (int r = rowBegin; r < rowEnd; ++r)
+                content.decode((r % PACK_CHUNK) * PACK_CHUNK + colBegin % PACK_CHUNK, colEnd - colBegin,
+                               band.row(r - top) + colBegin - left);
+        }
+}
+
+void PagedGrid::prefetch(int top, int left, int bottom, int right) const {
+    top = std::max(top, 0);
+    left = std::max(left, 0);
+    bottom = std::min(bottom, nRows - 1);
+    right = std::min(right, nCols - 1);
+    if (top > bottom || left > right) return;
+
+    // Stop once the area alone would fill the cache, or it would only
+    // evict its own chunks again
+    size_t fetched = 0;
+    for (int cr = top / PACK_CHUNK; cr <= bottom / PACK_CHUNK; ++cr)
+        for (int cc = left / PACK_CHUNK; cc <= right / PACK_CHUNK; ++cc) {
+            fetched += page(cr * chunkCols + cc).chunk.memoryBytes();
+            if (fetched >= budget) return;
+        }
+}
+
+PackedChunk PagedGrid::peek(int chunk) const {
+    auto it = pages.find(chunk);
+    return it != pages.end() ? it->second.chunk : load(chunk);
+}
+
+TileGrid PagedGrid::unpack() const {
+    TileGrid grid(nRows, nCols);
+    for (int chunk = 0; chunk < chunkTotal; ++chunk) {
+        int top = (chunk / chunkCols) * PACK_CHUNK, left = (chunk % chunkCols) * PACK_CHUNK;
+        int height = std::min(PACK_CHUNK, nRows - top), width = std::min(PACK_CHUNK, nCols - left);
+        PackedChunk content = peek(chunk);
+        for (int r = 0; r < height; ++r) content.decode(r * PACK_CHUNK, width, grid.row(top + r) + left);
+    }
+    return grid;
+}
+
+bool PagedGrid::reframe(int newRows, int newCols, int rowOffset, int colOffset) {
+    int newChunkCols = (newCols + PACK_CHUNK - 1) / PACK_CHUNK;
+    int newTotal = ((newRows + PACK_CHUNK - 1) / PACK_CHUNK) * newChunkCols;
+    bool whole = rowOffset >= 0 && colOffset >= 0 && rowOffset % PACK_CHUNK == 0 && colOffset % PACK_CHUNK == 0 &&
+                 rowOffset + nRows <= newRows && colOffset + nCols <= newCols;
+    if (whole) {
+        // Slots and cached pages stay where they are under new chunk numbers
+        int rowShift = rowOffset / PACK_CHUNK, colShift = colOffset / PACK_CHUNK;
+        auto moved = [&](int chunk) {
+            return (chunk / chunkCols + rowShift) * newChunkCols + chunk % chunkCols + colShift;
+        };
+        std::vector<int> slots(newTotal, -1);
+        for (int chunk = 0; chunk < chunkTotal; ++chunk) slots[moved(chunk)] = slotOf[chunk];
+        std::unordered_map<int, Page> cached;
+        for (auto& [chunk, p] : pages) {
+            *p.lruPos = moved(chunk);
+            cached.emplace(moved(chunk), std::move(p));
+        }
+        slotOf.swap(slots);
+        pages.swap(cached);
+        nRows = newRows;
+        nCols = newCols;
+        chunkCols = newChunkCols;
+        chunkTotal = newTotal;
+        return true;
+    }
+
+    // Only the cache and one chunk are in memory at a time
+    PagedGrid fresh(newRows, newCols, budget);
+    if (!fresh.ok()) return false;
+    Tile tiles[PACK_CHUNK_TILES];
+    for (int chunk = 0; chunk < newTotal; ++chunk) {
+        int top = (chunk / newChunkCols) * PACK_CHUNK, left = (chunk % newChunkCols) * PACK_CHUNK;
+        // The part of the chunk the old grid covers
+        int rowBegin = std::max(top, rowOffset), rowEnd = std::min({top + PACK_CHUNK, newRows, rowOffset + nRows});
+        int colBegin = std::max(left, colOffset), colEnd = std::min({left + PACK_CHUNK, newCols, colOffset + nCols});
+        if (rowBegin >= rowEnd || colBegin >= colEnd) continue;
+        std::fill(tiles, tiles + PACK_CHUNK_TILES, EMPTY_TILE);
+        for (int r = rowBegin; r < rowEnd; ++r)
+            readRow(r - rowOffset, colBegin - colOffset, colEnd - colBegin,
+                    &tiles[(r - top) * PACK_CHUNK + colBegin - left]);
+        fresh.storeTiles(chunk, tiles);
+    }
+    *this = std::move(fresh);
+    return true;
+}
+
+PackedGrid PagedGrid::snapshot() const {
+    PackedGrid snap(nRows, nCols);
+    for (int chunk = 0; chunk < chunkTotal; ++chunk) snap.setChunk(chunk, peek(chunk));
+    return snap;
+}
+
+bool PagedGrid::all(Tile t) const {
+    // Chunk by chunk past the cache, stopping at the first other tile;
+    // blank chunks are known without reading them
+    Tile line[PACK_CHUNK];
+    for (int chunk = 0; chunk < chunkTotal; ++chunk) {
+        if (slotOf[chunk] < 0 && pages.find(chunk) == pages.end()) {
+            if (t != EMPTY_TILE) return false;
+            continue;
+        }
+        PackedChunk content = peek(chunk);
+        if (content.uniform()) {
+            if (content.uniformTile() != t) return false;
+            continue;
+        }
+        // Edge chunks are padded, so only the part inside the map counts
+        int top = (chunk / chunkCols) * PACK_CHUNK, left = (chunk % chunkCols) * PACK_CHUNK;
+        int height = std::min(PACK_CHUNK, nRows - top), width = std::min(PACK_CHUNK, nCols - left);
+        for (int r = 0; r < height; ++r) {
+            content.decode(r * PACK_CHUNK, width, line);
+            if (!std::all_of(line, line + width, [t](Tile x) { return x == t; })) return false;
+        }
+    }
+    return true;
+}
+
+bool PagedGrid::occupiedBounds(int& top, int& left, int& bottom, int& right) const {
+    bool found = false;
+    for (int chunk = 0; chunk < chunkTotal; ++chunk) {
+        if (slotOf[chunk] < 0 && pages.find(chunk) == pages.end()) continue;
+        int chunkTop = (chunk / chunkCols) * PACK_CHUNK, chunkLeft = (chunk % chunkCols) * PACK_CHUNK;
+        int height = std::min(PACK_CHUNK, nRows - chunkTop), width = std::min(PACK_CHUNK, nCols - chunkLeft);
+        int t, l, b, r;
+        if (!peek(chunk).occupiedBounds(height, width, t, l, b, r)) continue;
+        top = found ? std::min(top, chunkTop + t) : chunkTop + t;
+        left = found ? std::min(left, chunkLeft + l) : chunkLeft + l;
+        bottom = found ? std::max(bottom, chunkTop + b) : chunkTop + b;
+        right = found ? std::max(right, chunkLeft + r) : chunkLeft + r;
+        found = true;
+    }
+    return found;
+}
+
+void PagedGrid::setBudget(size_t budgetBytes) {
+    budget = budgetBytes;
+    evict();
+}
@@ -0,0 +1,106 @@
+// Disk-backed tile storage for layers larger than the memory budget
+//
+// Tiles live in an anonymous temporary file, one fixed-size slot of raw
+// tiles per PACK_CHUNK x PACK_CHUNK chunk, handed out as chunks are first
+// written. Chunks are faulted in on first
+// access and kept resident as PackedChunks in an LRU page cache; once the
+// cache is over budget the least recently used chunks are dropped, and
+// dirty ones written back first. Chunks never written are blank and take
+// no disk space. Reads go through the cache too, so access from several
+// threads needs outside locking.
+
+#pragma once
+
+#include "packed_grid.hpp"
+#include "tile_grid.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+const size_t DEFAULT_PAGE_BUDGET = size_t(64) << 20;
+
+class PagedGrid {
+public:
+    PagedGrid() = default;
+    PagedGrid(int rows, int cols, size_t budgetBytes);  // all EMPTY_TILE
+    PagedGrid(const TileGrid& grid, size_t budgetBytes);
+
+    // False when the backing file could not be created
+    bool ok() const { return file != nullptr; }
+
+    int rows() const { return nRows; }
+    int cols() const { return nCols; }
+
+    Tile get(int row, int col) const {
+        return page(chunkOf(row, col)).chunk.get((row % PACK_CHUNK) * PACK_CHUNK + col % PACK_CHUNK);
+    }
+    void set(int row, int col, Tile t);
+    void readRow(int row, int col, int count, Tile* out) const;
+
+    // Replace rows [top, top + band.rows()) with `band`, which is the grid's
+    // width and starts on a chunk boundary; whole chunks go straight to the
+    // page file. For filling a grid as it is read in, a band at a time.
+    void writeRows(int top, const TileGrid& band);
+
+    // Rows [top, top + band.rows()) x cols [left, left + band.cols()) into
+    // `band`, each chunk decoded once and read past the cache; the inverse
+    // of writeRows, for streaming the grid out a band at a time
+    void readRows(int top, int left, TileGrid& band) const;
+
+    // Fault in the chunks covering rows [top, bottom] x cols [left, right]
+    // (clamped to the map), as far as the budget allows
+    void prefetch(int top, int left, int bottom, int right) const;
+
+    // Chunk by chunk, read past the cache like snapshot()
+    TileGrid unpack() const;
+
+    // As TileGrid::reframe, with the gap EMPTY_TILE. Growing by whole
+    // chunks only renumbers the slots; anything else is copied chunk by
+    // chunk into a new page file. False, with the grid unchanged, when that
+    // file could not be created.
+    bool reframe(int newRows, int newCols, int rowOffset, int colOffset);
+    // Copy of every chunk, read past the cache so it keeps its contents
+    PackedGrid snapshot() const;
+    // True when every tile is `t`; one chunk in memory at a time
+    bool all(Tile t) const;
+    // As PackedGrid::occupiedBounds; chunks never written are skipped
+    // without reading them
+    bool occupiedBounds(int& top, int& left, int& bottom, int& right) const;
+
+    void setBudget(size_t budgetBytes);
+    size_t residentBytes() const { return resident; }
+    size_t faults() const { return faultCount; }
+
+private:
+    struct Page {
+        PackedChunk chunk;
+        bool dirty = false;
+        std::list<int>::iterator lruPos;
+    };
+
+    int nRows = 0, nCols = 0, chunkCols = 0, chunkTotal = 0;
+    size_t budget = DEFAULT_PAGE_BUDGET;
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file{nullptr, &std::fclose};
+    mutable std::vector<int> slotOf;  // per chunk; -1 (blank) until first written back
+    mutable int slotCount = 0;
+
+    // Most recently used chunk first
+    mutable std::list<int> lru;
+    mutable std::unordered_map<int, Page> pages;
+    mutable size_t resident = 0;
+    mutable size_t faultCount = 0;
+
+    int chunkOf(int row, int col) const { return (row / PACK_CHUNK) * chunkCols + col / PACK_CHUNK; }
+    Page& page(int chunk) const;
+    PackedChunk load(int chunk) const;
+    void store(int chunk, const PackedChunk& content) const;
+    // Store a chunk's raw tiles; one all EMPTY_TILE goes back to blank
+    void storeTiles(int chunk, const Tile* tiles);
+    // The chunk's current content, without caching it
+    PackedChunk peek(int chunk) const;
+    void evict() const;
+};
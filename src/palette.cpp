@@ -0,0 +1,176 @@
+#include "palette.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Decode the UTF-8 code point starting at `pos`; its length in bytes, 0
+// if malformed
+size_t decodeCodePoint(const std::string& s, size_t pos, uint32_t& cp) {
+    if (pos >= s.size()) return 0;
+    auto byte = [&](size_t i) { return static_cast<uint8_t>(s[pos + i]); };
+    uint8_t lead = byte(0);
+    int extra = lead < 0x80 ? 0 : (lead & 0xE0) == 0xC0 ? 1 : (lead & 0xF0) == 0xE0 ? 2 : (lead & 0xF8) == 0xF0 ? 3 : -1;
+    if (extra < 0 || s.size() - pos < static_cast<size_t>(extra) + 1) return 0;
+    cp = extra == 0 ? lead : lead & (0x3F >> extra);
+    for (int i = 1; i <= extra; ++i) {
+        if ((byte(i) & 0xC0) != 0x80) return 0;
+        cp = cp << 6 | (byte(i) & 0x3F);
+    }
+    return static_cast<size_t>(extra) + 1;
+}
+
+// First code point of a UTF-8 string, 0 if empty or malformed
+uint32_t firstCodePoint(const std::string& s) {
+    uint32_t cp = 0;
+    return decodeCodePoint(s, 0, cp) > 0 ? cp : 0;
+}
+
+}  // namespace
+
+Palette::Palette() : glyphs(TILE_KINDS, 0), values(TILE_KINDS) {
+    bySingleChar.fill(-1);
+    for (size_t id = 0; id < TILE_KINDS; ++id) {
+        if (id >= 32 && id < 127)
+            assign(static_cast<Tile>(id), static_cast<uint32_t>(id), std::string(1, static_cast<char>(id)));
+        else
+            values[id] = id;  // not typeable, stored as a number
+    }
+}
+
+void Palette::assign(Tile id, uint32_t codePoint, const json& value) {
+    glyphs[id] = codePoint;
+    values[id] = value;
+    if (value.is_string() && value.get_ref<const std::string&>().size() == 1 &&
+        static_cast<uint8_t>(value.get_ref<const std::string&>()[0]) < 128)
+        bySingleChar[static_cast<uint8_t>(value.get_ref<const std::string&>()[0])] = id;
+    else
+        byValue[value.dump()] = id;
+    if (codePoint != 0) byGlyph[codePoint] = id;
+}
+
+bool Palette::loadFromFile(const std::string& path) {
+    std::ifstream inFile(path);
+    if (!inFile)
+        return false;  // ASCII identity palette
+
+    json j;
+    try {
+        inFile >> j;
+    } catch (json::parse_error& e) {
+        std::cerr << "Palette parse error: " << e.what() << "\n";
+        return false;
+    }
+    if (!j.is_object() || !j.contains("tiles") || !j["tiles"].is_array()) {
+        std::cerr << "Palette must be { tiles: [ ... ] }\n";
+        return false;
+    }
+
+    size_t loaded = 0;
+    for (const auto& entry : j["tiles"]) {
+        if (!entry.is_object() || !entry.contains("id") || !entry["id"].is_number_integer()) {
+            std::cerr << "Palette entries need an integer id\n";
+            continue;
+        }
+        long long id = entry["id"].get<long long>();
+        if (id < 0 || static_cast<size_t>(id) >= TILE_KINDS) {
+            std::cerr << "Palette id " << id << " does not fit " << TILE_BITS << "-bit tiles"
+                      << (TILE_BITS == 8 ? " (build with -Dwide_tiles=true)" : "") << "\n";
+            continue;
+        }
+        uint32_t cp = entry.contains("glyph") && entry["glyph"].is_string()
+                          ? firstCodePoint(entry["glyph"].get<std::string>())
+                          : 0;
+        json value = entry.contains("value") ? entry["value"] : json(id);
+        assign(static_cast<Tile>(id), cp, value);
+        ++loaded;
+    }
+
+    std::cout << "Loaded " << loaded << " palette entr" << (loaded == 1 ? "y" : "ies") << " from " << path << "\n";
+    return true;
+}
+
+bool Palette::fromJson(const json& value, Tile& id) const {
+    if (value.is_string()) {
+        const std::string& s = value.get_ref<const std::string&>();
+        if (s.size() == 1 && static_cast<uint8_t>(s[0]) < 128 && bySingleChar[static_cast<uint8_t>(s[0])] >= 0) {
+            id = static_cast<Tile>(bySingleChar[static_cast<uint8_t>(s[0])]);
+            return true;
+        }
+    }
+    auto it = byValue.find(value.dump());
+    if (it != byValue.end()) {
+        id = it->second;
+        return true;
+    }
+    if (value.is_number_integer()) {
+        long long n = value.get<long long>();
+        if (n < 0 || static_cast<size_t>(n) >= TILE_KINDS) return false;
+        id = static_cast<Tile>(n);
+        return true;
+    }
+    if (value.is_string() && !value.get_ref<const std::string&>().empty()) {
+        uint8_t c = static_cast<uint8_t>(value.get_ref<const std::string&>()[0]);
+        if (c < 128) {
+            id = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Palette::fromName(const json& name, Tile& id) const {
+    if (name.is_number_integer())
+        return fromJson(name, id);
+    if (!name.is_string()) return false;
+    const std::string& s = name.get_ref<const std::string&>();
+
+    uint32_t cp;
+    if (!s.empty() && decodeCodePoint(s, 0, cp) == s.size() && fromGlyph(cp, id))
+        return true;
+
+    // Exact values only; fromJson's first-character fallback would turn
+    // any misspelt name into some ASCII tile
+    if (s.size() == 1 && static_cast<uint8_t>(s[0]) < 128 && bySingleChar[static_cast<uint8_t>(s[0])] >= 0) {
+        id = static_cast<Tile>(bySingleChar[static_cast<uint8_t>(s[0])]);
+        return true;
+    }
+    auto it = byValue.find(name.dump());
+    if (it != byValue.end()) {
+        id = it->second;
+        return true;
+    }
+
+    if (s.size() >= 2 && s.size() <= 8 && s[0] == '#' &&
+        std::all_of(s.begin() + 1, s.end(), [](char c) { return c >= '0' && c <= '9'; }))
+        return fromJson(std::stoll(s.substr(1)), id);
+    return false;
+}
+
+bool Palette::fromGlyphs(const std::string& glyphString, std::vector<Tile>& ids) const {
+    for (size_t pos = 0; pos < glyphString.size();) {
+        uint32_t cp;
+        size_t length = decodeCodePoint(glyphString, pos, cp);
+        Tile id;
+        if (length == 0 || !fromGlyph(cp, id)) return false;
+        ids.push_back(id);
+        pos += length;
+    }
+    return true;
+}
+
+bool Palette::fromGlyph(uint32_t codePoint, Tile& id) const {
+    auto it = byGlyph.find(codePoint);
+    if (it == byGlyph.end()) return false;
+    id = it->second;
+    return true;
+}
+
+std::string Palette::label(Tile id) const {
+    if (values[id].is_string()) return values[id].get<std::string>();
+    return tileLabel(id);
+}
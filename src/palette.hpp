@@ -0,0 +1,64 @@
+// Tile palette: what each tile ID looks like in the editor and how it is
+// written to map files
+//
+// Without palette.json every printable ASCII character is its own ID,
+// drawn as itself and stored as a one-character string, which is exactly
+// the classic map.json format. palette.json adds or overrides entries:
+//
+//   { "tiles": [ { "id": 300, "glyph": "T", "value": "tree_big" },
+//                { "id": 301, "glyph": "♣", "value": 301 } ] }
+//
+// IDs must fit the build's tile width (TILE_KINDS). Typing an entry's glyph
+// paints its ID, and config files can name it by glyph, value or ID.
+
+#pragma once
+
+#include "nlohmann/json.hpp"
+#include "tile_grid.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Palette {
+public:
+    Palette();
+
+    bool loadFromFile(const std::string& path);
+
+    // Unicode code point shown for an ID (0 draws nothing)
+    uint32_t glyph(Tile id) const { return glyphs[id]; }
+
+    // Value written to map files
+    const nlohmann::json& toJson(Tile id) const { return values[id]; }
+
+    // Map file value -> ID. Accepts palette values, integer IDs, and for
+    // compatibility any other string by its first (ASCII) character.
+    bool fromJson(const nlohmann::json& value, Tile& id) const;
+
+    // Typed character -> ID
+    bool fromGlyph(uint32_t codePoint, Tile& id) const;
+
+    // Tile named in a config file (tiles.json, autotile.json,
+    // validation.json): a single glyph, a palette value, "#<id>" as in
+    // console messages, or an integer ID
+    bool fromName(const nlohmann::json& name, Tile& id) const;
+
+    // Each glyph of a string such as "#~" in turn; false if any of them
+    // isn't in the palette
+    bool fromGlyphs(const std::string& glyphString, std::vector<Tile>& ids) const;
+
+    // For console messages
+    std::string label(Tile id) const;
+
+private:
+    std::vector<uint32_t> glyphs;        // per ID
+    std::vector<nlohmann::json> values;  // per ID
+    std::array<int, 128> bySingleChar;   // one-character string values, -1 if none
+    std::unordered_map<std::string, Tile> byValue;  // other values, keyed by their JSON dump
+    std::unordered_map<uint32_t, Tile> byGlyph;
+
+    void assign(Tile id, uint32_t codePoint, const nlohmann::json& value);
+};
@@ -0,0 +1,45 @@
+// Small helpers for splitting grid passes across threads
+
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Number of worker threads to use for whole-map passes
+inline int workerCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : static_cast<int>(n);
+}
+
+// Call fn(begin, end) over [0, count) split into contiguous bands, one per
+// worker. Small inputs run inline so per-edit calls never pay for threads.
+// fn may also take a third argument, the band index (< workerCount()), for
+// per-band output buffers.
+template <typename Fn>
+void parallelForRows(int count, Fn&& fn, int minRowsPerBand = 64) {
+    auto call = [&fn](int begin, int end, int band) {
+        if constexpr (std::is_invocable_v<Fn&, int, int, int>)
+            fn(begin, end, band);
+        else
+            fn(begin, end);
+    };
+
+    int bands = std::min(workerCount(), std::max(1, count / std::max(1, minRowsPerBand)));
+    if (bands <= 1) {
+        if (count > 0) call(0, count, 0);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(bands - 1);
+    int step = (count + bands - 1) / bands;
+    for (int b = 1; b < bands; ++b) {
+        int begin = b * step, end = std::min(count, begin + step);
+        if (begin < end)
+            threads.emplace_back([&call, begin, end, b] { call(begin, end, b); });
+    }
+    call(0, std::min(count, step), 0);
+    for (auto& t : threads) t.join();
+}
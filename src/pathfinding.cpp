@@ -0,0 +1,261 @@
+#include "pathfinding.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const float SQRT2 = 1.41421356f;
+
+float octile(int r0, int c0, int r1, int c1) {
+    int dr = std::abs(r1 - r0), dc = std::abs(c1 - c0);
+    return static_cast<float>(std::max(dr, dc)) + (SQRT2 - 1.f) * static_cast<float>(std::min(dr, dc));
+}
+
+int sign(int v) { return (v > 0) - (v < 0); }
+
+bool heapLess(float fa, float fb) { return fa > fb; }  // min-heap on f
+
+static_assert(std::endian::native == std::endian::little, "scan() reads tiles as little-endian byte lanes");
+
+const uint64_t ONES = 0x0101010101010101ULL;
+
+uint64_t load8(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+}  // namespace
+
+// Steps from plane[from] in direction dir (+1/-1) along a line until the
+// first tile that is either solid (blocked = true) or has a forced
+// neighbour: a side tile that is open while the one behind it is solid.
+// Looks at 8 tiles per iteration. Returns limit if that comes first.
+int PathFinder::scan(const uint8_t* plane, size_t from, int dir, size_t lineStride, int limit, bool& blocked) const {
+    blocked = false;
+    for (int steps = 1; steps <= limit; steps += 8) {
+        // Lanes hold tiles from+dir*steps ... from+dir*(steps+7); for dir -1
+        // they are loaded from the low end and read from the top lane down
+        size_t base = dir > 0 ? from + steps : from - steps - 7;
+        const uint8_t* p = plane + base;
+        const uint8_t* behind = p - dir;
+        uint64_t wall = ~load8(p) & ONES;
+        uint64_t forced = (load8(p - lineStride) & ~load8(behind - lineStride)) |
+                          (load8(p + lineStride) & ~load8(behind + lineStride));
+        uint64_t stop = wall | (forced & ONES);
+        if (!stop) continue;
+
+        int lane = dir > 0 ? std::countr_zero(stop) / 8 : 7 - std::countl_zero(stop) / 8;
+        int at = steps + (dir > 0 ? lane : 7 - lane);
+        if (at >= limit) return limit;
+        blocked = (wall >> (lane * 8)) & 1;
+        return at;
+    }
+    return limit;
+}
+
+// Walk from (r, c) in a straight line until a jump point (goal or a tile
+// with a forced neighbour); r/c are left on it. False if we hit a wall.
+bool PathFinder::jumpStraight(int& r, int& c, int dr, int dc) const {
+    int goalR = goalNode / cols, goalC = goalNode % cols;
+    bool blocked;
+    if (dc != 0) {
+        int limit = r == goalR && sign(goalC - c) == dc ? std::abs(goalC - c) : INT_MAX;
+        int steps = scan(passable.row(0), cell(r, c), dc, stride, limit, blocked);
+        if (blocked) return false;
+        c += dc * steps;
+    } else {
+        int limit = c == goalC && sign(goalR - r) == dr ? std::abs(goalR - r) : INT_MAX;
+        int steps = scan(passableT.row(0), cellT(r, c), dr, strideT, limit, blocked);
+        if (blocked) return false;
+        r += dr * steps;
+    }
+    return true;
+}
+
+bool PathFinder::jumpDiagonal(int& r, int& c, int dr, int dc) const {
+    int goalR = goalNode / cols, goalC = goalNode % cols;
+    while (true) {
+        r += dr;
+        c += dc;
+        if (!walkable(r, c)) return false;
+        if (r == goalR && c == goalC) return true;
+        int hr = r, hc = c, vr = r, vc = c;
+        if (jumpStraight(hr, hc, 0, dc) || jumpStraight(vr, vc, dr, 0)) return true;
+        if (!walkable(r + dr, c) || !walkable(r, c + dc)) return false;  // no corner cutting
+    }
+}
+
+void PathFinder::consider(int from, int r, int c, PathPoint goal) {
+    int node = r * cols + c;
+    if (closed[node] == generation) return;
+    float cost = g[from] + octile(from / cols, from % cols, r, c);
+    if (seen[node] == generation && cost >= g[node]) return;
+
+    seen[node] = generation;
+    g[node] = cost;
+    parent[node] = from;
+    open.push_back({cost + octile(r, c, goal.row, goal.col), node});
+    std::push_heap(open.begin(), open.end(), [](const OpenEntry& a, const OpenEntry& b) { return heapLess(a.f, b.f); });
+}
+
+void PathFinder::sizeSearch() {
+    // Stamps left at positions that now mean other tiles are all from
+    // older generations, so growing needs no clearing
+    size_t tiles = static_cast<size_t>(rows) * cols;
+    seen.resize(tiles, 0);
+    closed.resize(tiles, 0);
+    g.resize(tiles);
+    parent.resize(tiles);
+}
+
+void PathFinder::rebuild(const TileGrid& grid, const TileProperties& props) {
+    rows = grid.rows();
+    cols = grid.cols();
+    sizeSearch();
+    passable = GridPlane<uint8_t>(rows + 2, cols + 2 + 2 * PAD, 0);
+    passableT = GridPlane<uint8_t>(cols + 2, rows + 2 + 2 * PAD, 0);
+    stride = passable.stride();
+    strideT = passableT.stride();
+    for (int r = 0; r < rows; ++r) {
+        const Tile* line = grid.row(r);
+        uint8_t* out = passable.row(0) + cell(r, 0);
+        for (int c = 0; c < cols; ++c) out[c] = props.isPassable(line[c]);
+    }
+    for (int r = 0; r < rows; ++r)
+        for (int c = 0; c < cols; ++c)
+            passableT.row(0)[cellT(r, c)] = walkable(r, c);
+}
+
+void PathFinder::reframe(const TileGrid& grid, const TileProperties& props, int rowOffset, int colOffset) {
+    int oldRows = rows, oldCols = cols;
+    if (oldRows == 0 || rowOffset < 0 || colOffset < 0 || rowOffset + oldRows > grid.rows() ||
+        colOffset + oldCols > grid.cols()) {
+        rebuild(grid, props);
+        return;
+    }
+    rows = grid.rows();
+    cols = grid.cols();
+    sizeSearch();
+    // The old border and padding end up under new tiles or stay border
+    int down = rows - oldRows - rowOffset, right = cols - oldCols - colOffset;
+    passable.grow(rowOffset, down, colOffset, right, 0);
+    passableT.grow(colOffset, right, rowOffset, down, 0);
+    stride = passable.stride();
+    strideT = passableT.stride();
+
+    for (int r = 0; r < rows; ++r) {
+        const Tile* line = grid.row(r);
+        bool old = r >= rowOffset && r < rowOffset + oldRows;
+        for (int c = 0; c < cols; ++c) {
+            if (old && c == colOffset) c += oldCols;
+            if (c < cols) setTile(r, c, props.isPassable(line[c]));
+        }
+    }
+}
+
+bool PathFinder::findPath(PathPoint start, PathPoint goal, std::vector<PathPoint>& path, float& length) {
+    path.clear();
+    length = 0.f;
+    expandedCount = 0;
+    auto inside = [&](PathPoint p) { return p.row >= 0 && p.row < rows && p.col >= 0 && p.col < cols; };
+    if (!inside(start) || !inside(goal) || !walkable(start.row, start.col) || !walkable(goal.row, goal.col))
+        return false;
+    if (++generation == 0) {  // wrapped: old stamps could look current
+        std::fill(seen.begin(), seen.end(), 0);
+        std::fill(closed.begin(), closed.end(), 0);
+        generation = 1;
+    }
+
+    auto cmp = [](const OpenEntry& a, const OpenEntry& b) { return heapLess(a.f, b.f); };
+    open.clear();
+    int startNode = start.row * cols + start.col;
+    goalNode = goal.row * cols + goal.col;
+    seen[startNode] = generation;
+    g[startNode] = 0.f;
+    parent[startNode] = -1;
+    open.push_back({octile(start.row, start.col, goal.row, goal.col), startNode});
+
+    bool found = false;
+    while (!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), cmp);
+        int node = open.back().node;
+        open.pop_back();
+        if (closed[node] == generation) continue;  // stale duplicate
+        closed[node] = generation;
+        ++expandedCount;
+        if (node == goalNode) {
+            found = true;
+            break;
+        }
+
+        int r = node / cols, c = node % cols;
+        auto tryDir = [&](int dr, int dc) {
+            int jr = r, jc = c;
+            if (dr != 0 && dc != 0 ? jumpDiagonal(jr, jc, dr, dc) : jumpStraight(jr, jc, dr, dc))
+                consider(node, jr, jc, goal);
+        };
+
+        if (parent[node] < 0) {
+            // Start node: every direction
+            for (int dr = -1; dr <= 1; ++dr)
+                for (int dc = -1; dc <= 1; ++dc) {
+                    if (dr == 0 && dc == 0) continue;
+                    if (dr != 0 && dc != 0 && (!walkable(r + dr, c) || !walkable(r, c + dc))) continue;
+                    tryDir(dr, dc);
+                }
+            continue;
+        }
+
+        // Pruned neighbours: the natural direction plus forced ones
+        int dr = sign(r - parent[node] / cols), dc = sign(c - parent[node] % cols);
+        if (dr != 0 && dc != 0) {
+            bool vertical = walkable(r + dr, c), horizontal = walkable(r, c + dc);
+            if (vertical) tryDir(dr, 0);
+            if (horizontal) tryDir(0, dc);
+            if (vertical && horizontal) tryDir(dr, dc);
+        } else if (dc != 0) {
+            bool next = walkable(r, c + dc), up = walkable(r - 1, c), down = walkable(r + 1, c);
+            if (next) {
+                tryDir(0, dc);
+                if (up) tryDir(-1, dc);
+                if (down) tryDir(1, dc);
+            }
+            if (up) tryDir(-1, 0);
+            if (down) tryDir(1, 0);
+        } else {
+            bool next = walkable(r + dr, c), left = walkable(r, c - 1), right = walkable(r, c + 1);
+            if (next) {
+                tryDir(dr, 0);
+                if (left) tryDir(dr, -1);
+                if (right) tryDir(dr, 1);
+            }
+            if (left) tryDir(0, -1);
+            if (right) tryDir(0, 1);
+        }
+    }
+    if (!found) return false;
+
+    // Jump points back to the start, then fill in the straight runs
+    jumpPoints.clear();
+    for (int node = goalNode; node >= 0; node = parent[node])
+        jumpPoints.push_back({node / cols, node % cols});
+    std::reverse(jumpPoints.begin(), jumpPoints.end());
+
+    path.push_back(jumpPoints.front());
+    for (size_t i = 1; i < jumpPoints.size(); ++i) {
+        PathPoint from = jumpPoints[i - 1], to = jumpPoints[i];
+        int dr = sign(to.row - from.row), dc = sign(to.col - from.col);
+        while (from.row != to.row || from.col != to.col) {
+            from.row += dr;
+            from.col += dc;
+            path.push_back(from);
+        }
+    }
+    length = g[goalNode];
+    return true;
+}
@@ -0,0 +1,86 @@
+// Path preview between two tiles: jump point search on an 8-connected grid
+//
+// Diagonal steps are only allowed when both orthogonal neighbours are open
+// (no corner cutting), so a path exists exactly when the tiles are in the
+// same 4-connected region. The finder keeps its own byte-per-tile
+// passability plane, plus a transposed copy so vertical scans are row scans
+// too, both with a solid border and padding so straight jumps test 8 tiles
+// per step without bounds checks. The planes are updated per edited tile,
+// and grow with the canvas into spare room (GridPlane::grow).
+// All search buffers are reused between queries; per-tile
+// state is invalidated with a generation counter instead of being cleared,
+// so a query on an unchanged map size allocates nothing.
+
+#pragma once
+
+#include "tile_grid.hpp"
+#include "tile_properties.hpp"
+
+#include <cstdint>
+#include <vector>
+
+struct PathPoint {
+    int row, col;
+};
+
+class PathFinder {
+public:
+    // Take passability from the whole map (on load/resize or when the solid
+    // set changes)
+    void rebuild(const TileGrid& grid, const TileProperties& props);
+
+    // The map grew, its old (0, 0) now at (rowOffset, colOffset); only the
+    // new tiles are read. Anything else is a rebuild.
+    void reframe(const TileGrid& grid, const TileProperties& props, int rowOffset, int colOffset);
+
+    // Keep the planes in sync with a single edited tile
+    void updateTile(int row, int col, Tile tile, const TileProperties& props) {
+        if (row >= 0 && row < rows && col >= 0 && col < cols)
+            setTile(row, col, props.isPassable(tile));
+    }
+
+    // Returns false if goal can't be reached. On success `path` holds every
+    // tile from start to goal and `length` the cost (diagonals cost sqrt 2).
+    bool findPath(PathPoint start, PathPoint goal, std::vector<PathPoint>& path, float& length);
+
+    // Nodes expanded by the last query
+    int expanded() const { return expandedCount; }
+
+private:
+    struct OpenEntry {
+        float f;
+        int node;
+    };
+
+    int rows = 0, cols = 0, stride = 0, strideT = 0;
+    int goalNode = 0;
+    GridPlane<uint8_t> passable;   // 0/1 per tile, solid border, padded rows
+    GridPlane<uint8_t> passableT;  // the same, transposed
+
+    std::vector<uint32_t> seen;     // generation in which g/parent were set
+    std::vector<uint32_t> closed;   // generation in which the node was closed
+    std::vector<float> g;
+    std::vector<int> parent;
+    std::vector<OpenEntry> open;    // binary heap
+    std::vector<PathPoint> jumpPoints;
+    uint32_t generation = 0;
+    int expandedCount = 0;
+
+    // Valid for -1 <= r <= rows, -1 <= c <= cols, which is as far as any
+    // search looks past a walkable tile. Each row has PAD spare bytes on
+    // both sides for the 8-byte loads. Cells count from the plane's row 0;
+    // stride/strideT are the planes' row pitches.
+    static const int PAD = 8;
+    size_t cell(int r, int c) const { return static_cast<size_t>(r + 1) * stride + PAD + c + 1; }
+    size_t cellT(int r, int c) const { return static_cast<size_t>(c + 1) * strideT + PAD + r + 1; }
+    bool walkable(int r, int c) const { return passable.row(0)[cell(r, c)]; }
+
+    void setTile(int r, int c, bool open) { passable.row(0)[cell(r, c)] = passableT.row(0)[cellT(r, c)] = open; }
+    void sizeSearch();
+
+    int scan(const uint8_t* plane, size_t from, int dir, size_t lineStride, int limit, bool& blocked) const;
+
+    bool jumpStraight(int& r, int& c, int dr, int dc) const;
+    bool jumpDiagonal(int& r, int& c, int dr, int dc) const;
+    void consider(int from, int r, int c, PathPoint goal);
+};
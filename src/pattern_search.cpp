@@ -0,0 +1,141 @@
+#include "pattern_search.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+const uint64_t ROW_BASE = 1000003;     // odd, so powers stay invertible mod 2^64
+const uint64_t COL_BASE = 0x100000001B3ULL;
+
+uint64_t tileValue(Tile t) { return static_cast<uint64_t>(t) + 1; }
+
+uint64_t power(uint64_t base, int exp) {
+    uint64_t result = 1;
+    while (exp-- > 0) result *= base;
+    return result;
+}
+
+struct Rect {
+    int top = 0, left = 0, height = 0, width = 0;
+};
+
+// Largest rectangle of the pattern without wildcards (histogram method)
+Rect largestSolidRect(const TileGrid& pattern, std::optional<Tile> wildcard) {
+    if (!wildcard) return {0, 0, pattern.rows(), pattern.cols()};
+
+    Rect best;
+    std::vector<int> heights(pattern.cols() + 1, 0), stack;
+    for (int r = 0; r < pattern.rows(); ++r) {
+        for (int c = 0; c < pattern.cols(); ++c)
+            heights[c] = pattern.at(r, c) == *wildcard ? 0 : heights[c] + 1;
+
+        stack.clear();
+        for (int c = 0; c <= pattern.cols(); ++c) {
+            while (!stack.empty() && heights[stack.back()] >= heights[c]) {
+                int h = heights[stack.back()];
+                stack.pop_back();
+                int left = stack.empty() ? 0 : stack.back() + 1;
+                if (h * (c - left) > best.height * best.width)
+                    best = {r - h + 1, left, h, c - left};
+            }
+            stack.push_back(c);
+        }
+    }
+    return best;
+}
+
+bool matchesAt(const TileGrid& map, const TileGrid& pattern, std::optional<Tile> wildcard, int top, int left) {
+    for (int r = 0; r < pattern.rows(); ++r) {
+        const Tile* m = map.row(top + r) + left;
+        const Tile* p = pattern.row(r);
+        for (int c = 0; c < pattern.cols(); ++c)
+            if (p[c] != m[c] && (!wildcard || p[c] != *wildcard))
+                return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+std::vector<PatternMatch> findPattern(const TileGrid& map, const TileGrid& pattern, std::optional<Tile> wildcard) {
+    std::vector<PatternMatch> matches;
+    int ph = pattern.rows(), pw = pattern.cols();
+    if (ph == 0 || pw == 0 || ph > map.rows() || pw > map.cols()) return matches;
+
+    // Positions where the whole pattern fits
+    int outRows = map.rows() - ph + 1, outCols = map.cols() - pw + 1;
+
+    Rect anchor = largestSolidRect(pattern, wildcard);
+    if (anchor.height == 0) {
+        // Nothing but wildcards: everything matches
+        for (int r = 0; r < outRows; ++r)
+            for (int c = 0; c < outCols; ++c) matches.push_back({r, c});
+        return matches;
+    }
+
+    int ah = anchor.height, aw = anchor.width;
+    uint64_t powW = power(ROW_BASE, aw), powH = power(COL_BASE, ah);
+
+    uint64_t target = 0;
+    for (int r = 0; r < ah; ++r) {
+        uint64_t h = 0;
+        for (int c = 0; c < aw; ++c)
+            h = h * ROW_BASE + tileValue(pattern.at(anchor.top + r, anchor.left + c));
+        target = target * COL_BASE + h;
+    }
+
+    // Each band scans the map rows feeding its range of pattern positions;
+    // bands overlap by ah-1 rows so they stay independent
+    std::vector<std::vector<PatternMatch>> bandMatches(workerCount());
+    parallelForRows(outRows, [&](int begin, int end, int band) {
+        auto& found = bandMatches[band];
+        std::vector<uint64_t> ring(static_cast<size_t>(ah) * outCols), column(outCols, 0);
+        for (int r = begin; r < end + ah - 1; ++r) {
+            const Tile* line = map.row(r + anchor.top) + anchor.left;
+            uint64_t* slot = &ring[static_cast<size_t>((r - begin) % ah) * outCols];
+            bool full = r - begin >= ah;
+
+            uint64_t h = 0;
+            for (int c = 0; c < aw - 1; ++c) h = h * ROW_BASE + tileValue(line[c]);
+            for (int c = 0; c < outCols; ++c) {
+                h = h * ROW_BASE + tileValue(line[c + aw - 1]);
+                if (c > 0) h -= tileValue(line[c - 1]) * powW;
+                column[c] = column[c] * COL_BASE + h - (full ? slot[c] * powH : 0);
+                slot[c] = h;
+            }
+
+            int top = r - ah + 1;
+            if (top >= begin)
+                for (int c = 0; c < outCols; ++c)
+                    if (column[c] == target && matchesAt(map, pattern, wildcard, top, c))
+                        found.push_back({top, c});
+        }
+    }, std::max(32, ah * 4));
+
+    for (auto& band : bandMatches)
+        matches.insert(matches.end(), band.begin(), band.end());
+    return matches;
+}
+
+std::vector<uint8_t> matchCoverage(const std::vector<PatternMatch>& matches, int height, int width, int rows,
+                                   int cols) {
+    std::vector<int> diff(static_cast<size_t>(rows + 1) * (cols + 1), 0);
+    auto at = [&](int r, int c) -> int& { return diff[static_cast<size_t>(r) * (cols + 1) + c]; };
+    for (const auto& m : matches) {
+        ++at(m.row, m.col);
+        --at(m.row, m.col + width);
+        --at(m.row + height, m.col);
+        ++at(m.row + height, m.col + width);
+    }
+    std::vector<uint8_t> coverage(static_cast<size_t>(rows) * cols, 0);
+    for (int r = 0; r < rows; ++r)
+        for (int c = 0; c < cols; ++c) {
+            if (r > 0) at(r, c) += at(r - 1, c);
+            if (c > 0) at(r, c) += at(r, c - 1);
+            if (r > 0 && c > 0) at(r, c) -= at(r - 1, c - 1);
+            coverage[static_cast<size_t>(r) * cols + c] = at(r, c) > 0;
+        }
+    return coverage;
+}
@@ -0,0 +1,26 @@
+// Find every occurrence of a rectangular pattern ("stamp") in the map
+
+#pragma once
+
+#include "tile_grid.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+struct PatternMatch {
+    int row, col;  // top-left corner in the map
+};
+
+// Matches in row-major order. Pattern tiles equal to `wildcard` match
+// anything. Uses a 2D Rabin-Karp rolling hash (rows, then columns) over the
+// largest wildcard-free rectangle of the pattern, and verifies each hash hit
+// against the full pattern, so the cost is O(map + hits * pattern).
+std::vector<PatternMatch> findPattern(const TileGrid& map, const TileGrid& pattern,
+                                      std::optional<Tile> wildcard = std::nullopt);
+
+// 1 for every tile of a rows x cols map inside some height x width match,
+// row-major; a 2D difference array keeps it O(map) however much the
+// matches overlap
+std::vector<uint8_t> matchCoverage(const std::vector<PatternMatch>& matches, int height, int width, int rows,
+                                   int cols);
@@ -0,0 +1,208 @@
+#include "regions.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+int findRoot(std::vector<int>& parent, int x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+void unite(std::vector<int>& parent, int a, int b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a != b) parent[std::max(a, b)] = std::min(a, b);  // keep the lowest index as root
+}
+
+void growBox(RegionStats& into, const RegionStats& from) {
+    into.top = std::min(into.top, from.top);
+    into.left = std::min(into.left, from.left);
+    into.bottom = std::max(into.bottom, from.bottom);
+    into.right = std::max(into.right, from.right);
+}
+
+}  // namespace
+
+void RegionMap::labelChunk(const TileGrid& grid, const TileProperties& props, int chunk) {
+    int top = (chunk / chunkCols) * REGION_CHUNK, left = (chunk % chunkCols) * REGION_CHUNK;
+    int height = std::min(REGION_CHUNK, rows - top), width = std::min(REGION_CHUNK, cols - left);
+
+    // Pass 1: provisional labels, equivalences in a small union-find
+    std::vector<int> parent(1, 0);
+    for (int r = 0; r < height; ++r) {
+        const Tile* line = grid.row(top + r) + left;
+        uint16_t* labels = localLabel.row(top + r) + left;
+        const uint16_t* above = r > 0 ? localLabel.row(top + r - 1) + left : nullptr;
+        for (int c = 0; c < width; ++c) {
+            if (!props.isPassable(line[c])) {
+                labels[c] = 0;
+                continue;
+            }
+            int up = above ? above[c] : 0, west = c > 0 ? labels[c - 1] : 0;
+            if (up && west) {
+                labels[c] = static_cast<uint16_t>(std::min(up, west));
+                if (up != west) unite(parent, up, west);
+            } else if (up || west) {
+                labels[c] = static_cast<uint16_t>(up | west);
+            } else {
+                parent.push_back(static_cast<int>(parent.size()));
+                labels[c] = static_cast<uint16_t>(parent.size() - 1);
+            }
+        }
+    }
+
+    // Pass 2: resolve to compact labels 1..n and collect statistics
+    std::vector<int> compact(parent.size(), 0);
+    auto& comps = components[chunk];
+    comps.clear();
+    for (int r = 0; r < height; ++r) {
+        uint16_t* labels = localLabel.row(top + r) + left;
+        for (int c = 0; c < width; ++c) {
+            if (!labels[c]) continue;
+            int root = findRoot(parent, labels[c]);
+            if (!compact[root]) {
+                comps.push_back({RegionStats{0, top + r, left + c, top + r, left + c}});
+                compact[root] = static_cast<int>(comps.size());
+            }
+            labels[c] = static_cast<uint16_t>(compact[root]);
+            RegionStats& s = comps[compact[root] - 1].stats;
+            ++s.size;
+            growBox(s, RegionStats{0, top + r, left + c, top + r, left + c});
+        }
+    }
+}
+
+void RegionMap::merge() {
+    int chunkCount = chunkRows * chunkCols;
+    nodeOffset.assign(chunkCount + 1, 0);
+    for (int i = 0; i < chunkCount; ++i)
+        nodeOffset[i + 1] = nodeOffset[i] + static_cast<int>(components[i].size());
+
+    std::vector<int> parent(nodeOffset[chunkCount]);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto node = [&](int row, int col) {
+        int chunk = (row / REGION_CHUNK) * chunkCols + col / REGION_CHUNK;
+        return nodeOffset[chunk] + localLabel.at(row, col) - 1;
+    };
+
+    // Union across chunk borders
+    for (int c = REGION_CHUNK; c < cols; c += REGION_CHUNK)
+        for (int r = 0; r < rows; ++r)
+            if (localLabel.at(r, c - 1) && localLabel.at(r, c))
+                unite(parent, node(r, c - 1), node(r, c));
+    for (int r = REGION_CHUNK; r < rows; r += REGION_CHUNK)
+        for (int c = 0; c < cols; ++c)
+            if (localLabel.at(r - 1, c) && localLabel.at(r, c))
+                unite(parent, node(r - 1, c), node(r, c));
+
+    // Roots become regions, numbered in chunk order
+    nodeRegion.assign(parent.size(), -1);
+    regions.clear();
+    std::vector<int> rootRegion(parent.size(), -1);
+    for (int chunk = 0; chunk < chunkCount; ++chunk)
+        for (size_t i = 0; i < components[chunk].size(); ++i) {
+            int n = nodeOffset[chunk] + static_cast<int>(i);
+            int root = findRoot(parent, n);
+            const RegionStats& local = components[chunk][i].stats;
+            if (rootRegion[root] < 0) {
+                rootRegion[root] = static_cast<int>(regions.size());
+                regions.push_back(RegionStats{0, local.top, local.left, local.bottom, local.right});
+            }
+            RegionStats& s = regions[rootRegion[root]];
+            s.size += local.size;
+            growBox(s, local);
+            nodeRegion[n] = rootRegion[root];
+        }
+
+}
+
+void RegionMap::rebuild(const TileGrid& grid, const TileProperties& props) {
+    rows = grid.rows();
+    cols = grid.cols();
+    chunkRows = (rows + REGION_CHUNK - 1) / REGION_CHUNK;
+    chunkCols = (cols + REGION_CHUNK - 1) / REGION_CHUNK;
+    localLabel = GridPlane<uint16_t>(rows, cols);
+    components.assign(static_cast<size_t>(chunkRows) * chunkCols, {});
+    dirty.assign(components.size(), 0);
+    anyDirty = false;
+
+    parallelForRows(chunkRows, [&](int begin, int end) {
+        for (int cr = begin; cr < end; ++cr)
+            for (int cc = 0; cc < chunkCols; ++cc)
+                labelChunk(grid, props, cr * chunkCols + cc);
+    }, 1);
+    merge();
+}
+
+void RegionMap::markDirty(int row, int col) {
+    if (row < 0 || row >= rows || col < 0 || col >= cols) return;
+    dirty[(row / REGION_CHUNK) * chunkCols + col / REGION_CHUNK] = 1;
+    anyDirty = true;
+}
+
+void RegionMap::reframe(int newRows, int newCols, int rowOffset, int colOffset) {
+    bool whole = rows > 0 && rowOffset >= 0 && colOffset >= 0 && rowOffset % REGION_CHUNK == 0 &&
+                 colOffset % REGION_CHUNK == 0 && rowOffset + rows <= newRows && colOffset + cols <= newCols;
+    if (!whole) {
+        rows = cols = 0;  // refresh() rebuilds
+        return;
+    }
+
+    int newChunkRows = (newRows + REGION_CHUNK - 1) / REGION_CHUNK;
+    int newChunkCols = (newCols + REGION_CHUNK - 1) / REGION_CHUNK;
+    int rowShift = rowOffset / REGION_CHUNK, colShift = colOffset / REGION_CHUNK;
+    bool wider = cols % REGION_CHUNK != 0 && colOffset + cols < newCols;
+    bool taller = rows % REGION_CHUNK != 0 && rowOffset + rows < newRows;
+    std::vector<std::vector<LocalComponent>> moved(static_cast<size_t>(newChunkRows) * newChunkCols);
+    std::vector<uint8_t> marks(moved.size(), 1);  // new chunks are labelled on refresh
+    for (int cr = 0; cr < chunkRows; ++cr)
+        for (int cc = 0; cc < chunkCols; ++cc) {
+            int from = cr * chunkCols + cc, to = (cr + rowShift) * newChunkCols + cc + colShift;
+            for (auto& comp : components[from]) {
+                comp.stats.top += rowOffset;
+                comp.stats.bottom += rowOffset;
+                comp.stats.left += colOffset;
+                comp.stats.right += colOffset;
+            }
+            moved[to] = std::move(components[from]);
+            marks[to] = dirty[from] || (wider && cc == chunkCols - 1) || (taller && cr == chunkRows - 1);
+        }
+    components.swap(moved);
+    dirty.swap(marks);
+    localLabel.grow(rowOffset, newRows - rows - rowOffset, colOffset, newCols - cols - colOffset);
+
+    rows = newRows;
+    cols = newCols;
+    chunkRows = newChunkRows;
+    chunkCols = newChunkCols;
+    anyDirty = true;
+}
+
+void RegionMap::refresh(const TileGrid& grid, const TileProperties& props) {
+    if (grid.rows() != rows || grid.cols() != cols) {
+        rebuild(grid, props);
+        return;
+    }
+    if (!anyDirty) return;
+
+    for (size_t chunk = 0; chunk < dirty.size(); ++chunk)
+        if (dirty[chunk]) {
+            labelChunk(grid, props, static_cast<int>(chunk));
+            dirty[chunk] = 0;
+        }
+    anyDirty = false;
+    merge();
+}
+
+int RegionMap::regionAt(int row, int col) const {
+    uint16_t label = localLabel.at(row, col);
+    if (!label) return -1;
+    int chunk = (row / REGION_CHUNK) * chunkCols + col / REGION_CHUNK;
+    return nodeRegion[nodeOffset[chunk] + label - 1];
+}
@@ -0,0 +1,65 @@
+// Connected regions of passable tiles (4-connected) and their statistics
+//
+// The map is cut into REGION_CHUNK x REGION_CHUNK chunks. Each chunk is
+// labelled on its own with a two-pass union-find labeller, then a merge
+// step unions chunk-local components across chunk borders. Edits only mark
+// their chunk dirty: refresh() relabels dirty chunks and redoes the merge,
+// which touches chunk borders and components but not every tile.
+
+#pragma once
+
+#include "tile_grid.hpp"
+#include "tile_properties.hpp"
+
+#include <cstdint>
+#include <vector>
+
+const int REGION_CHUNK = 64;
+
+struct RegionStats {
+    int size = 0;
+    int top = 0, left = 0, bottom = 0, right = 0;  // inclusive bounding box
+};
+
+class RegionMap {
+public:
+    // Label the whole map; chunk rows are labelled in parallel
+    void rebuild(const TileGrid& grid, const TileProperties& props);
+
+    // Note an edited tile; the work happens in the next refresh()
+    void markDirty(int row, int col);
+
+    // The map grew, its old (0, 0) now at (rowOffset, colOffset). Moved by
+    // whole chunks, the old chunks keep their labels and only the new ones
+    // (and old edge chunks that grew wider or taller) are labelled by the
+    // next refresh(); any other change leaves that to a rebuild.
+    void reframe(int newRows, int newCols, int rowOffset, int colOffset);
+
+    // Bring labels and statistics up to date (no-op when nothing changed)
+    void refresh(const TileGrid& grid, const TileProperties& props);
+
+    // Valid after refresh(). Numbering is arbitrary and may change with
+    // every refresh.
+    const std::vector<RegionStats>& stats() const { return regions; }
+
+    // Region index of a tile, or -1 for solid tiles
+    int regionAt(int row, int col) const;
+
+private:
+    struct LocalComponent {
+        RegionStats stats;  // in map coordinates
+    };
+
+    int rows = 0, cols = 0, chunkRows = 0, chunkCols = 0;
+    GridPlane<uint16_t> localLabel;                       // per tile, 0 = solid
+    std::vector<std::vector<LocalComponent>> components;  // per chunk
+    std::vector<uint8_t> dirty;                           // per chunk
+    bool anyDirty = false;
+
+    std::vector<int> nodeOffset;    // per chunk: first global node of its components
+    std::vector<int> nodeRegion;    // global node -> region index
+    std::vector<RegionStats> regions;
+
+    void labelChunk(const TileGrid& grid, const TileProperties& props, int chunk);
+    void merge();
+};
@@ -0,0 +1,299 @@
+#include "selection_mask.hpp"
+#include "bit_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace {
+
+// Row merges; inputs and output are sorted, disjoint and non-touching
+void unite(const std::vector<Span>& a, const std::vector<Span>& b, std::vector<Span>& out) {
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        Span next = j == b.size() || (i < a.size() && a[i].begin <= b[j].begin) ? a[i++] : b[j++];
+        if (!out.empty() && next.begin <= out.back().end)
+            out.back().end = std::max(out.back().end, next.end);
+        else
+            out.push_back(next);
+    }
+}
+
+void intersect(const std::vector<Span>& a, const std::vector<Span>& b, std::vector<Span>& out) {
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        int begin = std::max(a[i].begin, b[j].begin), end = std::min(a[i].end, b[j].end);
+        if (begin < end)
+            out.push_back({begin, end});
+        if (a[i].end < b[j].end)
+            ++i;
+        else
+            ++j;
+    }
+}
+
+void difference(const std::vector<Span>& a, const std::vector<Span>& b, std::vector<Span>& out) {
+    size_t j = 0;
+    for (const Span& s : a) {
+        int cur = s.begin;
+        while (j < b.size() && b[j].end <= cur) ++j;
+        // b[k] may reach into the next span of a, so j stays put
+        for (size_t k = j; k < b.size() && b[k].begin < s.end; ++k) {
+            if (b[k].begin > cur)
+                out.push_back({cur, b[k].begin});
+            cur = std::max(cur, b[k].end);
+        }
+        if (cur < s.end)
+            out.push_back({cur, s.end});
+    }
+}
+
+template <typename Merge>
+void mergeRows(std::vector<std::vector<Span>>& rows, const std::vector<std::vector<Span>>& other, Merge&& merge) {
+    std::vector<Span> out;
+    for (size_t r = 0; r < rows.size(); ++r) {
+        out.clear();
+        merge(rows[r], other[r], out);
+        rows[r].swap(out);
+    }
+}
+
+}  // namespace
+
+SelectionMask::SelectionMask(int rows, int cols) : nRows(rows), nCols(cols), spans(rows) {}
+
+SelectionMask SelectionMask::rect(int rows, int cols, int top, int left, int height, int width) {
+    SelectionMask mask(rows, cols);
+    for (int r = std::max(0, top); r < std::min(rows, top + height); ++r)
+        mask.add(r, left, left + width);
+    return mask;
+}
+
+bool SelectionMask::contains(int row, int col) const {
+    if (row < 0 || row >= nRows) return false;
+    const auto& v = spans[row];
+    auto it = std::upper_bound(v.begin(), v.end(), col, [](int c, const Span& s) { return c < s.begin; });
+    return it != v.begin() && col < std::prev(it)->end;
+}
+
+bool SelectionMask::empty() const {
+    return std::all_of(spans.begin(), spans.end(), [](const auto& v) { return v.empty(); });
+}
+
+size_t SelectionMask::count() const {
+    size_t n = 0;
+    for (const auto& v : spans)
+        for (const Span& s : v)
+            n += s.end - s.begin;
+    return n;
+}
+
+size_t SelectionMask::spanCount() const {
+    size_t n = 0;
+    for (const auto& v : spans)
+        n += v.size();
+    return n;
+}
+
+bool SelectionMask::bounds(int& top, int& left, int& bottom, int& right) const {
+    top = left = bottom = right = -1;
+    for (int r = 0; r < nRows; ++r) {
+        if (spans[r].empty()) continue;
+        if (top < 0) {
+            top = r;
+            left = spans[r].front().begin;
+            right = spans[r].back().end - 1;
+        }
+        bottom = r;
+        left = std::min(left, spans[r].front().begin);
+        right = std::max(right, spans[r].back().end - 1);
+    }
+    return top >= 0;
+}
+
+void SelectionMask::add(int row, int begin, int end) {
+    begin = std::max(begin, 0);
+    end = std::min(end, nCols);
+    if (row < 0 || row >= nRows || begin >= end) return;
+
+    // Swallow every span that overlaps or touches [begin, end)
+    auto& v = spans[row];
+    auto first = std::lower_bound(v.begin(), v.end(), begin, [](const Span& s, int b) { return s.end < b; });
+    auto last = first;
+    for (; last != v.end() && last->begin <= end; ++last) {
+        begin = std::min(begin, last->begin);
+        end = std::max(end, last->end);
+    }
+    first = v.erase(first, last);
+    v.insert(first, Span{begin, end});
+}
+
+// Bresenham; horizontal steps extend the current run instead of adding
+// one tile at a time
+void SelectionMask::addLine(int r0, int c0, int r1, int c1) {
+    int dr = std::abs(r1 - r0), dc = std::abs(c1 - c0);
+    int sr = r0 < r1 ? 1 : -1, sc = c0 < c1 ? 1 : -1;
+    int err = dc - dr;
+    int runStart = c0;
+    while (true) {
+        if (r0 == r1 && c0 == c1) break;
+        int e2 = 2 * err;
+        int row = r0, col = c0;
+        if (e2 > -dr) { err -= dr; c0 += sc; }
+        if (e2 < dc)  { err += dc; r0 += sr; }
+        if (r0 != row) {
+            add(row, std::min(runStart, col), std::max(runStart, col) + 1);
+            runStart = c0;
+        }
+    }
+    add(r0, std::min(runStart, c0), std::max(runStart, c0) + 1);
+}
+
+void SelectionMask::clear() {
+    for (auto& v : spans) v.clear();
+}
+
+SelectionMask& SelectionMask::operator|=(const SelectionMask& other) {
+    mergeRows(spans, other.spans, unite);
+    return *this;
+}
+
+SelectionMask& SelectionMask::operator&=(const SelectionMask& other) {
+    mergeRows(spans, other.spans, intersect);
+    return *this;
+}
+
+SelectionMask& SelectionMask::subtract(const SelectionMask& other) {
+    mergeRows(spans, other.spans, difference);
+    return *this;
+}
+
+SelectionMask& SelectionMask::combine(SelectionMask picked, MaskOp op) {
+    switch (op) {
+        case MaskOp::Replace: *this = std::move(picked); break;
+        case MaskOp::Add: *this |= picked; break;
+        case MaskOp::Subtract: subtract(picked); break;
+        case MaskOp::Intersect: *this &= picked; break;
+    }
+    return *this;
+}
+
+SelectionMask& SelectionMask::invert() {
+    std::vector<Span> out;
+    for (auto& v : spans) {
+        out.clear();
+        int cur = 0;
+        for (const Span& s : v) {
+            if (s.begin > cur)
+                out.push_back({cur, s.begin});
+            cur = s.end;
+        }
+        if (cur < nCols)
+            out.push_back({cur, nCols});
+        v.swap(out);
+    }
+    return *this;
+}
+
+void SelectionMask::reframe(int newRows, int newCols, int rowOffset, int colOffset) {
+    std::vector<std::vector<Span>> moved(newRows);
+    for (int r = 0; r < nRows; ++r) {
+        int nr = r + rowOffset;
+        if (nr < 0 || nr >= newRows) continue;
+        for (const Span& s : spans[r]) {
+            int begin = std::max(0, s.begin + colOffset), end = std::min(newCols, s.end + colOffset);
+            if (begin < end)
+                moved[nr].push_back({begin, end});
+        }
+    }
+    nRows = newRows;
+    nCols = newCols;
+    spans.swap(moved);
+}
+
+SelectionMask magicWand(const TileGrid& grid, int row, int col, bool contiguous) {
+    int rows = grid.rows(), cols = grid.cols();
+    SelectionMask mask(rows, cols);
+    if (row < 0 || row >= rows || col < 0 || col >= cols) return mask;
+    Tile target = grid.at(row, col);
+
+    if (!contiguous) {
+        for (int r = 0; r < rows; ++r) {
+            const Tile* line = grid.row(r);
+            for (int c = 0; c < cols;) {
+                if (line[c] != target) { ++c; continue; }
+                int end = c + 1;
+                while (end < cols && line[end] == target) ++end;
+                mask.add(r, c, end);
+                c = end;
+            }
+        }
+        return mask;
+    }
+
+    // Scanline fill: every stack entry is a tile of an unvisited run; the
+    // run is taken whole and the runs touching it above and below are
+    // queued by their first tile under it
+    BitGrid visited(rows, cols);
+    std::vector<std::vector<Span>> found(rows);
+    std::vector<std::pair<int, int>> stack{{row, col}};
+    while (!stack.empty()) {
+        auto [r, c] = stack.back();
+        stack.pop_back();
+        if (visited.get(r, c)) continue;
+        const Tile* line = grid.row(r);
+        int begin = c, end = c + 1;
+        while (begin > 0 && line[begin - 1] == target) --begin;
+        while (end < cols && line[end] == target) ++end;
+        for (int x = begin; x < end; ++x)
+            visited.set(r, x, true);
+        found[r].push_back({begin, end});
+
+        for (int nr : {r - 1, r + 1}) {
+            if (nr < 0 || nr >= rows) continue;
+            const Tile* next = grid.row(nr);
+            for (int x = begin; x < end; ++x)
+                if (next[x] == target && (x == begin || next[x - 1] != target) && !visited.get(nr, x))
+                    stack.emplace_back(nr, x);
+        }
+    }
+    // Maximal runs never touch, so sorting is all the normalising needed
+    for (int r = 0; r < rows; ++r) {
+        std::sort(found[r].begin(), found[r].end(), [](const Span& a, const Span& b) { return a.begin < b.begin; });
+        for (const Span& s : found[r])
+            mask.add(r, s.begin, s.end);
+    }
+    return mask;
+}
+
+SelectionMask lassoMask(int rows, int cols, const std::vector<std::pair<int, int>>& points) {
+    SelectionMask mask(rows, cols);
+    if (points.empty()) return mask;
+
+    // Even-odd fill through tile centres: each edge drops its crossings
+    // into the rows it spans (half-open, so shared vertices count once)
+    std::vector<std::vector<double>> crossings(rows);
+    size_t n = points.size();
+    for (size_t i = 0; i < n; ++i) {
+        auto [r0, c0] = points[i];
+        auto [r1, c1] = points[(i + 1) % n];
+        if (r0 == r1) continue;
+        if (r0 > r1) {
+            std::swap(r0, r1);
+            std::swap(c0, c1);
+        }
+        for (int r = std::max(r0, 0); r < std::min(r1, rows); ++r)
+            crossings[r].push_back(c0 + static_cast<double>(r - r0) * (c1 - c0) / (r1 - r0));
+    }
+    for (int r = 0; r < rows; ++r) {
+        auto& xs = crossings[r];
+        std::sort(xs.begin(), xs.end());
+        for (size_t i = 0; i + 1 < xs.size(); i += 2)
+            mask.add(r, static_cast<int>(std::ceil(xs[i])), static_cast<int>(std::floor(xs[i + 1])) + 1);
+    }
+
+    // The outline itself, so thin or open shapes still select
+    for (size_t i = 0; i < n; ++i)
+        mask.addLine(points[i].first, points[i].second, points[(i + 1) % n].first, points[(i + 1) % n].second);
+    return mask;
+}
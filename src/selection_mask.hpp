@@ -0,0 +1,72 @@
+// Arbitrary tile selections stored as run-length encoded rows
+//
+// Each row keeps a sorted list of disjoint, non-touching [begin, end)
+// column spans. A selection covering half of a large map is a handful of
+// spans per row, and the set operations merge two span lists row by row,
+// so their cost follows the number of spans rather than the number of
+// selected tiles. Tools that build selections (rectangle, magic wand,
+// lasso, brush) produce spans directly.
+
+#pragma once
+
+#include "tile_grid.hpp"
+
+#include <utility>
+#include <vector>
+
+struct Span {
+    int begin, end;  // columns, end exclusive
+};
+
+// How a new selection combines with an existing one
+enum class MaskOp { Replace, Add, Subtract, Intersect };
+
+class SelectionMask {
+public:
+    SelectionMask() = default;
+    SelectionMask(int rows, int cols);
+
+    static SelectionMask rect(int rows, int cols, int top, int left, int height, int width);
+
+    int rows() const { return nRows; }
+    int cols() const { return nCols; }
+
+    const std::vector<Span>& row(int r) const { return spans[r]; }
+    bool contains(int row, int col) const;
+    bool empty() const;
+    size_t count() const;
+    size_t spanCount() const;
+
+    // Inclusive bounding box; false when nothing is selected
+    bool bounds(int& top, int& left, int& bottom, int& right) const;
+
+    // Add columns [begin, end) of a row, merging with what is there
+    void add(int row, int begin, int end);
+    // Add every tile on the line (r0, c0) -> (r1, c1)
+    void addLine(int r0, int c0, int r1, int c1);
+    void clear();
+
+    // Set operations on masks of the same size
+    SelectionMask& operator|=(const SelectionMask& other);
+    SelectionMask& operator&=(const SelectionMask& other);
+    SelectionMask& subtract(const SelectionMask& other);
+    SelectionMask& invert();
+    // Replace becomes `picked`; the others apply the matching operation
+    SelectionMask& combine(SelectionMask picked, MaskOp op);
+
+    // Follow the map to newRows x newCols with the content moved by
+    // (rowOffset, colOffset); spans falling outside are clipped
+    void reframe(int newRows, int newCols, int rowOffset, int colOffset);
+
+private:
+    int nRows = 0, nCols = 0;
+    std::vector<std::vector<Span>> spans;
+};
+
+// Tiles of the same type as (row, col): the 4-connected area around it,
+// or with contiguous == false every such tile of the map
+SelectionMask magicWand(const TileGrid& grid, int row, int col, bool contiguous);
+
+// Tiles inside the closed polygon through `points` (row, col), outline
+// included
+SelectionMask lassoMask(int rows, int cols, const std::vector<std::pair<int, int>>& points);
@@ -0,0 +1,233 @@
+// storm-convert: converts map files between formats without the editor
+//
+//   storm-convert --to json|compact|binary [--jobs N] [--out DIR]
+//                 [--palette palette.json] [FILE...]
+//
+// Paths come from the arguments, or one per line on stdin when there are
+// none. Each result goes next to its input (or into DIR) as .json, or
+// .stormmap for binary, replacing the input when the name is unchanged.
+//
+// One thread reads files, N workers (one per core by default) parse and
+// encode them, and one thread writes the results. The queues between them
+// are bounded, so only a few files are in memory at a time however long
+// the list is, and the disk is kept busy while the workers parse.
+// Two inputs that would write the same output are an error for the second.
+// Exit code 1 when any file failed, 2 for bad arguments.
+
+#include "bounded_queue.hpp"
+#include "map_io.hpp"
+#include "parallel.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Files waiting in each queue, per worker
+const size_t QUEUE_PER_JOB = 2;
+
+const char* BINARY_EXTENSION = ".stormmap";
+
+struct Options {
+    MapFormat format = MapFormat::Json;
+    int jobs = workerCount();
+    fs::path outDir;
+    std::string palettePath = "palette.json";
+    bool paletteGiven = false;
+    std::vector<std::string> inputs;
+};
+
+// A file read from disk, and what it turned into
+struct Job {
+    std::string path;
+    fs::path output;
+    std::string data;
+};
+
+struct Output {
+    fs::path path;
+    std::string data;
+};
+
+void usage() {
+    std::cerr << "Usage: storm-convert --to json|compact|binary [--jobs N] [--out DIR]\n"
+                 "                     [--palette palette.json] [FILE...]\n"
+                 "With no FILE, paths are read from stdin, one per line.\n";
+}
+
+bool parseFormat(const std::string& name, MapFormat& format) {
+    if (name == "json") format = MapFormat::Json;
+    else if (name == "compact") format = MapFormat::Compact;
+    else if (name == "binary") format = MapFormat::Binary;
+    else return false;
+    return true;
+}
+
+bool parseArgs(int argc, char* argv[], Options& opts) {
+    bool haveFormat = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--to" && hasValue) {
+            if (!parseFormat(argv[++i], opts.format)) {
+                std::cerr << "Unknown format '" << argv[i] << "'\n";
+                return false;
+            }
+            haveFormat = true;
+        } else if (arg == "--jobs" && hasValue) {
+            opts.jobs = std::atoi(argv[++i]);
+            if (opts.jobs < 1) {
+                std::cerr << "--jobs needs a positive count\n";
+                return false;
+            }
+        } else if (arg == "--out" && hasValue) {
+            opts.outDir = argv[++i];
+        } else if (arg == "--palette" && hasValue) {
+            opts.palettePath = argv[++i];
+            opts.paletteGiven = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option " << arg << "\n";
+            return false;
+        } else {
+            opts.inputs.push_back(arg);
+        }
+    }
+    if (!haveFormat) std::cerr << "--to is required\n";
+    return haveFormat;
+}
+
+fs::path outputPath(const std::string& input, const Options& opts) {
+    fs::path path = input;
+    path.replace_extension(opts.format == MapFormat::Binary ? BINARY_EXTENSION : ".json");
+    return opts.outDir.empty() ? path : opts.outDir / path.filename();
+}
+
+bool readWhole(const std::string& path, std::string& out) {
+    std::ifstream inFile(path, std::ios::binary);
+    if (!inFile) {
+        std::cerr << "Failed to open " << path << "\n";
+        return false;
+    }
+    out.assign(std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>());
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        usage();
+        return 2;
+    }
+    if (!opts.outDir.empty()) {
+        std::error_code ec;
+        fs::create_directories(opts.outDir, ec);
+        if (ec) {
+            std::cerr << "Can't create " << opts.outDir.string() << ": " << ec.message() << "\n";
+            return 2;
+        }
+    }
+
+    // Without palette.json values are plain ASCII, as in the editor
+    Palette palette;
+    if (!palette.loadFromFile(opts.palettePath) && opts.paletteGiven) {
+        std::cerr << "Can't load palette " << opts.palettePath << "\n";
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t depth = static_cast<size_t>(opts.jobs) * QUEUE_PER_JOB;
+    BoundedQueue<Job> toParse(depth);
+    BoundedQueue<Output> toWrite(depth);
+    std::atomic<size_t> converted{0}, failed{0}, bytesIn{0}, bytesOut{0};
+
+    std::thread reader([&] {
+        // Output name -> the input it was claimed by; a second input that
+        // would write the same file is refused rather than overwriting it
+        std::unordered_map<std::string, std::string> claimed;
+        auto feed = [&](const std::string& path) {
+            Job job{path, outputPath(path, opts), {}};
+            std::error_code ec;
+            fs::path key = fs::weakly_canonical(job.output, ec);
+            auto [it, fresh] = claimed.try_emplace((ec ? job.output.lexically_normal() : key).string(), path);
+            if (!fresh) {
+                std::cerr << path << ": not converted, " << job.output.string() << " is already the output for "
+                          << it->second << "\n";
+                ++failed;
+                return;
+            }
+            if (!readWhole(path, job.data)) {
+                ++failed;
+                return;
+            }
+            bytesIn += job.data.size();
+            toParse.push(std::move(job));
+        };
+        if (opts.inputs.empty()) {
+            for (std::string line; std::getline(std::cin, line);)
+                if (!line.empty()) feed(line);
+        } else {
+            for (const auto& path : opts.inputs)
+                feed(path);
+        }
+        toParse.close();
+    });
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < opts.jobs; ++w)
+        workers.emplace_back([&] {
+            for (;;) {
+                Job job;
+                if (!toParse.pop(job)) break;
+                MapFile file;
+                if (!parseMap(job.data, palette, file)) {
+                    std::cerr << job.path << ": not converted\n";
+                    ++failed;
+                    continue;
+                }
+                if (file.unknown > 0)
+                    std::cerr << job.path << ": " << file.unknown << " tile value(s) not in the palette were left empty\n";
+                std::string().swap(job.data);
+
+                // Straight from the parsed planes, on this worker alone
+                toWrite.push({job.output, encodeMap(file, palette, opts.format)});
+            }
+        });
+
+    std::thread writer([&] {
+        Output out;
+        while (toWrite.pop(out)) {
+            if (!writeMapFile(out.path.string(), out.data)) {
+                ++failed;
+                continue;
+            }
+            bytesOut += out.data.size();
+            ++converted;
+        }
+    });
+
+    reader.join();
+    for (auto& worker : workers)
+        worker.join();
+    toWrite.close();
+    writer.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Converted " << converted << " file(s), " << bytesIn << " -> " << bytesOut << " bytes in "
+              << seconds << " s";
+    if (failed > 0) std::cout << "; " << failed << " failed";
+    std::cout << "\n";
+    return failed > 0 ? 1 : 0;
+}
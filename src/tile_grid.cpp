@@ -0,0 +1,112 @@
+#include "tile_grid.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+template <typename T, T Blank>
+bool GridPlane<T, Blank>::growInPlace(int up, int down, int left, int right, T fill) {
+    if (up > roomUp() || down > roomDown() || left > roomLeft() || right > roomRight()) return false;
+    first -= static_cast<size_t>(up) * pitch + left;
+    nRows += up + down;
+    nCols += left + right;
+    // Whole new rows, then the new columns beside the old rows
+    for (int r = 0; r < nRows; ++r) {
+        T* line = row(r);
+        if (r < up || r >= nRows - down) {
+            std::fill(line, line + nCols, fill);
+        } else {
+            std::fill(line, line + left, fill);
+            std::fill(line + nCols - right, line + nCols, fill);
+        }
+    }
+    return true;
+}
+
+template <typename T, T Blank>
+void GridPlane<T, Blank>::reallocate(int newRows, int newCols, int rowOffset, int colOffset, T fill, int spareUp,
+                                     int spareDown, int spareLeft, int spareRight) {
+    // Source rows/cols of the old content that survive
+    int srcRowBegin = std::max(0, -rowOffset), srcRowEnd = std::min(nRows, newRows - rowOffset);
+    int srcColBegin = std::max(0, -colOffset), srcColEnd = std::min(nCols, newCols - colOffset);
+
+    GridPlane next;
+    next.nRows = newRows;
+    next.nCols = newCols;
+    next.pitch = spareLeft + newCols + spareRight;
+    next.first = static_cast<size_t>(spareUp) * next.pitch + spareLeft;
+    next.cells.assign(static_cast<size_t>(spareUp + newRows + spareDown) * next.pitch, fill);
+    if (srcColEnd > srcColBegin)
+        for (int r = srcRowBegin; r < srcRowEnd; ++r)
+            std::copy(row(r) + srcColBegin, row(r) + srcColEnd, next.row(r + rowOffset) + srcColBegin + colOffset);
+    *this = std::move(next);
+}
+
+template <typename T, T Blank>
+void GridPlane<T, Blank>::reframe(int newRows, int newCols, int rowOffset, int colOffset, T fill) {
+    bool grows = rowOffset >= 0 && colOffset >= 0 && rowOffset + nRows <= newRows && colOffset + nCols <= newCols;
+    if (grows && growInPlace(rowOffset, newRows - nRows - rowOffset, colOffset, newCols - nCols - colOffset, fill))
+        return;
+    reallocate(newRows, newCols, rowOffset, colOffset, fill, 0, 0, 0, 0);
+}
+
+template <typename T, T Blank>
+void GridPlane<T, Blank>::grow(int up, int down, int left, int right, T fill) {
+    if (growInPlace(up, down, left, right, fill)) return;
+    int newRows = nRows + up + down, newCols = nCols + left + right;
+    reallocate(newRows, newCols, up, left, fill, up > 0 ? newRows / 2 : roomUp(), down > 0 ? newRows / 2 : roomDown(),
+               left > 0 ? newCols / 2 : roomLeft(), right > 0 ? newCols / 2 : roomRight());
+}
+
+template <typename T, T Blank>
+void GridPlane<T, Blank>::shift(int dr, int dc, bool wrap, T fill) {
+    if (empty()) return;
+    // The whole-grid moves below need the rows back to back
+    if (pitch != nCols) *this = GridPlane(static_cast<const GridPlane&>(*this));
+    T* begin = row(0);
+    T* end = begin + size();
+
+    if (wrap) {
+        dr = ((dr % nRows) + nRows) % nRows;
+        dc = ((dc % nCols) + nCols) % nCols;
+        // Whole rows are contiguous, so a vertical wrap is one rotate
+        if (dr != 0)
+            std::rotate(begin, end - static_cast<ptrdiff_t>(dr) * nCols, end);
+        if (dc != 0)
+            for (int r = 0; r < nRows; ++r)
+                std::rotate(row(r), row(r) + nCols - dc, row(r) + nCols);
+        return;
+    }
+
+    if (std::abs(dr) >= nRows || std::abs(dc) >= nCols) {
+        std::fill(begin, end, fill);
+        return;
+    }
+
+    if (dr > 0) {
+        std::copy_backward(begin, row(nRows - dr), end);
+        std::fill(begin, row(dr), fill);
+    } else if (dr < 0) {
+        std::copy(row(-dr), end, begin);
+        std::fill(row(nRows + dr), end, fill);
+    }
+
+    if (dc != 0) {
+        for (int r = 0; r < nRows; ++r) {
+            T* line = row(r);
+            if (dc > 0) {
+                std::copy_backward(line, line + nCols - dc, line + nCols);
+                std::fill(line, line + dc, fill);
+            } else {
+                std::copy(line - dc, line + nCols, line);
+                std::fill(line + nCols + dc, line + nCols, fill);
+            }
+        }
+    }
+}
+
+// The planes in use: tiles, and the analyses' per-tile bytes, labels and
+// bit words
+template class GridPlane<Tile, EMPTY_TILE>;
+template class GridPlane<uint8_t>;
+template class GridPlane<uint16_t>;
+template class GridPlane<uint64_t>;
@@ -0,0 +1,122 @@
+// Row-major tile storage
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Tile IDs are one byte unless the build enables wide_tiles (which defines
+// STORM_WIDE_TILES), giving 16-bit IDs for large tilesets. IDs below 128
+// are the ASCII characters, so '#' and '.' mean the same at either width.
+template <int Bits>
+struct TileIdPolicy;
+
+template <>
+struct TileIdPolicy<8> {
+    using type = uint8_t;
+};
+
+template <>
+struct TileIdPolicy<16> {
+    using type = uint16_t;
+};
+
+#ifdef STORM_WIDE_TILES
+inline constexpr int TILE_BITS = 16;
+#else
+inline constexpr int TILE_BITS = 8;
+#endif
+
+using Tile = TileIdPolicy<TILE_BITS>::type;
+
+// Number of distinct IDs; per-ID lookup tables are this long
+inline constexpr size_t TILE_KINDS = size_t(1) << TILE_BITS;
+
+const Tile EMPTY_TILE = '.';
+
+// Short form for console messages: the character for printable ASCII IDs,
+// #<id> otherwise
+inline std::string tileLabel(Tile t) {
+    if (t >= 32 && t < 127) return std::string(1, static_cast<char>(t));
+    return "#" + std::to_string(t);
+}
+
+// Row-major storage of rows x cols cells: tiles, and the per-tile planes
+// the analyses keep next to them
+//
+// The cells may sit inside a larger allocation with spare rows and columns
+// around them. grow() leaves such room on the sides that grew, so a canvas
+// growing outward writes only its new cells instead of copying the old
+// ones each time. Each row is contiguous, but rows are stride() cells
+// apart, which can be more than cols(). index() is the row-major position
+// within the grid, for side tables of rows x cols entries; it is not an
+// offset into the storage. Copies are tight.
+template <typename T, T Blank = T()>
+class GridPlane {
+public:
+    GridPlane() = default;
+    GridPlane(int rows, int cols, T fill = Blank)
+        : nRows(rows), nCols(cols), pitch(cols), cells(static_cast<size_t>(rows) * cols, fill) {}
+    GridPlane(const GridPlane& other) : nRows(other.nRows), nCols(other.nCols), pitch(other.nCols) {
+        cells.reserve(other.size());
+        for (int r = 0; r < nRows; ++r) cells.insert(cells.end(), other.row(r), other.row(r) + nCols);
+    }
+    GridPlane(GridPlane&&) noexcept = default;
+    GridPlane& operator=(const GridPlane& other) {
+        if (this != &other) *this = GridPlane(other);
+        return *this;
+    }
+    GridPlane& operator=(GridPlane&&) noexcept = default;
+
+    int rows() const { return nRows; }
+    int cols() const { return nCols; }
+    int stride() const { return pitch; }
+    size_t size() const { return static_cast<size_t>(nRows) * nCols; }
+    bool empty() const { return size() == 0; }
+    bool inBounds(int row, int col) const { return row >= 0 && row < nRows && col >= 0 && col < nCols; }
+
+    T& at(int row, int col) { return cells[first + static_cast<size_t>(row) * pitch + col]; }
+    T at(int row, int col) const { return cells[first + static_cast<size_t>(row) * pitch + col]; }
+    T* row(int r) { return cells.data() + first + static_cast<size_t>(r) * pitch; }
+    const T* row(int r) const { return cells.data() + first + static_cast<size_t>(r) * pitch; }
+
+    size_t index(int row, int col) const { return static_cast<size_t>(row) * nCols + col; }
+
+    // Change the dimensions, keeping the old content with its (0, 0) moved
+    // to (rowOffset, colOffset). Negative offsets cut from the top/left, and
+    // anything outside the new bounds is dropped. Growth that fits the
+    // spare room only writes the new cells; anything else makes a tight
+    // copy with whole row spans.
+    void reframe(int newRows, int newCols, int rowOffset, int colOffset, T fill = Blank);
+
+    // Add rows and columns on each side. When the spare room runs out, every
+    // side that grew gets half the new size as room on top, so repeated
+    // growth costs amortized O(new cells).
+    void grow(int up, int down, int left, int right, T fill = Blank);
+
+    // Keep only the given rectangle
+    void crop(int top, int left, int height, int width) { reframe(height, width, -top, -left); }
+
+    // Move the content by (dr, dc), either wrapping around or filling the
+    // uncovered strip with `fill`
+    void shift(int dr, int dc, bool wrap, T fill = Blank);
+
+private:
+    int nRows = 0, nCols = 0, pitch = 0;
+    size_t first = 0;  // storage offset of (0, 0)
+    std::vector<T> cells;
+
+    // Spare cells between the grid and the edges of its storage
+    int roomUp() const { return pitch > 0 ? static_cast<int>(first / pitch) : 0; }
+    int roomLeft() const { return pitch > 0 ? static_cast<int>(first % pitch) : 0; }
+    int roomDown() const { return pitch > 0 ? static_cast<int>(cells.size() / pitch) - roomUp() - nRows : 0; }
+    int roomRight() const { return pitch > 0 ? pitch - roomLeft() - nCols : 0; }
+
+    bool growInPlace(int up, int down, int left, int right, T fill);
+    void reallocate(int newRows, int newCols, int rowOffset, int colOffset, T fill, int spareUp, int spareDown,
+                    int spareLeft, int spareRight);
+};
+
+using TileGrid = GridPlane<Tile, EMPTY_TILE>;
@@ -0,0 +1,124 @@
+// Chunked tile storage with a compile-time tile order
+//
+// ChunkedGrid<Layout> keeps the map as LAYOUT_CHUNK x LAYOUT_CHUNK chunks,
+// each one contiguous in memory. The Layout policy orders the tiles inside
+// a chunk: RowMajorLayout matches TileGrid, MortonLayout interleaves the
+// row and column bits (Z-order) so a tile's vertical neighbours sit a few
+// bytes away instead of a whole map row. Code written against at() and
+// the forEach helpers works with either layout unchanged.
+
+#pragma once
+
+#include "tile_grid.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const int LAYOUT_CHUNK_BITS = 5;
+const int LAYOUT_CHUNK = 1 << LAYOUT_CHUNK_BITS;
+const int LAYOUT_CHUNK_TILES = LAYOUT_CHUNK * LAYOUT_CHUNK;
+
+struct RowMajorLayout {
+    static constexpr const char* NAME = "row-major";
+
+    static int offset(int row, int col) { return (row << LAYOUT_CHUNK_BITS) | col; }
+    static int row(int offset) { return offset >> LAYOUT_CHUNK_BITS; }
+    static int col(int offset) { return offset & (LAYOUT_CHUNK - 1); }
+};
+
+// 000abcde -> 0a0b0c0d0e, tabled since the Morton offset runs on every access
+inline constexpr std::array<uint16_t, LAYOUT_CHUNK> MORTON_SPREAD = [] {
+    std::array<uint16_t, LAYOUT_CHUNK> table{};
+    for (int v = 0; v < LAYOUT_CHUNK; ++v) {
+        int x = (v | (v << 4)) & 0x0F0F;
+        x = (x | (x << 2)) & 0x3333;
+        table[v] = static_cast<uint16_t>((x | (x << 1)) & 0x5555);
+    }
+    return table;
+}();
+
+struct MortonLayout {
+    static constexpr const char* NAME = "morton";
+
+    static int offset(int row, int col) { return MORTON_SPREAD[col] | (MORTON_SPREAD[row] << 1); }
+    static int row(int offset) { return compact(offset >> 1); }
+    static int col(int offset) { return compact(offset); }
+
+private:
+    static int compact(int v) {
+        v &= 0x5555;
+        v = (v | (v >> 1)) & 0x3333;
+        v = (v | (v >> 2)) & 0x0F0F;
+        return (v | (v >> 4)) & 0x00FF;
+    }
+};
+
+template <typename Layout>
+class ChunkedGrid {
+public:
+    ChunkedGrid() = default;
+    ChunkedGrid(int rows, int cols, Tile fill = EMPTY_TILE)
+        : nRows(rows), nCols(cols), chunkCols((cols + LAYOUT_CHUNK - 1) >> LAYOUT_CHUNK_BITS),
+          tiles(static_cast<size_t>((rows + LAYOUT_CHUNK - 1) >> LAYOUT_CHUNK_BITS) * chunkCols * LAYOUT_CHUNK_TILES,
+                fill) {}
+    explicit ChunkedGrid(const TileGrid& grid) : ChunkedGrid(grid.rows(), grid.cols()) {
+        for (int r = 0; r < nRows; ++r)
+            for (int c = 0; c < nCols; ++c) at(r, c) = grid.at(r, c);
+    }
+
+    int rows() const { return nRows; }
+    int cols() const { return nCols; }
+    bool inBounds(int row, int col) const { return row >= 0 && row < nRows && col >= 0 && col < nCols; }
+
+    Tile& at(int row, int col) { return tiles[index(row, col)]; }
+    Tile at(int row, int col) const { return tiles[index(row, col)]; }
+
+    TileGrid toTileGrid() const {
+        TileGrid grid(nRows, nCols);
+        forEachTile([&grid](int row, int col, Tile t) { grid.at(row, col) = t; });
+        return grid;
+    }
+
+    // fn(row, col, tile) for every tile, in storage order
+    template <typename Fn>
+    void forEachTile(Fn&& fn) const {
+        visit(*this, fn);
+    }
+    template <typename Fn>
+    void forEachTile(Fn&& fn) {
+        visit(*this, fn);
+    }
+
+    // fn(row, col, tile) for the in-bounds tiles of the 3x3 block around
+    // (row, col), the centre excluded
+    template <typename Fn>
+    void forEachNeighbour(int row, int col, Fn&& fn) const {
+        for (int dr = -1; dr <= 1; ++dr)
+            for (int dc = -1; dc <= 1; ++dc)
+                if ((dr || dc) && inBounds(row + dr, col + dc)) fn(row + dr, col + dc, at(row + dr, col + dc));
+    }
+
+private:
+    int nRows = 0, nCols = 0, chunkCols = 0;
+    std::vector<Tile> tiles;  // padded to whole chunks
+
+    size_t index(int row, int col) const {
+        size_t chunk = static_cast<size_t>(row >> LAYOUT_CHUNK_BITS) * chunkCols + (col >> LAYOUT_CHUNK_BITS);
+        return (chunk << (2 * LAYOUT_CHUNK_BITS)) + Layout::offset(row & (LAYOUT_CHUNK - 1), col & (LAYOUT_CHUNK - 1));
+    }
+
+    template <typename Self, typename Fn>
+    static void visit(Self& self, Fn& fn) {
+        for (size_t chunk = 0; chunk * LAYOUT_CHUNK_TILES < self.tiles.size(); ++chunk) {
+            int top = static_cast<int>(chunk / self.chunkCols) << LAYOUT_CHUNK_BITS;
+            int left = static_cast<int>(chunk % self.chunkCols) << LAYOUT_CHUNK_BITS;
+            auto* base = &self.tiles[chunk * LAYOUT_CHUNK_TILES];
+            for (int i = 0; i < LAYOUT_CHUNK_TILES; ++i) {
+                int row = top + Layout::row(i), col = left + Layout::col(i);
+                if (row < self.nRows && col < self.nCols) fn(row, col, base[i]);
+            }
+        }
+    }
+};
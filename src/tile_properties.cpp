@@ -0,0 +1,61 @@
+#include "tile_properties.hpp"
+#include "nlohmann/json.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+void setTiles(std::array<bool, TILE_KINDS>& table, const json& tiles, const Palette& palette) {
+    table.fill(false);
+    std::vector<Tile> ids;
+    bool ok = true;
+    if (tiles.is_string()) {
+        ok = palette.fromGlyphs(tiles.get<std::string>(), ids);
+    } else {
+        for (const auto& name : tiles) {
+            Tile t;
+            if (palette.fromName(name, t))
+                ids.push_back(t);
+            else
+                ok = false;
+        }
+    }
+    if (!ok)
+        std::cerr << "Tile properties: " << tiles.dump() << " names tiles not in the palette\n";
+    for (Tile t : ids) table[t] = true;
+}
+
+}  // namespace
+
+bool TileProperties::loadFromFile(const std::string& path, const Palette& palette) {
+    std::ifstream inFile(path);
+    if (!inFile)
+        return false;  // keep the defaults
+
+    json j;
+    try {
+        inFile >> j;
+    } catch (json::parse_error& e) {
+        std::cerr << "Tile properties parse error: " << e.what() << "\n";
+        return false;
+    }
+    if (!j.is_object()) {
+        std::cerr << "Tile properties must be a JSON object\n";
+        return false;
+    }
+
+    auto isSet = [&](const char* key) { return j.contains(key) && (j[key].is_string() || j[key].is_array()); };
+    if (isSet("solid"))
+        setTiles(solid, j["solid"], palette);
+    if (isSet("opaque"))
+        setTiles(opaque, j["opaque"], palette);
+    else
+        opaque = solid;
+
+    std::cout << "Loaded tile properties from " << path << "\n";
+    return true;
+}
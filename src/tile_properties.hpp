@@ -0,0 +1,29 @@
+// Per-character tile properties shared by the analysis tools
+//
+// Read from tiles.json, e.g. { "solid": "#~", "opaque": "#" }. Anything not
+// listed is passable/transparent. Defaults to '#' being solid when the file
+// is missing; "opaque" defaults to the solid set. Sets are strings of glyphs
+// or arrays of tile names, resolved through the palette: glyphs, values,
+// "#<id>" or integer IDs (the only way to reach IDs without a glyph).
+
+#pragma once
+
+#include "palette.hpp"
+#include "tile_grid.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+struct TileProperties {
+    std::array<bool, TILE_KINDS> solid{};
+    std::array<bool, TILE_KINDS> opaque{};
+
+    TileProperties() { solid['#'] = opaque['#'] = true; }
+
+    bool isSolid(Tile t) const { return solid[t]; }
+    bool isPassable(Tile t) const { return !isSolid(t); }
+    bool isOpaque(Tile t) const { return opaque[t]; }
+
+    bool loadFromFile(const std::string& path, const Palette& palette);
+};
@@ -0,0 +1,120 @@
+#include "transform.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+
+namespace {
+
+const int BLOCK = 32;
+
+// Whole-grid copies below this many tiles aren't worth a thread
+const size_t PARALLEL_THRESHOLD = 1 << 20;
+
+// Mirror or copy rows of a rows x cols block without transposing
+void copyMirrored(const Tile* src, int rows, int cols, int srcStride,
+                  Tile* dst, int dstStride, bool mirrorRows, bool mirrorCols) {
+    auto copyRows = [&](int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            const Tile* from = src + static_cast<size_t>(mirrorRows ? rows - 1 - r : r) * srcStride;
+            Tile* to = dst + static_cast<size_t>(r) * dstStride;
+            if (mirrorCols)
+                std::reverse_copy(from, from + cols, to);
+            else
+                std::copy(from, from + cols, to);
+        }
+    };
+    if (static_cast<size_t>(rows) * cols >= PARALLEL_THRESHOLD)
+        parallelForRows(rows, copyRows);
+    else
+        copyRows(0, rows);
+}
+
+}  // namespace
+
+void transposeBlocked(const Tile* src, int rows, int cols, int srcStride,
+                      Tile* dst, int dstStride, bool mirrorRows, bool mirrorCols) {
+    // Each band owns a range of destination rows (= source columns)
+    auto band = [&](int begin, int end) {
+        for (int c0 = begin; c0 < end; c0 += BLOCK) {
+            int c1 = std::min(end, c0 + BLOCK);
+            for (int r0 = 0; r0 < rows; r0 += BLOCK) {
+                int r1 = std::min(rows, r0 + BLOCK);
+                for (int c = c0; c < c1; ++c) {
+                    int sc = mirrorCols ? cols - 1 - c : c;
+                    Tile* out = dst + static_cast<size_t>(c) * dstStride;
+                    for (int r = r0; r < r1; ++r) {
+                        int sr = mirrorRows ? rows - 1 - r : r;
+                        out[r] = src[static_cast<size_t>(sr) * srcStride + sc];
+                    }
+                }
+            }
+        }
+    };
+
+    if (static_cast<size_t>(rows) * cols >= PARALLEL_THRESHOLD)
+        parallelForRows(cols, band, BLOCK);
+    else
+        band(0, cols);
+}
+
+void transformGrid(TileGrid& grid, GridTransform t) {
+    int rows = grid.rows(), cols = grid.cols();
+    if (grid.empty()) return;
+
+    switch (t) {
+        case GridTransform::Rotate180:
+            // Rows in reverse order, each reversed
+            for (int r = 0; r < rows / 2; ++r)
+                std::swap_ranges(grid.row(r), grid.row(r) + cols, grid.row(rows - 1 - r));
+            for (int r = 0; r < rows; ++r)
+                std::reverse(grid.row(r), grid.row(r) + cols);
+            return;
+        case GridTransform::FlipHorizontal:
+            for (int r = 0; r < rows; ++r)
+                std::reverse(grid.row(r), grid.row(r) + cols);
+            return;
+        case GridTransform::FlipVertical:
+            for (int r = 0; r < rows / 2; ++r)
+                std::swap_ranges(grid.row(r), grid.row(r) + cols, grid.row(rows - 1 - r));
+            return;
+        default:
+            break;
+    }
+
+    // new[i][j] = old[rows-1-j][i] for a clockwise turn, old[j][cols-1-i]
+    // for a counter-clockwise one
+    TileGrid out(cols, rows);
+    transposeBlocked(grid.row(0), rows, cols, grid.stride(), out.row(0), out.stride(),
+                     t == GridTransform::Rotate90, t == GridTransform::Rotate270);
+    grid = std::move(out);
+}
+
+void transformRegion(TileGrid& grid, int top, int left, int& height, int& width, GridTransform t) {
+    if (height <= 0 || width <= 0) return;
+
+    // Work on a packed copy of the rectangle
+    TileGrid block(height, width);
+    copyMirrored(grid.row(top) + left, height, width, grid.stride(), block.row(0), width, false, false);
+
+    if (!swapsDimensions(t)) {
+        copyMirrored(block.row(0), height, width, width, grid.row(top) + left, grid.stride(),
+                     t == GridTransform::Rotate180 || t == GridTransform::FlipVertical,
+                     t == GridTransform::Rotate180 || t == GridTransform::FlipHorizontal);
+        return;
+    }
+
+    TileGrid turned(width, height);
+    transposeBlocked(block.row(0), height, width, width, turned.row(0), height,
+                     t == GridTransform::Rotate90, t == GridTransform::Rotate270);
+
+    // Clear the old footprint, then paste the turned block clipped to the map
+    for (int r = top; r < top + height; ++r)
+        std::fill(grid.row(r) + left, grid.row(r) + left + width, EMPTY_TILE);
+    int newHeight = std::min(turned.rows(), grid.rows() - top);
+    int newWidth = std::min(turned.cols(), grid.cols() - left);
+    for (int r = 0; r < newHeight; ++r)
+        std::copy(turned.row(r), turned.row(r) + newWidth, grid.row(top + r) + left);
+
+    height = newHeight;
+    width = newWidth;
+}
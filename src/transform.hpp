@@ -0,0 +1,35 @@
+// Rotations, flips and transposes of the map or a rectangle of it
+
+#pragma once
+
+#include "tile_grid.hpp"
+
+enum class GridTransform {
+    Rotate90,    // clockwise
+    Rotate180,
+    Rotate270,   // i.e. 90 counter-clockwise
+    FlipHorizontal,
+    FlipVertical,
+    Transpose,
+};
+
+// True if the transform swaps width and height
+inline bool swapsDimensions(GridTransform t) {
+    return t == GridTransform::Rotate90 || t == GridTransform::Rotate270 || t == GridTransform::Transpose;
+}
+
+// Cache-blocked transpose: dst[c][r] = src[r'][c'] for a rows x cols source,
+// where r'/c' are r/c optionally mirrored. Works on 32x32 blocks so both the
+// reads and the writes stay within a few cache lines, and splits the
+// destination rows over threads for large inputs. Strides are in tiles.
+void transposeBlocked(const Tile* src, int rows, int cols, int srcStride,
+                      Tile* dst, int dstStride, bool mirrorRows, bool mirrorCols);
+
+// Transform the whole grid; rotating by 90/270 swaps its dimensions
+void transformGrid(TileGrid& grid, GridTransform t);
+
+// Transform the rectangle at (top, left) of size height x width in place.
+// A 90/270 rotation of a non-square rectangle keeps its top-left corner and
+// is clipped to the map; uncovered tiles become EMPTY_TILE. Updates
+// height/width to the rectangle that now holds the result.
+void transformRegion(TileGrid& grid, int top, int left, int& height, int& width, GridTransform t);
@@ -0,0 +1,217 @@
+#include "validation.hpp"
+#include "nlohmann/json.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iostream>
+
+using json = nlohmann::json;
+
+bool ValidationRules::loadFromFile(const std::string& path, const Palette& palette) {
+    std::ifstream inFile(path);
+    if (!inFile)
+        return false;  // no rules, nothing to check
+
+    json j;
+    try {
+        inFile >> j;
+    } catch (json::parse_error& e) {
+        std::cerr << "Validation rules parse error: " << e.what() << "\n";
+        return false;
+    }
+    if (!j.is_object()) {
+        std::cerr << "Validation rules must be a JSON object\n";
+        return false;
+    }
+
+    *this = ValidationRules();
+    auto unknown = [](const std::string& name) {
+        std::cerr << "Validation rules: '" << name << "' is not a tile in the palette\n";
+    };
+    if (j.contains("required") && j["required"].is_object())
+        for (const auto& [key, count] : j["required"].items()) {
+            Tile t;
+            if (!count.is_number_integer()) continue;
+            if (palette.fromName(key, t))
+                required.emplace_back(t, count.get<int>());
+            else
+                unknown(key);
+        }
+    closedBorder = j.value("closed_border", false);
+    allReachable = j.value("all_reachable", false);
+    // Each pair is a string of two glyphs or an array of two names
+    if (j.contains("forbidden_pairs") && j["forbidden_pairs"].is_array())
+        for (const auto& pair : j["forbidden_pairs"]) {
+            std::vector<Tile> ids;
+            bool ok = pair.is_string() ? palette.fromGlyphs(pair.get<std::string>(), ids) : pair.is_array();
+            if (pair.is_array())
+                for (const auto& name : pair) {
+                    Tile t;
+                    if (!palette.fromName(name, t)) {
+                        ok = false;
+                        break;
+                    }
+                    ids.push_back(t);
+                }
+            if (ok && ids.size() == 2)
+                forbiddenPairs.emplace_back(ids[0], ids[1]);
+            else
+                unknown(pair.dump());
+        }
+
+    std::cout << "Loaded validation rules from " << path << "\n";
+    return true;
+}
+
+void MapValidator::evaluateChunk(const TileGrid& grid, const TileProperties& props, int chunk) {
+    int top = (chunk / chunkCols) * VALIDATION_CHUNK, left = (chunk % chunkCols) * VALIDATION_CHUNK;
+    int bottom = std::min(rows, top + VALIDATION_CHUNK), right = std::min(cols, left + VALIDATION_CHUNK);
+    ChunkResult& result = chunks[chunk];
+    result.counts.assign(rules.required.size(), 0);
+    result.first.assign(rules.required.size(), {-1, -1});
+    result.local.clear();
+
+    auto forbidden = [&](Tile a, Tile b) {
+        for (const auto& [x, y] : rules.forbiddenPairs)
+            if ((a == x && b == y) || (a == y && b == x)) return true;
+        return false;
+    };
+
+    for (int r = top; r < bottom; ++r) {
+        const Tile* line = grid.row(r);
+        for (int c = left; c < right; ++c) {
+            Tile t = line[c];
+            for (size_t i = 0; i < rules.required.size(); ++i)
+                if (t == rules.required[i].first && result.counts[i]++ == 0)
+                    result.first[i] = {r, c};
+
+            if (rules.closedBorder && (r == 0 || c == 0 || r == rows - 1 || c == cols - 1) && !props.isSolid(t))
+                result.local.push_back({"open border tile", r, c});
+
+            // Each pair belongs to its top/left tile
+            if (paired[t]) {
+                if (c + 1 < cols && forbidden(t, line[c + 1]))
+                    result.local.push_back({"'" + tileLabel(t) + "' next to '" + tileLabel(line[c + 1]) + "'", r, c});
+                if (r + 1 < rows && forbidden(t, grid.at(r + 1, c)))
+                    result.local.push_back({"'" + tileLabel(t) + "' above '" + tileLabel(grid.at(r + 1, c)) + "'", r, c});
+            }
+        }
+    }
+}
+
+void MapValidator::collect(const RegionMap& regions) {
+    found.clear();
+
+    for (size_t i = 0; i < rules.required.size(); ++i) {
+        int total = 0;
+        std::pair<int, int> first{-1, -1};
+        for (const auto& chunk : chunks) {
+            if (first.first < 0 && chunk.counts[i] > 0) first = chunk.first[i];
+            total += chunk.counts[i];
+        }
+        auto [tile, expected] = rules.required[i];
+        if (total != expected)
+            found.push_back({"'" + tileLabel(tile) + "' appears " + std::to_string(total) + " time(s), expected " +
+                                 std::to_string(expected),
+                             first.first, first.second});
+    }
+
+    if (rules.allReachable && regions.stats().size() > 1) {
+        const auto& stats = regions.stats();
+        size_t largest = 0;
+        for (size_t i = 1; i < stats.size(); ++i)
+            if (stats[i].size > stats[largest].size) largest = i;
+        for (size_t i = 0; i < stats.size(); ++i) {
+            if (i == largest) continue;
+            const RegionStats& s = stats[i];
+            found.push_back({"unreachable pocket of " + std::to_string(s.size) + " tile(s) in (" +
+                                 std::to_string(s.top) + ", " + std::to_string(s.left) + ")-(" +
+                                 std::to_string(s.bottom) + ", " + std::to_string(s.right) + ")",
+                             s.top, s.left});
+        }
+    }
+
+    for (const auto& chunk : chunks)
+        found.insert(found.end(), chunk.local.begin(), chunk.local.end());
+}
+
+void MapValidator::rebuild(const TileGrid& grid, const TileProperties& props, const RegionMap& regions) {
+    rows = grid.rows();
+    cols = grid.cols();
+    chunkRows = (rows + VALIDATION_CHUNK - 1) / VALIDATION_CHUNK;
+    chunkCols = (cols + VALIDATION_CHUNK - 1) / VALIDATION_CHUNK;
+    chunks.assign(static_cast<size_t>(chunkRows) * chunkCols, {});
+    dirty.assign(chunks.size(), 0);
+    paired.assign(TILE_KINDS, 0);
+    for (const auto& [a, b] : rules.forbiddenPairs)
+        paired[a] = paired[b] = 1;
+
+    parallelForRows(chunkRows, [&](int begin, int end) {
+        for (int c = begin * chunkCols; c < end * chunkCols; ++c) evaluateChunk(grid, props, c);
+    }, 4);
+    collect(regions);
+}
+
+void MapValidator::markDirty(int row, int col) {
+    if (row < 0 || row >= rows || col < 0 || col >= cols) return;
+    dirty[(row / VALIDATION_CHUNK) * chunkCols + col / VALIDATION_CHUNK] = 1;
+    if (row > 0) dirty[((row - 1) / VALIDATION_CHUNK) * chunkCols + col / VALIDATION_CHUNK] = 1;
+    if (col > 0) dirty[(row / VALIDATION_CHUNK) * chunkCols + (col - 1) / VALIDATION_CHUNK] = 1;
+}
+
+void MapValidator::reframe(int newRows, int newCols, int rowOffset, int colOffset) {
+    bool whole = rows > 0 && rowOffset >= 0 && colOffset >= 0 && rowOffset % VALIDATION_CHUNK == 0 &&
+                 colOffset % VALIDATION_CHUNK == 0 && rowOffset + rows <= newRows && colOffset + cols <= newCols;
+    if (!whole) {
+        rows = cols = 0;  // refresh() rebuilds
+        return;
+    }
+
+    int newChunkRows = (newRows + VALIDATION_CHUNK - 1) / VALIDATION_CHUNK;
+    int newChunkCols = (newCols + VALIDATION_CHUNK - 1) / VALIDATION_CHUNK;
+    int rowShift = rowOffset / VALIDATION_CHUNK, colShift = colOffset / VALIDATION_CHUNK;
+    bool up = rowOffset > 0, down = rowOffset + rows < newRows;
+    bool left = colOffset > 0, right = colOffset + cols < newCols;
+    std::vector<ChunkResult> moved(static_cast<size_t>(newChunkRows) * newChunkCols);
+    std::vector<uint8_t> marks(moved.size(), 1);  // new chunks are evaluated on refresh
+    for (int cr = 0; cr < chunkRows; ++cr)
+        for (int cc = 0; cc < chunkCols; ++cc) {
+            int from = cr * chunkCols + cc, to = (cr + rowShift) * newChunkCols + cc + colShift;
+            ChunkResult& result = chunks[from];
+            for (auto& first : result.first)
+                if (first.first >= 0) first = {first.first + rowOffset, first.second + colOffset};
+            for (auto& v : result.local) {
+                v.row += rowOffset;
+                v.col += colOffset;
+            }
+            moved[to] = std::move(result);
+            marks[to] = dirty[from] || (up && cr == 0) || (down && cr == chunkRows - 1) || (left && cc == 0) ||
+                        (right && cc == chunkCols - 1);
+        }
+    chunks.swap(moved);
+    dirty.swap(marks);
+    rows = newRows;
+    cols = newCols;
+    chunkRows = newChunkRows;
+    chunkCols = newChunkCols;
+}
+
+void MapValidator::refresh(const TileGrid& grid, const TileProperties& props, const RegionMap& regions) {
+    if (grid.rows() != rows || grid.cols() != cols) {
+        rebuild(grid, props, regions);
+        return;
+    }
+
+    std::vector<int> work;
+    for (size_t c = 0; c < dirty.size(); ++c)
+        if (dirty[c]) {
+            work.push_back(static_cast<int>(c));
+            dirty[c] = 0;
+        }
+    parallelForRows(static_cast<int>(work.size()), [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) evaluateChunk(grid, props, work[i]);
+    }, 8);
+    collect(regions);  // cheap: one pass over chunk results and regions
+}
@@ -0,0 +1,78 @@
+// Map validation rules, evaluated incrementally
+//
+// Rules come from validation.json, e.g.
+//   { "required": { "S": 1, "E": 1 },      exact count of each character
+//     "closed_border": true,               every edge tile must be solid
+//     "all_reachable": true,               one passable region only
+//     "forbidden_pairs": ["~#", "S~"] }    characters that may not touch (4-neighbours)
+//
+// Keys name tiles as Palette::fromName takes them (glyph, value or "#<id>");
+// a pair is two glyphs or an array of two names such as ["#300", "water"].
+//
+// Local rules are evaluated per VALIDATION_CHUNK x VALIDATION_CHUNK chunk and
+// cached; an edit only re-evaluates its chunk (and the chunks above/left of
+// it, which own the pairs it takes part in). The global verdict is put
+// together from the chunk results and the region statistics.
+
+#pragma once
+
+#include "palette.hpp"
+#include "regions.hpp"
+#include "tile_grid.hpp"
+#include "tile_properties.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+const int VALIDATION_CHUNK = 64;
+
+struct ValidationRules {
+    std::vector<std::pair<Tile, int>> required;
+    bool closedBorder = false;
+    bool allReachable = false;
+    std::vector<std::pair<Tile, Tile>> forbiddenPairs;
+
+    // Tiles are named through the palette (see Palette::fromName)
+    bool loadFromFile(const std::string& path, const Palette& palette);
+    bool empty() const { return required.empty() && !closedBorder && !allReachable && forbiddenPairs.empty(); }
+};
+
+struct Violation {
+    std::string message;
+    int row = -1, col = -1;  // -1 when there is no single tile to point at
+};
+
+class MapValidator {
+public:
+    ValidationRules rules;
+
+    void rebuild(const TileGrid& grid, const TileProperties& props, const RegionMap& regions);
+    void markDirty(int row, int col);
+    // The map grew, its old (0, 0) now at (rowOffset, colOffset). Moved by
+    // whole chunks, old results are kept and the next refresh() evaluates
+    // the new chunks and the old ones along the sides that grew (their
+    // border tiles and pairs changed); any other change leaves that to a
+    // rebuild.
+    void reframe(int newRows, int newCols, int rowOffset, int colOffset);
+    // regions must already be refreshed for the current grid
+    void refresh(const TileGrid& grid, const TileProperties& props, const RegionMap& regions);
+
+    const std::vector<Violation>& violations() const { return found; }
+
+private:
+    struct ChunkResult {
+        std::vector<int> counts;                 // per required rule
+        std::vector<std::pair<int, int>> first;  // first position per required rule, row-major within the chunk
+        std::vector<Violation> local;            // border and pair violations
+    };
+
+    int rows = 0, cols = 0, chunkRows = 0, chunkCols = 0;
+    std::vector<ChunkResult> chunks;
+    std::vector<uint8_t> dirty;
+    std::vector<uint8_t> paired;  // per tile ID: part of some forbidden pair
+    std::vector<Violation> found;
+
+    void evaluateChunk(const TileGrid& grid, const TileProperties& props, int chunk);
+    void collect(const RegionMap& regions);
+};
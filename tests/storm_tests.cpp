@@ -0,0 +1,679 @@
+// Headless checks for libstorm: every incremental cache against a full
+// rebuild of the same map, the map formats against each other, and the
+// search and bit-parallel kernels against the plain loops they replace
+//
+// Maps are random but seeded, so a failure repeats. Each check prints the
+// line that failed, and the run exits non-zero.
+
+#include "autotile.hpp"
+#include "bit_grid.hpp"
+#include "distance_field.hpp"
+#include "edit_session.hpp"
+#include "hpa.hpp"
+#include "map_document.hpp"
+#include "map_io.hpp"
+#include "packed_grid.hpp"
+#include "paged_grid.hpp"
+#include "pathfinding.hpp"
+#include "pattern_search.hpp"
+#include "regions.hpp"
+#include "selection_mask.hpp"
+#include "validation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond)                                                                    \
+    do {                                                                               \
+        if (!(cond)) {                                                                 \
+            ++failures;                                                                \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond "\n"; \
+        }                                                                              \
+    } while (0)
+
+std::mt19937 rng(20240611);
+
+int randomInt(int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); }
+
+std::string scratchPath(const std::string& name) {
+    auto dir = std::filesystem::temp_directory_path() / "storm_tests";
+    std::filesystem::create_directories(dir);
+    return (dir / name).string();
+}
+
+// Walls ('#'), water, spawns and floor in the given proportions
+TileGrid randomMap(int rows, int cols, int wallPercent) {
+    TileGrid grid(rows, cols);
+    for (int r = 0; r < rows; ++r)
+        for (int c = 0; c < cols; ++c) {
+            int x = randomInt(0, 99);
+            grid.at(r, c) = x < wallPercent ? '#' : x < wallPercent + 2 ? '~' : x < wallPercent + 3 ? 'S' : '.';
+        }
+    return grid;
+}
+
+bool sameTiles(const TileGrid& a, const TileGrid& b) {
+    if (a.rows() != b.rows() || a.cols() != b.cols()) return false;
+    for (int r = 0; r < a.rows(); ++r)
+        if (!std::equal(a.row(r), a.row(r) + a.cols(), b.row(r))) return false;
+    return true;
+}
+
+ValidationRules testRules() {
+    ValidationRules rules;
+    rules.required = {{'S', 1}};
+    rules.closedBorder = true;
+    rules.allReachable = true;
+    rules.forbiddenPairs = {{'~', 'S'}, {'#', '~'}};
+    return rules;
+}
+
+std::vector<std::tuple<int, int, int, int, int>> regionStats(const RegionMap& regions) {
+    std::vector<std::tuple<int, int, int, int, int>> out;
+    for (const auto& s : regions.stats()) out.emplace_back(s.size, s.top, s.left, s.bottom, s.right);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+std::vector<std::string> violations(const MapValidator& validator) {
+    std::vector<std::string> out;
+    for (const auto& v : validator.violations())
+        out.push_back(v.message + "@" + std::to_string(v.row) + "," + std::to_string(v.col));
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+// Same partition of the map into regions, whatever the ids
+bool sameRegions(const RegionMap& a, const RegionMap& b, int rows, int cols) {
+    std::vector<int> toB(a.stats().size() + 1, -2);
+    for (int r = 0; r < rows; ++r)
+        for (int c = 0; c < cols; ++c) {
+            int ia = a.regionAt(r, c), ib = b.regionAt(r, c);
+            if ((ia < 0) != (ib < 0)) return false;
+            if (ia < 0) continue;
+            if (toB[ia] == -2) toB[ia] = ib;
+            if (toB[ia] != ib) return false;
+        }
+    return true;
+}
+
+// Incremental caches kept up to date through random edits and canvas
+// growth, compared with caches built from scratch on the final map
+void testIncrementalAnalyses(const std::string& rulesPath) {
+    TileProperties props;
+    Palette palette;
+    ValidationRules rules = testRules();
+
+    for (int round = 0; round < 12; ++round) {
+        TileGrid grid = randomMap(randomInt(20, 140), randomInt(20, 140), randomInt(15, 45));
+        RegionMap regions;
+        regions.rebuild(grid, props);
+        HierarchicalPathCache hpa;
+        hpa.rebuild(grid, props);
+        MapValidator validator;
+        validator.rules = rules;
+        validator.rebuild(grid, props, regions);
+        PathFinder finder;
+        finder.rebuild(grid, props);
+        BitGrid solid = solidMask(grid, props);
+        AutoTiler tiler;
+        CHECK(tiler.loadRules(rulesPath, palette));
+        tiler.rebuild(grid);
+
+        for (int step = 0; step < 3; ++step) {
+            // Whole-chunk growth takes the incremental path, the rest the
+            // fallback rebuild
+            bool aligned = randomInt(0, 3) != 0;
+            int up = aligned ? 64 * randomInt(0, 1) : randomInt(0, 40);
+            int left = aligned ? 64 * randomInt(0, 1) : randomInt(0, 40);
+            grid.grow(up, randomInt(0, 70), left, randomInt(0, 70));
+            int rows = grid.rows(), cols = grid.cols();
+            regions.reframe(rows, cols, up, left);
+            hpa.reframe(rows, cols, up, left);
+            validator.reframe(rows, cols, up, left);
+            finder.reframe(grid, props, up, left);
+            growSolidMask(solid, grid, props, up, left);
+            tiler.reframe(grid, up, left);
+
+            for (int i = randomInt(0, 300); i > 0; --i) {
+                int r = randomInt(0, rows - 1), c = randomInt(0, cols - 1);
+                Tile t = "#.~S"[randomInt(0, 3)];
+                grid.at(r, c) = t;
+                regions.markDirty(r, c);
+                hpa.markDirty(r, c);
+                validator.markDirty(r, c);
+                finder.updateTile(r, c, t, props);
+                solid.set(r, c, props.isSolid(t));
+                tiler.updateAround(grid, r, c);
+            }
+            regions.refresh(grid, props);
+            hpa.refresh(grid, props);
+            validator.refresh(grid, props, regions);
+
+            RegionMap freshRegions;
+            freshRegions.rebuild(grid, props);
+            CHECK(regionStats(regions) == regionStats(freshRegions));
+            CHECK(sameRegions(regions, freshRegions, rows, cols));
+
+            MapValidator freshValidator;
+            freshValidator.rules = rules;
+            freshValidator.rebuild(grid, props, freshRegions);
+            CHECK(violations(validator) == violations(freshValidator));
+
+            HierarchicalPathCache freshHpa;
+            freshHpa.rebuild(grid, props);
+            CHECK(hpa.exportGraph() == freshHpa.exportGraph());
+
+            BitGrid freshSolid = solidMask(grid, props);
+            bool sameBits = solid.count() == freshSolid.count();
+            for (int r = 0; r < rows && sameBits; ++r)
+                for (int c = 0; c < cols; ++c) sameBits &= solid.get(r, c) == freshSolid.get(r, c);
+            CHECK(sameBits);
+
+            AutoTiler freshTiler;
+            freshTiler.loadRules(rulesPath, palette);
+            freshTiler.rebuild(grid);
+            CHECK(tiler.exportTiles(grid, palette) == freshTiler.exportTiles(grid, palette));
+
+            PathFinder freshFinder;
+            freshFinder.rebuild(grid, props);
+            for (int i = 0; i < 20; ++i) {
+                PathPoint from{randomInt(0, rows - 1), randomInt(0, cols - 1)};
+                PathPoint to{randomInt(0, rows - 1), randomInt(0, cols - 1)};
+                std::vector<PathPoint> path, freshPath, waypoints, freshWaypoints;
+                float length = 0, freshLength = 0, hpaLength = 0, freshHpaLength = 0;
+                bool found = finder.findPath(from, to, path, length);
+                CHECK(found == freshFinder.findPath(from, to, freshPath, freshLength));
+                if (found) CHECK(std::fabs(length - freshLength) < 1e-3f);
+                bool hpaFound = hpa.findPath(grid, props, from, to, waypoints, hpaLength);
+                CHECK(hpaFound == found);
+                CHECK(hpaFound == freshHpa.findPath(grid, props, from, to, freshWaypoints, freshHpaLength));
+                if (hpaFound) CHECK(std::fabs(hpaLength - freshHpaLength) < 1e-3f);
+            }
+        }
+    }
+}
+
+// Grid edits, growth and transforms on rows with spare room around them
+void testGridPlane() {
+    for (int round = 0; round < 100; ++round) {
+        int rows = randomInt(0, 40), cols = randomInt(0, 40);
+        TileGrid base(rows, cols);
+        for (int r = 0; r < rows; ++r)
+            for (int c = 0; c < cols; ++c) base.at(r, c) = 'a' + randomInt(0, 4);
+
+        TileGrid grown = base, framed = base;
+        for (int i = 0; i < 4; ++i) {
+            int up = randomInt(0, 6), down = randomInt(0, 6), left = randomInt(0, 6), right = randomInt(0, 6);
+            grown.grow(up, down, left, right);
+            framed.reframe(framed.rows() + up + down, framed.cols() + left + right, up, left);
+        }
+        CHECK(sameTiles(grown, framed));
+
+        TileGrid copy = grown;
+        CHECK(copy.stride() == copy.cols() && sameTiles(copy, grown));
+
+        int dr = randomInt(-4, 4), dc = randomInt(-4, 4);
+        bool wrap = randomInt(0, 1);
+        TileGrid shiftedSpare = grown, shiftedTight = copy;
+        shiftedSpare.shift(dr, dc, wrap);
+        shiftedTight.shift(dr, dc, wrap);
+        CHECK(sameTiles(shiftedSpare, shiftedTight));
+
+        if (grown.rows() > 2 && grown.cols() > 2) {
+            TileGrid cropped = grown;
+            cropped.crop(1, 1, grown.rows() - 2, grown.cols() - 2);
+            bool same = true;
+            for (int r = 0; r < cropped.rows(); ++r)
+                for (int c = 0; c < cropped.cols(); ++c) same &= cropped.at(r, c) == grown.at(r + 1, c + 1);
+            CHECK(same);
+        }
+    }
+}
+
+// Packed and paged storage against a plain grid, through growth
+void testPackedAndPaged() {
+    for (int round = 0; round < 60; ++round) {
+        int rows = randomInt(1, 80), cols = randomInt(1, 80);
+        TileGrid grid(rows, cols);
+        for (int r = 0; r < rows; ++r)
+            for (int c = 0; c < cols; ++c)
+                if (randomInt(0, 2) == 0) grid.at(r, c) = 'a' + randomInt(0, 4);
+        PackedGrid packed(grid);
+        PagedGrid paged(grid, 4096);
+
+        bool aligned = randomInt(0, 1);
+        int rowOffset = aligned ? 32 * randomInt(0, 2) : randomInt(-20, 30);
+        int colOffset = aligned ? 32 * randomInt(0, 2) : randomInt(-20, 30);
+        int newRows = aligned ? rows + rowOffset + randomInt(0, 40) : randomInt(1, 100);
+        int newCols = aligned ? cols + colOffset + randomInt(0, 40) : randomInt(1, 100);
+        grid.reframe(newRows, newCols, rowOffset, colOffset);
+        packed.reframe(newRows, newCols, rowOffset, colOffset);
+        paged.reframe(newRows, newCols, rowOffset, colOffset);
+        CHECK(packed.rows() == newRows && packed.cols() == newCols);
+        CHECK(paged.rows() == newRows && paged.cols() == newCols);
+
+        bool same = true;
+        for (int r = 0; r < newRows && same; ++r)
+            for (int c = 0; c < newCols; ++c)
+                same &= packed.get(r, c) == grid.at(r, c) && paged.get(r, c) == grid.at(r, c);
+        CHECK(same);
+        CHECK(sameTiles(paged.unpack(), grid));
+    }
+
+    PagedGrid blank(70, 45, 4096);
+    CHECK(blank.all(EMPTY_TILE) && !blank.all('#'));
+    blank.set(69, 44, '#');
+    CHECK(!blank.all(EMPTY_TILE));
+}
+
+MapFile randomMapFile(int rows, int cols) {
+    MapFile file;
+    file.planes[LAYER_TERRAIN] = TileGrid(rows, cols);
+    for (int l = 1; l < LAYER_COUNT; ++l)
+        if (randomInt(0, 1)) file.planes[l] = TileGrid(rows, cols);
+    for (auto& plane : file.planes)
+        for (int r = 0; r < plane.rows(); ++r)
+            for (int c = 0; c < plane.cols(); ++c)
+                if (randomInt(0, 3) == 0) plane.at(r, c) = 'a' + randomInt(0, 2);
+    file.hasOrigin = randomInt(0, 1);
+    file.originRow = -5;
+    file.originCol = 7;
+    return file;
+}
+
+bool sameMapFiles(const MapFile& a, const MapFile& b) {
+    if (a.hasOrigin != b.hasOrigin) return false;
+    if (a.hasOrigin && (a.originRow != b.originRow || a.originCol != b.originCol)) return false;
+    for (int l = 0; l < LAYER_COUNT; ++l) {
+        const TileGrid& pa = a.planes[l];
+        const TileGrid& pb = b.planes[l];
+        // A layer one format leaves out reads back as blank in another
+        int rows = std::max(pa.rows(), pb.rows()), cols = std::max(pa.cols(), pb.cols());
+        for (int r = 0; r < rows; ++r)
+            for (int c = 0; c < cols; ++c) {
+                Tile ta = pa.inBounds(r, c) ? pa.at(r, c) : EMPTY_TILE;
+                Tile tb = pb.inBounds(r, c) ? pb.at(r, c) : EMPTY_TILE;
+                if (ta != tb) return false;
+            }
+    }
+    return true;
+}
+
+// Every format reads back what was written, and the streamed and paged
+// paths agree with the in-memory ones
+void testMapFormats() {
+    Palette palette;
+    for (int round = 0; round < 30; ++round) {
+        MapFile file = randomMapFile(randomInt(1, 120), randomInt(1, 120));
+        int rows = file.planes[LAYER_TERRAIN].rows(), cols = file.planes[LAYER_TERRAIN].cols();
+
+        for (MapFormat format : {MapFormat::Json, MapFormat::Compact, MapFormat::Binary}) {
+            std::string path = scratchPath("format.map");
+            CHECK(writeMapFile(path, encodeMap(file, palette, format)));
+            MapFile back;
+            CHECK(readMapFile(path, palette, back));
+            CHECK(back.format == format);
+            CHECK(sameMapFiles(file, back));
+        }
+
+        std::string binaryPath = scratchPath("paged.stormmap");
+        std::string binary = encodeMap(file, palette, MapFormat::Binary);
+        CHECK(writeMapFile(binaryPath, binary));
+        int peekRows = 0, peekCols = 0;
+        CHECK(peekMapSize(binaryPath, peekRows, peekCols) && peekRows == rows && peekCols == cols);
+        PagedMapFile paged;
+        CHECK(readMapPaged(binaryPath, 1500, paged));
+        for (int l = 0; l < LAYER_COUNT; ++l) {
+            bool same = paged.planes[l].rows() == rows && paged.planes[l].cols() == cols;
+            for (int r = 0; r < rows && same; ++r)
+                for (int c = 0; c < cols; ++c) {
+                    Tile want = file.planes[l].empty() ? EMPTY_TILE : file.planes[l].at(r, c);
+                    same &= paged.planes[l].get(r, c) == want;
+                }
+            CHECK(same);
+        }
+
+        // Truncated and padded files are refused
+        std::ofstream(binaryPath, std::ios::binary) << binary.substr(0, binary.size() - 1);
+        CHECK(!readMapPaged(binaryPath, 1500, paged));
+        MapFile refused;
+        CHECK(!readMapFile(binaryPath, palette, refused));
+        std::ofstream(binaryPath, std::ios::binary) << binary << 'z';
+        CHECK(!readMapPaged(binaryPath, 1500, paged));
+    }
+
+    // Streamed saves match an encode of the snapshot, whatever the storage
+    for (int storage = 0; storage < 3; ++storage)
+        for (int canvas = 0; canvas < 2; ++canvas) {
+            LayerStack layers(100, 77);
+            layers.set(LAYER_TERRAIN, 40, 5, '#');
+            layers.set(LAYER_TERRAIN, 70, 60, 'a');
+            layers.set(LAYER_TRIGGER, 33, 70, 't');
+            for (int l = 0; l < LAYER_COUNT; ++l) layers.setStorage(l, LayerStorage(storage));
+            if (storage == 2) layers.setPageBudget(2048);
+            std::string path = scratchPath("streamed.stormmap");
+            CHECK(writeMapStreamed(path, layers, canvas, -3, 4));
+            MapSnapshot snap = layers.snapshot();
+            MapFile back;
+            CHECK(readMapFile(path, palette, back));
+            CHECK(back.format == MapFormat::Binary);
+            CHECK(encodeMap(back, palette, MapFormat::Binary) == encodeMap(snap, canvas, -3, 4, palette,
+                                                                           MapFormat::Binary));
+        }
+
+    // Wider than the editor's limit: binary maps still load
+    MapFile wide;
+    wide.planes[LAYER_TERRAIN] = TileGrid(3, 20000);
+    wide.planes[LAYER_TERRAIN].at(2, 19999) = '#';
+    std::string widePath = scratchPath("wide.stormmap");
+    CHECK(writeMapFile(widePath, encodeMap(wide, palette, MapFormat::Binary)));
+    MapFile wideBack;
+    CHECK(readMapFile(widePath, palette, wideBack));
+    CHECK(wideBack.planes[LAYER_TERRAIN].cols() == 20000 && wideBack.planes[LAYER_TERRAIN].at(2, 19999) == '#');
+}
+
+void testDiffMap() {
+    for (int round = 0; round < 30; ++round) {
+        int rows = randomInt(10, 90), cols = randomInt(10, 90);
+        LayerStack layers(rows, cols);
+        for (int i = randomInt(0, 200); i > 0; --i)
+            layers.set(randomInt(0, LAYER_COUNT - 1), randomInt(0, rows - 1), randomInt(0, cols - 1), 'a');
+        MapSnapshot snap = layers.snapshot();
+
+        int fileRows = randomInt(1, rows), fileCols = randomInt(1, cols);
+        int rowOffset = randomInt(0, rows - fileRows), colOffset = randomInt(0, cols - fileCols);
+        MapFile file = randomMapFile(fileRows, fileCols);
+
+        std::vector<TileDiff> diffs;
+        CHECK(diffMap(snap, file, rowOffset, colOffset, diffs));
+        size_t expected = 0;
+        for (int l = 0; l < LAYER_COUNT; ++l)
+            for (int r = 0; r < rows; ++r)
+                for (int c = 0; c < cols; ++c) {
+                    int fr = r - rowOffset, fc = c - colOffset;
+                    const TileGrid& plane = file.planes[l];
+                    Tile onDisk = plane.inBounds(fr, fc) ? plane.at(fr, fc) : EMPTY_TILE;
+                    expected += snap.planes[l].get(r, c) != onDisk;
+                }
+        CHECK(diffs.size() == expected);
+        for (const auto& d : diffs) CHECK(d.before == snap.planes[d.layer].get(d.row, d.col) && d.before != d.after);
+    }
+}
+
+void testPatternSearch() {
+    for (int round = 0; round < 60; ++round) {
+        TileGrid map(randomInt(1, 40), randomInt(1, 40));
+        for (int r = 0; r < map.rows(); ++r)
+            for (int c = 0; c < map.cols(); ++c) map.at(r, c) = 'a' + randomInt(0, 1);
+        TileGrid pattern(randomInt(1, 4), randomInt(1, 4));
+        for (int r = 0; r < pattern.rows(); ++r)
+            for (int c = 0; c < pattern.cols(); ++c) pattern.at(r, c) = 'a' + randomInt(0, 2);
+
+        std::vector<PatternMatch> matches = findPattern(map, pattern, Tile('c'));
+        std::vector<std::pair<int, int>> expected, found;
+        for (int r = 0; r + pattern.rows() <= map.rows(); ++r)
+            for (int c = 0; c + pattern.cols() <= map.cols(); ++c) {
+                bool match = true;
+                for (int pr = 0; pr < pattern.rows(); ++pr)
+                    for (int pc = 0; pc < pattern.cols(); ++pc)
+                        match &= pattern.at(pr, pc) == 'c' || pattern.at(pr, pc) == map.at(r + pr, c + pc);
+                if (match) expected.emplace_back(r, c);
+            }
+        for (const auto& m : matches) found.emplace_back(m.row, m.col);
+        CHECK(found == expected);
+
+        std::vector<uint8_t> coverage =
+            matchCoverage(matches, pattern.rows(), pattern.cols(), map.rows(), map.cols());
+        std::vector<uint8_t> covered(static_cast<size_t>(map.rows()) * map.cols(), 0);
+        for (const auto& m : matches)
+            for (int r = 0; r < pattern.rows(); ++r)
+                for (int c = 0; c < pattern.cols(); ++c) covered[map.index(m.row + r, m.col + c)] = 1;
+        CHECK(coverage == covered);
+    }
+}
+
+// Jump point search against a plain 8-connected Dijkstra with the same
+// corner rule: no diagonal step past a solid tile
+void testJumpPointSearch() {
+    TileProperties props;
+    const float diagonal = std::sqrt(2.0f);
+    for (int round = 0; round < 20; ++round) {
+        TileGrid grid = randomMap(randomInt(5, 60), randomInt(5, 60), randomInt(10, 40));
+        int rows = grid.rows(), cols = grid.cols();
+        PathFinder finder;
+        finder.rebuild(grid, props);
+        auto open = [&](int r, int c) { return grid.inBounds(r, c) && !props.isSolid(grid.at(r, c)); };
+
+        for (int q = 0; q < 10; ++q) {
+            PathPoint from{randomInt(0, rows - 1), randomInt(0, cols - 1)};
+            PathPoint to{randomInt(0, rows - 1), randomInt(0, cols - 1)};
+
+            std::vector<float> dist(static_cast<size_t>(rows) * cols, std::numeric_limits<float>::infinity());
+            std::vector<bool> done(dist.size(), false);
+            if (open(from.row, from.col)) dist[grid.index(from.row, from.col)] = 0;
+            for (;;) {
+                int best = -1;
+                for (size_t i = 0; i < dist.size(); ++i)
+                    if (!done[i] && std::isfinite(dist[i]) && (best < 0 || dist[i] < dist[best])) best = int(i);
+                if (best < 0) break;
+                done[best] = true;
+                int r = best / cols, c = best % cols;
+                for (int dr = -1; dr <= 1; ++dr)
+                    for (int dc = -1; dc <= 1; ++dc) {
+                        if ((dr == 0 && dc == 0) || !open(r + dr, c + dc)) continue;
+                        if (dr != 0 && dc != 0 && (!open(r + dr, c) || !open(r, c + dc))) continue;
+                        float step = dr != 0 && dc != 0 ? diagonal : 1.0f;
+                        float& d = dist[grid.index(r + dr, c + dc)];
+                        d = std::min(d, dist[best] + step);
+                    }
+            }
+
+            std::vector<PathPoint> path;
+            float length = 0;
+            bool found = finder.findPath(from, to, path, length);
+            float want = dist[grid.index(to.row, to.col)];
+            CHECK(found == std::isfinite(want));
+            if (found) CHECK(std::fabs(length - want) < 1e-3f);
+        }
+    }
+}
+
+void testDistanceFields() {
+    TileProperties props;
+    for (int round = 0; round < 20; ++round) {
+        TileGrid grid = randomMap(randomInt(1, 40), randomInt(1, 40), randomInt(0, 10));
+        std::vector<float> field = wallDistance(grid, props);
+        bool same = true;
+        for (int r = 0; r < grid.rows(); ++r)
+            for (int c = 0; c < grid.cols(); ++c) {
+                float want = std::numeric_limits<float>::infinity();
+                for (int wr = 0; wr < grid.rows(); ++wr)
+                    for (int wc = 0; wc < grid.cols(); ++wc)
+                        if (props.isSolid(grid.at(wr, wc)))
+                            want = std::min(want, std::hypot(float(wr - r), float(wc - c)));
+                float got = field[grid.index(r, c)];
+                same &= std::isinf(want) ? std::isinf(got) : std::fabs(got - want) < 1e-3f;
+            }
+        CHECK(same);
+    }
+}
+
+void testBitGrid() {
+    for (int round = 0; round < 40; ++round) {
+        int rows = randomInt(1, 50), cols = randomInt(1, 150);
+        BitGrid grid(rows, cols);
+        std::vector<uint8_t> plain(static_cast<size_t>(rows) * cols, 0);
+        for (int r = 0; r < rows; ++r)
+            for (int c = 0; c < cols; ++c)
+                if (randomInt(0, 2) == 0) {
+                    grid.set(r, c, true);
+                    plain[size_t(r) * cols + c] = 1;
+                }
+        bool edge = randomInt(0, 1);
+        auto at = [&](int r, int c) {
+            return r < 0 || c < 0 || r >= rows || c >= cols ? edge : plain[size_t(r) * cols + c] != 0;
+        };
+
+        size_t set = 0;
+        for (uint8_t v : plain) set += v;
+        CHECK(grid.count() == set);
+
+        BitGrid dilated = grid.dilate(edge), eroded = grid.erode(edge);
+        int k = randomInt(1, 8);
+        BitGrid enough = grid.atLeast(k, false, edge);
+        std::vector<uint8_t> counts;
+        grid.neighbourCounts(counts, edge);
+        bool same = true;
+        for (int r = 0; r < rows; ++r)
+            for (int c = 0; c < cols; ++c) {
+                bool any = false, every = true;
+                int around = 0;
+                for (int dr = -1; dr <= 1; ++dr)
+                    for (int dc = -1; dc <= 1; ++dc) {
+                        any |= at(r + dr, c + dc);
+                        every &= at(r + dr, c + dc);
+                        if (dr != 0 || dc != 0) around += at(r + dr, c + dc);
+                    }
+                same &= dilated.get(r, c) == any && eroded.get(r, c) == every;
+                same &= enough.get(r, c) == (around >= k) && counts[size_t(r) * cols + c] == around;
+            }
+        CHECK(same);
+
+        BitGrid inverted = grid;
+        inverted.invert();
+        CHECK(inverted.count() == size_t(rows) * cols - set);
+    }
+}
+
+void testSelectionMask() {
+    for (int round = 0; round < 60; ++round) {
+        int rows = randomInt(1, 30), cols = randomInt(1, 30);
+        auto randomRect = [&](std::vector<uint8_t>& plain) {
+            int top = randomInt(0, rows - 1), left = randomInt(0, cols - 1);
+            int height = randomInt(1, rows - top), width = randomInt(1, cols - left);
+            plain.assign(size_t(rows) * cols, 0);
+            for (int r = top; r < top + height; ++r)
+                for (int c = left; c < left + width; ++c) plain[size_t(r) * cols + c] = 1;
+            return SelectionMask::rect(rows, cols, top, left, height, width);
+        };
+        std::vector<uint8_t> a, b;
+        SelectionMask ma = randomRect(a), mb = randomRect(b);
+
+        int op = randomInt(0, 3);
+        if (op == 0) ma |= mb;
+        if (op == 1) ma &= mb;
+        if (op == 2) ma.subtract(mb);
+        if (op == 3) ma.invert();
+        size_t expected = 0;
+        bool same = true;
+        for (int r = 0; r < rows; ++r)
+            for (int c = 0; c < cols; ++c) {
+                size_t i = size_t(r) * cols + c;
+                bool want = op == 0 ? a[i] || b[i] : op == 1 ? a[i] && b[i] : op == 2 ? a[i] && !b[i] : !a[i];
+                expected += want;
+                same &= ma.contains(r, c) == want;
+            }
+        CHECK(same);
+        CHECK(ma.count() == expected && ma.empty() == (expected == 0));
+    }
+}
+
+// A transaction over several layers notifies each once and undoes as one
+// step; growth keeps the history and the file's copy lined up with the map
+void testEditsAndGrowth() {
+    LayerStack layers(20, 20);
+    EditSession edits(layers);
+    std::vector<int> notified;
+    edits.observe([&](const EditBatch& batch) {
+        notified.push_back(batch.layer);
+        for (const auto& change : batch.changes) CHECK(change.layer == batch.layer);
+    });
+    edits.begin();
+    edits.set(LAYER_TERRAIN, 1, 1, '#');
+    edits.set(LAYER_TRIGGER, 2, 2, 't');
+    edits.set(LAYER_TERRAIN, 3, 3, '#');
+    CHECK(edits.commit() == 3);
+    std::sort(notified.begin(), notified.end());
+    CHECK(notified == std::vector<int>({LAYER_TERRAIN, LAYER_TRIGGER}));
+    CHECK(edits.undo() == 3);
+    CHECK(layers.get(LAYER_TERRAIN, 1, 1) == EMPTY_TILE && layers.get(LAYER_TRIGGER, 2, 2) == EMPTY_TILE);
+    CHECK(edits.redo() == 3);
+    CHECK(layers.get(LAYER_TRIGGER, 2, 2) == 't');
+
+    for (int round = 0; round < 20; ++round) {
+        MapDocument doc;
+        MapFile file;
+        file.planes[LAYER_TERRAIN] = TileGrid(randomInt(10, 100), randomInt(10, 100));
+        file.hasOrigin = true;
+        doc.load(std::move(file));
+        if (randomInt(0, 1)) doc.layers.setStorage(LAYER_DECORATION, LayerStorage::Packed);
+
+        for (int step = 0; step < 5; ++step) {
+            doc.edits.begin();
+            for (int i = randomInt(1, 20); i > 0; --i)
+                doc.edits.set(randomInt(0, 1), randomInt(0, doc.rows() - 1), randomInt(0, doc.cols() - 1),
+                              'a' + randomInt(0, 2));
+            doc.edits.commit();
+
+            MapSnapshot before = doc.layers.snapshot();
+            int originRow = doc.originRow, originCol = doc.originCol;
+            int row = randomInt(-150, 150), col = randomInt(-150, 150);
+            CanvasGrowth growth = doc.grow(row, col, row, col);
+            CHECK(growth.up % GROW_CHUNK == 0 && growth.down % GROW_CHUNK == 0);
+            CHECK(growth.left % GROW_CHUNK == 0 && growth.right % GROW_CHUNK == 0);
+            CHECK(doc.originRow == originRow - growth.up && doc.originCol == originCol - growth.left);
+            CHECK(doc.diskState.rows() == doc.rows() && doc.diskState.cols() == doc.cols());
+            bool kept = true;
+            for (int l = 0; l < 2; ++l)
+                for (int r = 0; r < before.rows(); ++r)
+                    for (int c = 0; c < before.cols(); ++c)
+                        kept &= doc.layers.get(l, r + growth.up, c + growth.left) == before.planes[l].get(r, c);
+            CHECK(kept);
+        }
+
+        while (doc.edits.canUndo()) doc.edits.undo();
+        MapSnapshot undone = doc.layers.snapshot();
+        CHECK(undone.blank(LAYER_TERRAIN) && undone.blank(LAYER_DECORATION));
+        CHECK(doc.diskState.blank(LAYER_TERRAIN));
+        while (doc.edits.canRedo()) doc.edits.redo();
+        MapSnapshot redone = doc.layers.snapshot();
+        CHECK(!redone.blank(LAYER_TERRAIN) || !redone.blank(LAYER_DECORATION));
+    }
+}
+
+}  // namespace
+
+int main() {
+    std::string rulesPath = scratchPath("autotile.json");
+    std::ofstream(rulesPath) << R"({"neighbours":8,"rules":{"#":{"connects":"#","default":"wall",)"
+                             << R"("variants":{"0":"pillar","255":"fill","31":"edge"}}}})";
+
+    testGridPlane();
+    testPackedAndPaged();
+    testIncrementalAnalyses(rulesPath);
+    testMapFormats();
+    testDiffMap();
+    testPatternSearch();
+    testJumpPointSearch();
+    testDistanceFields();
+    testBitGrid();
+    testSelectionMask();
+    testEditsAndGrowth();
+
+    std::filesystem::remove_all(std::filesystem::temp_directory_path() / "storm_tests");
+    if (failures == 0) std::cout << "all checks passed\n";
+    return failures == 0 ? 0 : 1;
+}